@@ -153,11 +153,12 @@ override android_all_native_markers := $(foreach x,$(ANDROID_ABIS),$(ANDROID_BUI
 # * Replace `SDLActivity` with our own activity class.
 #   (SDL's `build-scripts/create-android-project.py` does this too.)
 # * Add `<uses-sdk ... />` with our SDK version, since otherwise installing the APK fails with the error that it was built for version 0.
+# * Add the `INTERNET` permission, for broadcasting the game to the players' devices (see `replication.h`).
 ANDROID_ORIGINAL_MANIFEST := $(ANDROID_SDL_SOURCE)/android-project/app/src/main/AndroidManifest.xml
 ANDROID_MANIFEST := $(ANDROID_BUILD_DIR)/AndroidManifest.xml
 $(ANDROID_MANIFEST): $(ANDROID_ORIGINAL_MANIFEST)
 	mkdir -p $(dir $@)
-	gawk '/SDLActivity/ {gsub(/SDLActivity/, "$(ANDROID_ACTIVITY)")} {print $$0} /^<manifest/ {print "    package=\"$(ANDROID_PACKAGE)\""} /installLocation/ {print "    <uses-sdk android:minSdkVersion=\"$(ANDROID_PLATFORM_MIN)\" android:targetSdkVersion=\"$(ANDROID_PLATFORM)\" />"}' $< >$@
+	gawk '/SDLActivity/ {gsub(/SDLActivity/, "$(ANDROID_ACTIVITY)")} {print $$0} /^<manifest/ {print "    package=\"$(ANDROID_PACKAGE)\""} /installLocation/ {print "    <uses-sdk android:minSdkVersion=\"$(ANDROID_PLATFORM_MIN)\" android:targetSdkVersion=\"$(ANDROID_PLATFORM)\" />"; print "    <uses-permission android:name=\"android.permission.INTERNET\" />"}' $< >$@
 
 # Create a java source file for the activity.
 # (SDL's `build-scripts/create-android-project.py` does this too.)
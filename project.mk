@@ -18,8 +18,8 @@ $(Mode)PROJ_COMMON_FLAGS := -flto
 $(Mode)_win_subsystem := -mwindows
 
 $(call NewMode,profile)
-$(Mode)GLOBAL_COMMON_FLAGS := -O3 -pg
-$(Mode)GLOBAL_CXXFLAGS := -DNDEBUG
+$(Mode)GLOBAL_COMMON_FLAGS := -O3
+$(Mode)GLOBAL_CXXFLAGS := -DNDEBUG -DENABLE_TRACING=1
 $(Mode)_win_subsystem := -mwindows
 
 $(call NewMode,sanitize_address_ub)
@@ -33,9 +33,22 @@ DIST_NAME := $(DIST_NAME)_$(MODE)
 endif
 
 ifeq ($(TARGET_OS),emscripten)
-ASSETS_IGNORED_PATTERNS := *# A temporary hack to avoid copying assets into the output directory.
+# Players open the web version on their phones over slow Wi-Fi, so the download size matters more than the speed.
+ifeq ($(MODE),release)
+GLOBAL_COMMON_FLAGS := $(filter-out -O3,$(GLOBAL_COMMON_FLAGS)) -Oz
+endif
+# All current browsers support it, and it lets the compiler vectorize the ImGui vertex loops.
+GLOBAL_COMMON_FLAGS += -msimd128
 endif
 
+# The UI font, subset to the characters we can display. The full font is 10x larger, which matters for the startup time and the download size.
+# This needs `pyftsubset` (from `fonttools`). Without it the release build fails, and the other modes use the full font as is, with a warning.
+# The character ranges are in a variable, since the commas would split the arguments of `$(if)`.
+_font_unicodes := U+0020-007E,U+00A0-00FF,U+0400-045F,U+0490-0491,U+2010-2027,U+2116
+ASSETS_GENERATED += assets/NotoSans.ttf
+assets/NotoSans.ttf: fonts/NotoSans.ttf
+	$(if $(shell command -v pyftsubset),pyftsubset $(call quote,$<) --output-file=$(call quote,$@) --unicodes=$(_font_unicodes) --layout-features='*',$(if $(filter release,$(MODE)),$(error `pyftsubset` (from `fonttools`) is needed to subset the font for the release build),$(warning `pyftsubset` (from `fonttools`) isn't installed. The font won't be subset.)cp $(call quote,$<) $(call quote,$@)))
+
 # --- Project config ---
 
 PROJ_CXXFLAGS += -std=c++26 -pedantic-errors
@@ -47,6 +60,8 @@ PROJ_CXXFLAGS += -Isrc
 
 ifeq ($(TARGET_OS),windows)
 PROJ_LDFLAGS += $(_win_subsystem)
+# Winsock, for `socket.cpp`.
+PROJ_LDFLAGS += -lws2_32
 endif
 
 # The common PCH rules for all projects.
@@ -58,10 +73,56 @@ $(call ProjectSetting,source_dirs,src)
 $(call ProjectSetting,libs,*)
 
 ifeq ($(TARGET_OS),emscripten)
-$(call ProjectSetting,ldflags,--shell-file=src/emscripten_shell.html --preload-file=assets)
+# The assets are copied next to the page and downloaded on demand (see `LoadFonts()`), rather than preloaded before the app starts.
+$(call ProjectSetting,ldflags,--shell-file=src/emscripten_shell.html -sENVIRONMENT=web)
 $(call ProjectSetting,linking_depends_on,src/emscripten_shell.html)
 endif
 
+# A headless frame benchmark. See `tools/bench/main.cpp`.
+ifeq ($(filter android emscripten,$(TARGET_OS)),)
+$(call Project,exe,bench)
+$(call ProjectSetting,source_dirs,src tools/bench)
+$(call ProjectSetting,ignored_sources,src/main.cpp)
+$(call ProjectSetting,cxxflags,-DCOUNT_ALLOCATIONS=1)
+$(call ProjectSetting,libs,*)
+
+# Replays input recorded with `--record-input`. See `tools/input_replay/main.cpp`.
+$(call Project,exe,input_replay)
+$(call ProjectSetting,source_dirs,src tools/input_replay)
+$(call ProjectSetting,ignored_sources,src/main.cpp)
+$(call ProjectSetting,libs,*)
+
+# Checks the state replication between many subscribers over loopback. See `tools/replication_loopback/main.cpp`.
+$(call Project,exe,replication_loopback)
+$(call ProjectSetting,source_dirs,src tools/replication_loopback)
+$(call ProjectSetting,ignored_sources,src/main.cpp)
+$(call ProjectSetting,libs,*)
+
+# Checks that the session journal replays into a valid session. See `tools/journal_replay/main.cpp`.
+$(call Project,exe,journal_replay)
+$(call ProjectSetting,source_dirs,src tools/journal_replay)
+$(call ProjectSetting,ignored_sources,src/main.cpp)
+$(call ProjectSetting,libs,*)
+
+# Queries the game archive, or fills it with random games to benchmark on. See `tools/archive_query/main.cpp`.
+$(call Project,exe,archive_query)
+$(call ProjectSetting,source_dirs,src tools/archive_query)
+$(call ProjectSetting,ignored_sources,src/main.cpp)
+$(call ProjectSetting,libs,*)
+
+# Exports the built-in strings for translation, and builds language packs from the translations. See `tools/language_pack/main.cpp`.
+$(call Project,exe,language_pack)
+$(call ProjectSetting,source_dirs,src tools/language_pack)
+$(call ProjectSetting,ignored_sources,src/main.cpp)
+$(call ProjectSetting,libs,*)
+
+# Plays random games to compare role configurations. See `tools/simulate/main.cpp`.
+$(call Project,exe,simulate)
+$(call ProjectSetting,source_dirs,src tools/simulate)
+$(call ProjectSetting,ignored_sources,src/main.cpp)
+$(call ProjectSetting,libs,*)
+endif
+
 
 # --- Dependencies ---
 
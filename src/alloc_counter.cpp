@@ -0,0 +1,47 @@
+#include "alloc_counter.h"
+
+#if COUNT_ALLOCATIONS
+#include <cstdlib>
+#include <new>
+
+static thread_local std::uint64_t num_allocations = 0;
+
+std::uint64_t GetNumAllocations()
+{
+    return num_allocations;
+}
+
+void *CountingImGuiAlloc(std::size_t size, void *user_data)
+{
+    (void)user_data;
+    num_allocations++;
+    return std::malloc(size);
+}
+
+void CountingImGuiFree(void *ptr, void *user_data)
+{
+    (void)user_data;
+    std::free(ptr);
+}
+
+// The array and `nothrow` versions of those call the ones below by default, so we don't need to replace them.
+
+void *operator new(std::size_t size)
+{
+    num_allocations++;
+    if (void *ret = std::malloc(size ? size : 1))
+        return ret;
+    throw std::bad_alloc{};
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t size) noexcept
+{
+    (void)size;
+    std::free(ptr);
+}
+#endif
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// If enabled, we count the heap allocations made by each thread, both through `operator new` and through ImGui's allocator.
+// This is used to check that steady-state frames don't allocate.
+#ifndef COUNT_ALLOCATIONS
+#ifdef NDEBUG
+#define COUNT_ALLOCATIONS 0
+#else
+#define COUNT_ALLOCATIONS 1
+#endif
+#endif
+
+#if COUNT_ALLOCATIONS
+// Returns the number of heap allocations made by the current thread so far.
+[[nodiscard]] std::uint64_t GetNumAllocations();
+
+// Pass those to `ImGui::SetAllocatorFunctions()` to count ImGui's allocations too.
+[[nodiscard]] void *CountingImGuiAlloc(std::size_t size, void *user_data);
+void CountingImGuiFree(void *ptr, void *user_data);
+#endif
@@ -0,0 +1,742 @@
+#include "archive.h"
+
+#include "trace.h"
+
+#include <SDL3/SDL.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <stdexcept>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+
+static constexpr std::uint32_t block_magic = 0x4146414d; // `MAFA`
+static constexpr std::uint32_t format_version = 1;
+static constexpr std::size_t block_header_size = sizeof(std::uint32_t) * 4;
+
+// Compact the file when there are this many small blocks.
+static constexpr int max_small_blocks = 64;
+
+// Reject larger blocks as corrupted. A constant column takes no space, so the size of the data doesn't limit this.
+static constexpr std::size_t max_rows_per_block = 1 << 24;
+
+ArchivedGame MakeArchivedGame(const State &state, std::int64_t time)
+{
+    ArchivedGame ret;
+    ret.time = time;
+    ret.num_players = int(state.days.front().players.Size());
+    ret.num_days = int(state.days.size());
+
+    const PlayerTable &last_players = state.days.back().players;
+
+    int num_factions_left = 0;
+    for (int i = 0; i < int(Faction::_count); i++)
+    {
+        if (last_players.faction_counts[std::size_t(i)] > 0)
+        {
+            num_factions_left++;
+            ret.winner = i;
+        }
+    }
+    if (num_factions_left != 1)
+        ret.winner = int(Faction::_count);
+
+    // The players in the order of their first appearance. The rest of the data is from their last appearance.
+    std::unordered_map<int, std::size_t> rows_by_id;
+    for (std::size_t day_index = 0; day_index < state.days.size(); day_index++)
+    {
+        const PlayerTable &players = state.days[day_index].players;
+        for (std::size_t i = 0; i < players.Size(); i++)
+        {
+            const Player pl = players.Get(i);
+            const auto [iter, is_new] = rows_by_id.try_emplace(pl.id, ret.players.size());
+            if (is_new)
+                ret.players.emplace_back();
+
+            ArchivedPlayer &row = ret.players[iter->second];
+            row.name = state.names[pl.name];
+            row.role = pl.role;
+            row.last_day = int(day_index);
+            row.times_targeted = {
+                pl.times_targeted_by_captain,
+                pl.times_targeted_by_sheriff,
+                pl.times_targeted_by_prostitute,
+                pl.times_targeted_by_mafia_boss,
+            };
+        }
+    }
+
+    for (std::size_t i = 0; i < last_players.Size(); i++)
+        ret.players[rows_by_id.at(last_players.ids[i])].survived = true;
+
+    return ret;
+}
+
+// An integer column is `[signed varint min][u8 bit width][u64 words]`, the values minus the minimum are packed into the words, lowest bits first.
+static void EncodeInts(BinaryWriter &writer, std::span<const std::int64_t> values)
+{
+    std::int64_t min = 0;
+    std::int64_t max = 0;
+    if (!values.empty())
+    {
+        const auto [min_iter, max_iter] = std::minmax_element(values.begin(), values.end());
+        min = *min_iter;
+        max = *max_iter;
+    }
+    const int bits = int(std::bit_width(std::uint64_t(max) - std::uint64_t(min)));
+
+    writer.WriteSignedVarint(min);
+    writer.Write(std::uint8_t(bits));
+    if (bits == 0)
+        return;
+
+    std::uint64_t word = 0;
+    int used_bits = 0;
+    for (std::int64_t value : values)
+    {
+        const std::uint64_t offset = std::uint64_t(value) - std::uint64_t(min);
+        word |= offset << used_bits;
+        if (used_bits + bits >= 64)
+        {
+            writer.Write(word);
+            word = used_bits == 0 ? 0 : offset >> (64 - used_bits);
+            used_bits += bits - 64;
+        }
+        else
+        {
+            used_bits += bits;
+        }
+    }
+    if (used_bits > 0)
+        writer.Write(word);
+}
+
+void DecodeArchiveInts(std::span<const unsigned char> column, std::size_t num_rows, std::vector<std::int64_t> &values)
+{
+    BinaryReader reader(column);
+    const std::int64_t min = reader.ReadSignedVarint();
+    const int bits = reader.Read<std::uint8_t>();
+    if (bits > 64)
+        throw std::runtime_error("Invalid bit width in the archive.");
+
+    values.resize(num_rows);
+
+    if (bits == 0)
+    {
+        std::fill(values.begin(), values.end(), min);
+        if (!reader.AtEnd())
+            throw std::runtime_error("Junk at the end of an archive column.");
+        return;
+    }
+
+    const std::size_t num_words = (num_rows * std::size_t(bits) + 63) / 64;
+    const unsigned char *words = reader.ReadBytes(num_words * sizeof(std::uint64_t)).data();
+    if (!reader.AtEnd())
+        throw std::runtime_error("Junk at the end of an archive column.");
+
+    auto LoadWord = [&](std::size_t i)
+    {
+        std::uint64_t ret;
+        std::memcpy(&ret, words + i * sizeof(std::uint64_t), sizeof ret);
+        return ret;
+    };
+
+    const std::uint64_t mask = bits == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << bits) - 1;
+    std::size_t bit_pos = 0;
+    for (std::int64_t &value : values)
+    {
+        const std::size_t word_index = bit_pos / 64;
+        const int bit_offset = int(bit_pos % 64);
+        std::uint64_t offset = LoadWord(word_index) >> bit_offset;
+        if (bit_offset + bits > 64)
+            offset |= LoadWord(word_index + 1) << (64 - bit_offset);
+        value = std::int64_t(std::uint64_t(min) + (offset & mask));
+        bit_pos += std::size_t(bits);
+    }
+}
+
+// A string column is `[varint dictionary size][strings][integer column of indices into the dictionary]`.
+static void EncodeStrings(BinaryWriter &writer, std::span<const std::string_view> values, std::vector<std::int64_t> &indices_scratch)
+{
+    std::unordered_map<std::string_view, std::int64_t> dictionary;
+    std::vector<std::string_view> dictionary_strings;
+    indices_scratch.clear();
+    for (std::string_view value : values)
+    {
+        const auto [iter, is_new] = dictionary.try_emplace(value, std::int64_t(dictionary_strings.size()));
+        if (is_new)
+            dictionary_strings.push_back(value);
+        indices_scratch.push_back(iter->second);
+    }
+
+    writer.WriteVarint(dictionary_strings.size());
+    for (std::string_view str : dictionary_strings)
+        writer.WriteString(str);
+    EncodeInts(writer, indices_scratch);
+}
+
+void DecodeArchiveStrings(std::span<const unsigned char> column, std::size_t num_rows, std::vector<std::string> &dictionary, std::vector<std::int64_t> &indices)
+{
+    BinaryReader reader(column);
+    dictionary.resize(reader.ReadIndex(column.size() + 1));
+    for (std::string &str : dictionary)
+        str = reader.ReadString();
+
+    DecodeArchiveInts(column.subspan(reader.Position()), num_rows, indices);
+    for (std::int64_t index : indices)
+    {
+        if (std::uint64_t(index) >= dictionary.size())
+            throw std::runtime_error("Invalid string index in the archive.");
+    }
+}
+
+void WriteArchiveBlock(BinaryWriter &writer, std::span<const ArchivedGame> games)
+{
+    std::size_t num_rows = 0;
+    for (const ArchivedGame &game : games)
+        num_rows += game.players.size();
+
+    BinaryWriter body;
+    body.WriteVarint(games.size());
+    body.WriteVarint(num_rows);
+
+    BinaryWriter column;
+    std::vector<std::int64_t> ints;
+    std::vector<std::int64_t> scratch;
+
+    auto FinishColumn = [&]
+    {
+        body.WriteVarint(column.Data().size());
+        body.WriteBytes(column.Data());
+        column.Clear();
+    };
+    auto GameColumn = [&](auto &&get)
+    {
+        ints.clear();
+        for (const ArchivedGame &game : games)
+            ints.push_back(std::int64_t(get(game)));
+        EncodeInts(column, ints);
+        FinishColumn();
+    };
+    auto PlayerColumn = [&](auto &&get)
+    {
+        ints.clear();
+        for (const ArchivedGame &game : games)
+        {
+            for (const ArchivedPlayer &pl : game.players)
+                ints.push_back(std::int64_t(get(pl)));
+        }
+        EncodeInts(column, ints);
+        FinishColumn();
+    };
+
+    // Sync the order with `ArchiveColumn`.
+    GameColumn([](const ArchivedGame &game){return game.time;});
+    GameColumn([](const ArchivedGame &game){return game.num_players;});
+    GameColumn([](const ArchivedGame &game){return game.num_days;});
+    GameColumn([](const ArchivedGame &game){return game.winner;});
+    GameColumn([](const ArchivedGame &game){return game.players.size();});
+
+    std::vector<std::string_view> names;
+    for (const ArchivedGame &game : games)
+    {
+        for (const ArchivedPlayer &pl : game.players)
+            names.push_back(pl.name);
+    }
+    EncodeStrings(column, names, scratch);
+    FinishColumn();
+
+    PlayerColumn([](const ArchivedPlayer &pl){return pl.role;});
+    PlayerColumn([](const ArchivedPlayer &pl){return pl.survived;});
+    PlayerColumn([](const ArchivedPlayer &pl){return pl.last_day;});
+    for (std::size_t i = 0; i < std::size_t(Targeting::_count); i++)
+        PlayerColumn([&](const ArchivedPlayer &pl){return pl.times_targeted[i];});
+
+    writer.Write<std::uint32_t>(block_magic);
+    writer.Write<std::uint32_t>(format_version);
+    writer.Write<std::uint32_t>(std::uint32_t(body.Data().size()));
+    writer.Write<std::uint32_t>(Checksum(body.Data()));
+    writer.WriteBytes(body.Data());
+}
+
+Archive::Archive(const std::string &path)
+{
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec))
+        return;
+
+    file = MappedFile(path);
+
+    BinaryReader reader(file.Data());
+    while (file.Data().size() - reader.Position() >= block_header_size)
+    {
+        const std::uint32_t magic = reader.Read<std::uint32_t>();
+        const std::uint32_t version = reader.Read<std::uint32_t>();
+        if (magic != block_magic || version != format_version)
+        {
+            if (blocks.empty())
+                throw std::runtime_error("Unknown archive format.");
+            break; // A torn block.
+        }
+        const std::uint32_t size = reader.Read<std::uint32_t>();
+        const std::uint32_t checksum = reader.Read<std::uint32_t>();
+        if (size > file.Data().size() - reader.Position())
+            break; // A torn block.
+        const std::span<const unsigned char> body = reader.ReadBytes(size);
+        if (Checksum(body) != checksum)
+            break; // A torn block.
+
+        BinaryReader body_reader(body);
+        Block &block = blocks.emplace_back();
+        block.num_games = std::size_t(body_reader.ReadVarint());
+        block.num_rows = std::size_t(body_reader.ReadVarint());
+        if (block.num_games > max_rows_per_block || block.num_rows > max_rows_per_block)
+            throw std::runtime_error("Too many rows in an archive block.");
+        for (std::span<const unsigned char> &column : block.columns)
+            column = body_reader.ReadBytes(body_reader.ReadIndex(size + 1));
+        if (!body_reader.AtEnd())
+            throw std::runtime_error("Junk at the end of an archive block.");
+
+        valid_size = reader.Position();
+    }
+}
+
+// The decoded columns of a block. Reused between blocks, to avoid allocations.
+struct ArchiveBlockColumns
+{
+    std::array<std::vector<std::int64_t>, int(ArchiveColumn::_count)> ints;
+    std::vector<std::string> names;
+
+    void Decode(const Archive::Block &block, ArchiveColumn column)
+    {
+        const bool per_game = column < ArchiveColumn::player_name;
+        std::vector<std::int64_t> &values = ints[std::size_t(column)];
+        const std::span<const unsigned char> data = block.columns[std::size_t(column)];
+        const std::size_t num_rows = per_game ? block.num_games : block.num_rows;
+
+        if (column == ArchiveColumn::player_name)
+            DecodeArchiveStrings(data, num_rows, names, values);
+        else
+            DecodeArchiveInts(data, num_rows, values);
+    }
+
+    [[nodiscard]] const std::vector<std::int64_t> &operator[](ArchiveColumn column) const
+    {
+        return ints[std::size_t(column)];
+    }
+};
+
+// Throws if the per-game row counts don't add up to the number of player rows.
+static void ValidateRowCounts(const Archive::Block &block, const ArchiveBlockColumns &columns)
+{
+    std::uint64_t total = 0;
+    for (std::int64_t count : columns[ArchiveColumn::game_num_rows])
+    {
+        if (count < 0)
+            throw std::runtime_error("Invalid row count in the archive.");
+        total += std::uint64_t(count);
+    }
+    if (total != block.num_rows)
+        throw std::runtime_error("Mismatched row counts in the archive.");
+}
+
+void ReadArchivedGames(const Archive::Block &block, std::vector<ArchivedGame> &games)
+{
+    ArchiveBlockColumns columns;
+    for (int i = 0; i < int(ArchiveColumn::_count); i++)
+        columns.Decode(block, ArchiveColumn(i));
+    ValidateRowCounts(block, columns);
+
+    std::size_t row = 0;
+    for (std::size_t i = 0; i < block.num_games; i++)
+    {
+        ArchivedGame &game = games.emplace_back();
+        game.time = columns[ArchiveColumn::game_time][i];
+        game.num_players = int(columns[ArchiveColumn::game_num_players][i]);
+        game.num_days = int(columns[ArchiveColumn::game_num_days][i]);
+        game.winner = int(columns[ArchiveColumn::game_winner][i]);
+
+        const std::size_t num_rows = std::size_t(columns[ArchiveColumn::game_num_rows][i]);
+        for (std::size_t j = 0; j < num_rows; j++, row++)
+        {
+            ArchivedPlayer &pl = game.players.emplace_back();
+            pl.name = columns.names[std::size_t(columns[ArchiveColumn::player_name][row])];
+            pl.role = Role(columns[ArchiveColumn::player_role][row]);
+            pl.survived = columns[ArchiveColumn::player_survived][row] != 0;
+            pl.last_day = int(columns[ArchiveColumn::player_last_day][row]);
+            for (std::size_t k = 0; k < std::size_t(Targeting::_count); k++)
+                pl.times_targeted[k] = int(columns[ArchiveColumn(int(ArchiveColumn::player_times_targeted_by_captain) + int(k))][row]);
+        }
+    }
+}
+
+void CorrelationSums::Merge(const CorrelationSums &other)
+{
+    n += other.n;
+    sum_x += other.sum_x;
+    sum_y += other.sum_y;
+    sum_xx += other.sum_xx;
+    sum_yy += other.sum_yy;
+    sum_xy += other.sum_xy;
+}
+
+double CorrelationSums::Coefficient() const
+{
+    const double cov = double(n) * double(sum_xy) - double(sum_x) * double(sum_y);
+    const double var_x = double(n) * double(sum_xx) - double(sum_x) * double(sum_x);
+    const double var_y = double(n) * double(sum_yy) - double(sum_y) * double(sum_y);
+    if (var_x <= 0 || var_y <= 0)
+        return 0;
+    return cov / std::sqrt(var_x * var_y);
+}
+
+void ArchiveStats::Merge(const ArchiveStats &other)
+{
+    num_games += other.num_games;
+    num_players += other.num_players;
+
+    for (std::size_t i = 0; i < games_won.size(); i++)
+    {
+        for (std::size_t j = 0; j < games_won[i].size(); j++)
+            games_won[i][j] += other.games_won[i][j];
+    }
+
+    sheriff_checks += other.sheriff_checks;
+    sheriff_hits += other.sheriff_hits;
+
+    for (std::size_t i = 0; i < targeting.size(); i++)
+    {
+        for (std::size_t j = 0; j <= max_times_targeted; j++)
+        {
+            targeting[i].players[j] += other.targeting[i].players[j];
+            targeting[i].survived[j] += other.targeting[i].survived[j];
+        }
+        targeting[i].correlation.Merge(other.targeting[i].correlation);
+    }
+}
+
+static void QueryBlock(const Archive::Block &block, const ArchiveQuery &query, ArchiveBlockColumns &columns, ArchiveStats &stats)
+{
+    // Filter the games first, and skip the player columns if nothing matches.
+    columns.Decode(block, ArchiveColumn::game_time);
+    columns.Decode(block, ArchiveColumn::game_num_players);
+    const std::vector<std::int64_t> &times = columns[ArchiveColumn::game_time];
+    const std::vector<std::int64_t> &num_players = columns[ArchiveColumn::game_num_players];
+
+    auto GameMatches = [&](std::size_t i)
+    {
+        return num_players[i] >= query.min_players && num_players[i] <= query.max_players && times[i] >= query.min_time && times[i] <= query.max_time;
+    };
+
+    bool any_match = false;
+    for (std::size_t i = 0; i < block.num_games && !any_match; i++)
+        any_match = GameMatches(i);
+    if (!any_match)
+        return;
+
+    for (ArchiveColumn column : {ArchiveColumn::game_winner, ArchiveColumn::game_num_rows, ArchiveColumn::player_role, ArchiveColumn::player_survived})
+        columns.Decode(block, column);
+    for (int i = 0; i < int(Targeting::_count); i++)
+        columns.Decode(block, ArchiveColumn(int(ArchiveColumn::player_times_targeted_by_captain) + i));
+    ValidateRowCounts(block, columns);
+
+    const std::vector<std::int64_t> &winners = columns[ArchiveColumn::game_winner];
+    const std::vector<std::int64_t> &num_rows = columns[ArchiveColumn::game_num_rows];
+    const std::vector<std::int64_t> &roles = columns[ArchiveColumn::player_role];
+    const std::vector<std::int64_t> &survived = columns[ArchiveColumn::player_survived];
+    const std::vector<std::int64_t> &times_checked_by_sheriff = columns[ArchiveColumn::player_times_targeted_by_sheriff];
+
+    for (std::int64_t role : roles)
+    {
+        if (role < 0 || role >= int(Role::_count))
+            throw std::runtime_error("Invalid role in the archive.");
+    }
+
+    std::size_t row_begin = 0;
+    for (std::size_t i = 0; i < block.num_games; i++)
+    {
+        const std::size_t row_end = row_begin + std::size_t(num_rows[i]);
+        if (!GameMatches(i))
+        {
+            row_begin = row_end;
+            continue;
+        }
+
+        if (winners[i] < 0 || winners[i] > int(Faction::_count))
+            throw std::runtime_error("Invalid winner in the archive.");
+
+        stats.num_games++;
+        stats.num_players += num_rows[i];
+        stats.games_won[std::size_t(std::clamp<std::int64_t>(num_players[i], 0, ArchiveStats::max_player_count))][std::size_t(winners[i])]++;
+
+        // The sheriff detects mafia, or the killer if there's no mafia in the game.
+        bool have_mafia = false;
+        for (std::size_t row = row_begin; row < row_end && !have_mafia; row++)
+            have_mafia = RoleToFaction(Role(roles[row])) == Faction::mafia;
+        const Faction sheriff_target = have_mafia ? Faction::mafia : Faction::killer;
+
+        for (std::size_t row = row_begin; row < row_end; row++)
+        {
+            stats.sheriff_checks += times_checked_by_sheriff[row];
+            if (RoleToFaction(Role(roles[row])) == sheriff_target)
+                stats.sheriff_hits += times_checked_by_sheriff[row];
+
+            for (std::size_t k = 0; k < std::size_t(Targeting::_count); k++)
+            {
+                const std::int64_t times = columns[ArchiveColumn(int(ArchiveColumn::player_times_targeted_by_captain) + int(k))][row];
+                ArchiveStats::TargetingStats &target_stats = stats.targeting[k];
+                const std::size_t bucket = std::size_t(std::clamp<std::int64_t>(times, 0, ArchiveStats::max_times_targeted));
+                target_stats.players[bucket]++;
+                target_stats.survived[bucket] += survived[row];
+                target_stats.correlation.Add(times, survived[row]);
+            }
+        }
+
+        row_begin = row_end;
+    }
+}
+
+ArchiveStats RunArchiveQuery(const Archive &archive, const ArchiveQuery &query, int num_threads)
+{
+    TRACE_ZONE("RunArchiveQuery");
+
+    const std::vector<Archive::Block> &blocks = archive.Blocks();
+
+    if (num_threads <= 0)
+        num_threads = int(std::max(1u, std::thread::hardware_concurrency()));
+    num_threads = std::max(1, std::min(num_threads, int(blocks.size())));
+    const std::size_t thread_count = std::size_t(num_threads);
+
+    std::vector<ArchiveStats> partial_stats(thread_count);
+    std::vector<std::exception_ptr> errors(thread_count);
+    std::atomic<std::size_t> next_block = 0;
+
+    auto Worker = [&](std::size_t thread_index)
+    {
+        try
+        {
+            ArchiveBlockColumns columns;
+            std::size_t i;
+            while ((i = next_block.fetch_add(1, std::memory_order_relaxed)) < blocks.size())
+                QueryBlock(blocks[i], query, columns, partial_stats[thread_index]);
+        }
+        catch (...)
+        {
+            errors[thread_index] = std::current_exception();
+        }
+    };
+
+    if (num_threads == 1)
+    {
+        Worker(0);
+    }
+    else
+    {
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0; i < thread_count; i++)
+            threads.emplace_back(Worker, i);
+        for (std::thread &thread : threads)
+            thread.join();
+    }
+
+    for (const std::exception_ptr &error : errors)
+    {
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    ArchiveStats ret;
+    for (const ArchiveStats &stats : partial_stats)
+        ret.Merge(stats);
+    return ret;
+}
+
+ArchiveWriter::ArchiveWriter(std::string path)
+    : path(std::move(path))
+{
+    thread = std::thread([this]{ThreadFunc();});
+}
+
+ArchiveWriter::~ArchiveWriter()
+{
+    {
+        std::lock_guard lock(mutex);
+        stop = true;
+    }
+    cond.notify_one();
+    thread.join();
+}
+
+void ArchiveWriter::Append(ArchivedGame game)
+{
+    {
+        std::lock_guard lock(mutex);
+        pending_games.push_back(std::move(game));
+    }
+    cond.notify_one();
+}
+
+void ArchiveWriter::Flush()
+{
+    std::unique_lock lock(mutex);
+    const int target = ++flush_requests;
+    cond.notify_one();
+    flushed_cond.wait(lock, [&]{return flushes_done >= target;});
+}
+
+void ArchiveWriter::WriteGames(std::span<const ArchivedGame> games)
+{
+    BinaryWriter writer;
+    for (std::size_t i = 0; i < games.size(); i += games_per_block)
+    {
+        const std::span<const ArchivedGame> block_games = games.subspan(i, std::min(games_per_block, games.size() - i));
+        WriteArchiveBlock(writer, block_games);
+        if (block_games.size() < games_per_block)
+            num_small_blocks++;
+    }
+
+    SDL_IOStream *file = SDL_IOFromFile(path.c_str(), "ab");
+    if (!file)
+        throw std::runtime_error("Unable to open the game archive `" + path + "`: " + SDL_GetError());
+    const bool ok = SDL_WriteIO(file, writer.Data().data(), writer.Data().size()) == writer.Data().size() && SDL_FlushIO(file);
+    SDL_CloseIO(file);
+    if (!ok)
+        throw std::runtime_error("Unable to write to the game archive `" + path + "`: " + SDL_GetError());
+}
+
+void ArchiveWriter::Compact()
+{
+    TRACE_ZONE("Archive compaction");
+
+    const std::string temp_path = path + ".tmp";
+
+    {
+        const Archive archive(path);
+
+        SDL_IOStream *file = SDL_IOFromFile(temp_path.c_str(), "wb");
+        if (!file)
+            throw std::runtime_error("Unable to create `" + temp_path + "`: " + SDL_GetError());
+
+        bool ok = true;
+        int new_num_small_blocks = 0;
+        std::vector<ArchivedGame> games;
+        BinaryWriter writer;
+        auto WriteBlocks = [&](bool last)
+        {
+            std::size_t i = 0;
+            for (; i < games.size() && (last || games.size() - i >= games_per_block); i += games_per_block)
+            {
+                const std::size_t count = std::min(games_per_block, games.size() - i);
+                writer.Clear();
+                WriteArchiveBlock(writer, std::span(games).subspan(i, count));
+                ok = ok && SDL_WriteIO(file, writer.Data().data(), writer.Data().size()) == writer.Data().size();
+                if (count < games_per_block)
+                    new_num_small_blocks++;
+            }
+            games.erase(games.begin(), games.begin() + std::ptrdiff_t(std::min(i, games.size())));
+        };
+
+        try
+        {
+            for (const Archive::Block &block : archive.Blocks())
+            {
+                ReadArchivedGames(block, games);
+                WriteBlocks(false);
+            }
+            WriteBlocks(true);
+        }
+        catch (...)
+        {
+            SDL_CloseIO(file);
+            throw;
+        }
+
+        ok = SDL_FlushIO(file) && ok;
+        ok = SDL_CloseIO(file) && ok;
+        if (!ok)
+            throw std::runtime_error("Unable to write `" + temp_path + "`: " + SDL_GetError());
+
+        num_small_blocks = new_num_small_blocks;
+    }
+
+    // Atomically replace the old file, so a crash here doesn't lose anything.
+    std::filesystem::rename(temp_path, path);
+}
+
+void ArchiveWriter::ThreadFunc()
+{
+    TRACE_THREAD_NAME("Archive");
+
+    // Count the small blocks, and cut off the torn block at the end, if any.
+    try
+    {
+        std::size_t valid_size = 0;
+        {
+            const Archive archive(path);
+            for (const Archive::Block &block : archive.Blocks())
+            {
+                if (block.num_games < games_per_block)
+                    num_small_blocks++;
+            }
+            valid_size = archive.ValidSize();
+        }
+
+        std::error_code ec;
+        const std::uintmax_t file_size = std::filesystem::file_size(path, ec);
+        if (!ec && file_size > valid_size)
+        {
+            SDL_Log("Cutting off %d bytes of a torn block from the game archive.", int(file_size - valid_size));
+            std::filesystem::resize_file(path, valid_size);
+        }
+    }
+    catch (std::exception &e)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Unable to open the game archive: %s", e.what());
+    }
+
+    std::unique_lock lock(mutex);
+
+    std::vector<ArchivedGame> games;
+
+    while (true)
+    {
+        cond.wait(lock, [&]{return stop || flush_requests > flushes_done || !pending_games.empty();});
+
+        games.clear();
+        games.swap(pending_games);
+        const int flush_target = flush_requests;
+        const bool stopping = stop;
+
+        lock.unlock();
+
+        if (!games.empty())
+        {
+            try
+            {
+                TRACE_ZONE("Archive write");
+                WriteGames(games);
+                if (num_small_blocks >= max_small_blocks)
+                    Compact();
+            }
+            catch (std::exception &e)
+            {
+                // There's nobody to report this to. Those games just won't be in the statistics.
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s", e.what());
+            }
+        }
+
+        lock.lock();
+
+        flushes_done = flush_target;
+        flushed_cond.notify_all();
+
+        if (stopping && pending_games.empty())
+            break;
+    }
+}
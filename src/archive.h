@@ -0,0 +1,246 @@
+#pragma once
+
+#include "binary_io.h"
+#include "mapped_file.h"
+#include "state.h"
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+// An archive of finished games, for the season statistics.
+//
+// The file is a sequence of blocks, each block stores a batch of games column by column (see `ArchiveColumn`).
+// Integer columns are stored as offsets from the block minimum, bit-packed to the width of the largest offset. Strings go through a per-block dictionary.
+// New games are appended as new blocks. When too many small blocks accumulate, the file is rewritten with large blocks.
+// A torn block at the end (from a crash mid-write) is ignored, and cut off before appending more.
+// The queries map the file into memory, and scan the blocks on all cores.
+
+// What players can be targeted by. Sync with `Player::times_targeted_by_...`.
+enum class Targeting
+{
+    captain,
+    sheriff,
+    prostitute,
+    mafia_boss,
+    _count [[maybe_unused]],
+};
+
+// One player of an archived game. Every player that took part in the game is here, including the ones that were removed before the end.
+struct ArchivedPlayer
+{
+    std::string name;
+    Role role = Role::none;
+    // Whether the player is still at the table on the last day.
+    bool survived = false;
+    // The last day the player was at the table.
+    int last_day = 0;
+    std::array<int, int(Targeting::_count)> times_targeted{};
+
+    [[nodiscard]] bool operator==(const ArchivedPlayer &) const = default;
+};
+
+struct ArchivedGame
+{
+    // Seconds since the Unix epoch, when the game was archived.
+    std::int64_t time = 0;
+    // The number of players on the first day.
+    int num_players = 0;
+    int num_days = 0;
+    // The faction that is the only one left on the last day. `Faction::_count` if there's more than one or none.
+    int winner = int(Faction::_count);
+    std::vector<ArchivedPlayer> players;
+
+    [[nodiscard]] bool operator==(const ArchivedGame &) const = default;
+};
+
+// Summarizes a finished round.
+[[nodiscard]] ArchivedGame MakeArchivedGame(const State &state, std::int64_t time);
+
+// Appends a block with those games.
+void WriteArchiveBlock(BinaryWriter &writer, std::span<const ArchivedGame> games);
+
+enum class ArchiveColumn
+{
+    // One row per game: [
+    game_time,
+    game_num_players,
+    game_num_days,
+    game_winner,
+    game_num_rows, // The number of player rows of this game.
+    // ]
+
+    // One row per player: [
+    player_name,
+    player_role,
+    player_survived,
+    player_last_day,
+    player_times_targeted_by_captain,
+    player_times_targeted_by_sheriff,
+    player_times_targeted_by_prostitute,
+    player_times_targeted_by_mafia_boss,
+    // ]
+
+    _count [[maybe_unused]],
+};
+
+// A read-only view of an archive file.
+class Archive
+{
+  public:
+    struct Block
+    {
+        std::size_t num_games = 0;
+        std::size_t num_rows = 0;
+        std::array<std::span<const unsigned char>, int(ArchiveColumn::_count)> columns;
+    };
+
+  private:
+    MappedFile file;
+    std::vector<Block> blocks;
+    // The size of the valid blocks. The rest of the file, if any, is a torn block.
+    std::size_t valid_size = 0;
+
+  public:
+    Archive() {}
+
+    // Maps the file and reads the block headers. A missing file counts as an empty archive. Throws on other errors.
+    explicit Archive(const std::string &path);
+
+    [[nodiscard]] const std::vector<Block> &Blocks() const
+    {
+        return blocks;
+    }
+
+    [[nodiscard]] std::size_t ValidSize() const
+    {
+        return valid_size;
+    }
+};
+
+// Those decode the columns of a block. They reuse the vectors, and throw on invalid data.
+void DecodeArchiveInts(std::span<const unsigned char> column, std::size_t num_rows, std::vector<std::int64_t> &values);
+void DecodeArchiveStrings(std::span<const unsigned char> column, std::size_t num_rows, std::vector<std::string> &dictionary, std::vector<std::int64_t> &indices);
+
+// Decodes a whole block back into games.
+void ReadArchivedGames(const Archive::Block &block, std::vector<ArchivedGame> &games);
+
+struct ArchiveQuery
+{
+    // Only count games with this many players on the first day.
+    int min_players = 0;
+    int max_players = std::numeric_limits<int>::max();
+    // Only count games archived in this time range, in seconds since the Unix epoch.
+    std::int64_t min_time = std::numeric_limits<std::int64_t>::min();
+    std::int64_t max_time = std::numeric_limits<std::int64_t>::max();
+};
+
+// Sums for the Pearson correlation between two variables. Integer sums, so that merging them is exact.
+struct CorrelationSums
+{
+    std::int64_t n = 0;
+    std::int64_t sum_x = 0;
+    std::int64_t sum_y = 0;
+    std::int64_t sum_xx = 0;
+    std::int64_t sum_yy = 0;
+    std::int64_t sum_xy = 0;
+
+    void Add(std::int64_t x, std::int64_t y)
+    {
+        n++;
+        sum_x += x;
+        sum_y += y;
+        sum_xx += x * x;
+        sum_yy += y * y;
+        sum_xy += x * y;
+    }
+
+    void Merge(const CorrelationSums &other);
+
+    // Returns 0 if one of the variables is constant.
+    [[nodiscard]] double Coefficient() const;
+};
+
+struct ArchiveStats
+{
+    std::int64_t num_games = 0;
+    std::int64_t num_players = 0;
+
+    // Games with more players are counted in the last bucket.
+    static constexpr int max_player_count = 30;
+    // `games_won[num_players][faction]`. The faction `Faction::_count` means no winner.
+    std::array<std::array<std::int64_t, int(Faction::_count) + 1>, max_player_count + 1> games_won{};
+
+    // How many times the sheriff checked someone, and how many of those were right (see `Role::sheriff`).
+    std::int64_t sheriff_checks = 0;
+    std::int64_t sheriff_hits = 0;
+
+    // The players that were targeted 0, 1, 2, or 3+ times.
+    static constexpr int max_times_targeted = 3;
+    struct TargetingStats
+    {
+        std::array<std::int64_t, max_times_targeted + 1> players{};
+        std::array<std::int64_t, max_times_targeted + 1> survived{};
+        // X is the number of times targeted, Y is 1 if survived.
+        CorrelationSums correlation;
+    };
+    std::array<TargetingStats, int(Targeting::_count)> targeting{};
+
+    void Merge(const ArchiveStats &other);
+};
+
+// Scans the archive on `num_threads` threads, or on all cores if it's 0. Throws on invalid data.
+[[nodiscard]] ArchiveStats RunArchiveQuery(const Archive &archive, const ArchiveQuery &query, int num_threads = 0);
+
+// Appends games to an archive file on a background thread, and compacts it when needed.
+class ArchiveWriter
+{
+    std::string path;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::condition_variable flushed_cond;
+
+    // Those are protected by the mutex: [
+    std::vector<ArchivedGame> pending_games;
+    int flush_requests = 0;
+    int flushes_done = 0;
+    bool stop = false;
+    // ]
+
+    // Only used by the thread.
+    // The number of blocks smaller than `games_per_block`. When there are too many, we compact the file.
+    int num_small_blocks = 0;
+
+    std::thread thread;
+
+    void ThreadFunc();
+    void WriteGames(std::span<const ArchivedGame> games);
+    void Compact();
+
+  public:
+    // Write this many games per block when compacting.
+    static constexpr std::size_t games_per_block = 1024;
+
+    ArchiveWriter(std::string path);
+    ArchiveWriter(const ArchiveWriter &) = delete;
+    ArchiveWriter &operator=(const ArchiveWriter &) = delete;
+    // Writes everything that's still pending.
+    ~ArchiveWriter();
+
+    [[nodiscard]] const std::string &Path() const
+    {
+        return path;
+    }
+
+    void Append(ArchivedGame game);
+
+    // Blocks until everything appended so far is written.
+    void Flush();
+};
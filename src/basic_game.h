@@ -4,4 +4,7 @@ struct BasicGame
 {
     virtual ~BasicGame() = default;
     virtual void Tick() = 0;
+
+    // Makes sure the session is written to disk. Called when the app might get killed soon.
+    virtual void Persist() {}
 };
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Those read and write our binary formats (the session journal and so on).
+// Fixed-size values are stored in the native byte order, we don't care about moving files between machines with different endianness.
+
+class BinaryWriter
+{
+    std::vector<unsigned char> data;
+
+  public:
+    [[nodiscard]] const std::vector<unsigned char> &Data() const
+    {
+        return data;
+    }
+
+    [[nodiscard]] std::vector<unsigned char> &Data()
+    {
+        return data;
+    }
+
+    // Clears the data, but keeps the capacity.
+    void Clear()
+    {
+        data.clear();
+    }
+
+    template <typename T> requires std::is_trivially_copyable_v<T>
+    void Write(const T &value)
+    {
+        const std::size_t pos = data.size();
+        data.resize(pos + sizeof(T));
+        std::memcpy(data.data() + pos, &value, sizeof(T));
+    }
+
+    void WriteBytes(std::span<const unsigned char> bytes)
+    {
+        data.insert(data.end(), bytes.begin(), bytes.end());
+    }
+
+    // LEB128. Small numbers take a single byte.
+    void WriteVarint(std::uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            data.push_back((unsigned char)(value | 0x80));
+            value >>= 7;
+        }
+        data.push_back((unsigned char)value);
+    }
+
+    // Zigzag encoding on top of `WriteVarint()`, so that small negative numbers are small too.
+    void WriteSignedVarint(std::int64_t value)
+    {
+        WriteVarint((std::uint64_t(value) << 1) ^ std::uint64_t(value >> 63));
+    }
+
+    void WriteString(std::string_view str)
+    {
+        WriteVarint(str.size());
+        data.insert(data.end(), str.begin(), str.end());
+    }
+};
+
+// Throws `std::runtime_error` if the input is truncated or otherwise invalid.
+class BinaryReader
+{
+    std::span<const unsigned char> data;
+    std::size_t pos = 0;
+
+  public:
+    BinaryReader(std::span<const unsigned char> data) : data(data) {}
+
+    [[nodiscard]] bool AtEnd() const
+    {
+        return pos == data.size();
+    }
+
+    [[nodiscard]] std::size_t Position() const
+    {
+        return pos;
+    }
+
+    [[nodiscard]] std::size_t RemainingBytes() const
+    {
+        return data.size() - pos;
+    }
+
+    [[nodiscard]] std::span<const unsigned char> ReadBytes(std::size_t size)
+    {
+        if (size > data.size() - pos)
+            throw std::runtime_error("Unexpected end of binary data.");
+        std::span<const unsigned char> ret = data.subspan(pos, size);
+        pos += size;
+        return ret;
+    }
+
+    template <typename T> requires std::is_trivially_copyable_v<T>
+    [[nodiscard]] T Read()
+    {
+        T ret;
+        std::memcpy(&ret, ReadBytes(sizeof(T)).data(), sizeof(T));
+        return ret;
+    }
+
+    [[nodiscard]] std::uint64_t ReadVarint()
+    {
+        std::uint64_t ret = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            const unsigned char byte = ReadBytes(1)[0];
+            ret |= std::uint64_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return ret;
+        }
+        throw std::runtime_error("Invalid varint in binary data.");
+    }
+
+    [[nodiscard]] std::int64_t ReadSignedVarint()
+    {
+        const std::uint64_t value = ReadVarint();
+        return std::int64_t(value >> 1) ^ -std::int64_t(value & 1);
+    }
+
+    // Reads a varint and checks that it's less than `limit`.
+    [[nodiscard]] std::size_t ReadIndex(std::size_t limit)
+    {
+        const std::uint64_t value = ReadVarint();
+        if (value >= limit)
+            throw std::runtime_error("Out of range index in binary data.");
+        return std::size_t(value);
+    }
+
+    [[nodiscard]] std::string ReadString()
+    {
+        std::span<const unsigned char> bytes = ReadBytes(ReadIndex(RemainingBytes() + 1));
+        return std::string(bytes.begin(), bytes.end());
+    }
+};
+
+// FNV-1a. Used to detect torn or corrupted records.
+[[nodiscard]] inline std::uint32_t Checksum(std::span<const unsigned char> bytes)
+{
+    std::uint32_t ret = 2166136261u;
+    for (unsigned char byte : bytes)
+    {
+        ret ^= byte;
+        ret *= 16777619u;
+    }
+    return ret;
+}
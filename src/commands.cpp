@@ -0,0 +1,235 @@
+#include "commands.h"
+
+#include "binary_io.h"
+
+#include <stdexcept>
+#include <utility>
+
+template <typename ...P> struct Overload : P... {using P::operator()...;};
+
+static void WriteTargets(BinaryWriter &writer, const std::vector<int> &targets)
+{
+    writer.WriteVarint(targets.size());
+    for (int target : targets)
+        writer.WriteSignedVarint(target);
+}
+
+[[nodiscard]] static std::vector<int> ReadTargets(BinaryReader &reader)
+{
+    // Each target takes at least one byte, so a corrupted count can't make us allocate more than the data size.
+    std::vector<int> ret(reader.ReadIndex(reader.RemainingBytes() + 1));
+    for (int &target : ret)
+        target = int(reader.ReadSignedVarint());
+    return ret;
+}
+
+void WriteCommand(BinaryWriter &writer, const Command &command)
+{
+    writer.WriteVarint(command.index());
+
+    std::visit(Overload{
+        [&](const Commands::AddPlayer &cmd)
+        {
+            writer.WriteString(cmd.name);
+        },
+        [&](const Commands::RemovePlayer &cmd)
+        {
+            writer.WriteVarint(cmd.index);
+        },
+        [&](const Commands::SetPlayerRole &cmd)
+        {
+            writer.WriteVarint(cmd.index);
+            writer.WriteVarint(std::uint64_t(cmd.role));
+        },
+        [&](const Commands::SetRoleEnabled &cmd)
+        {
+            writer.WriteVarint(std::uint64_t(cmd.role));
+            writer.Write<std::uint8_t>(cmd.enabled);
+        },
+        [&](const Commands::SetActiveRole &cmd)
+        {
+            writer.WriteSignedVarint(cmd.index);
+        },
+        [&](const Commands::SetActiveDay &cmd)
+        {
+            writer.WriteSignedVarint(cmd.index);
+        },
+        [&](const Commands::NextTurn &) {},
+        [&](const Commands::NewGame &) {},
+        [&](const Commands::InsertPlayer &cmd)
+        {
+            writer.WriteVarint(cmd.index);
+            writer.WriteSignedVarint(cmd.player.id);
+            writer.WriteVarint(std::uint64_t(cmd.player.name));
+            writer.WriteVarint(std::uint64_t(cmd.player.role));
+            writer.WriteVarint(std::uint64_t(cmd.player.times_targeted_by_captain));
+            writer.WriteVarint(std::uint64_t(cmd.player.times_targeted_by_sheriff));
+            writer.WriteVarint(std::uint64_t(cmd.player.times_targeted_by_prostitute));
+            writer.WriteVarint(std::uint64_t(cmd.player.times_targeted_by_mafia_boss));
+        },
+        [&](const Commands::RevertTurn &cmd)
+        {
+            writer.WriteSignedVarint(cmd.day_index);
+            writer.WriteSignedVarint(cmd.role_index);
+            writer.Write<std::uint8_t>(cmd.remove_last_day);
+        },
+        [&](const Commands::RestoreRound &cmd)
+        {
+            WriteRound(writer, cmd.round);
+        },
+        [&](const Commands::SetTargets &cmd)
+        {
+            writer.WriteVarint(std::uint64_t(cmd.role));
+            WriteTargets(writer, cmd.old_targets);
+            WriteTargets(writer, cmd.new_targets);
+        },
+        [&](const Commands::StartTournament &cmd)
+        {
+            writer.WriteSignedVarint(cmd.num_tables);
+        },
+        [&](const Commands::NextTournamentRound &) {},
+        [&](const Commands::SwitchTable &cmd)
+        {
+            writer.WriteSignedVarint(cmd.index);
+        },
+        [&](const Commands::EndTournament &) {},
+        [&](const Commands::RestoreTournament &cmd)
+        {
+            WriteTournament(writer, cmd.tournament);
+            writer.WriteVarint(cmd.tables.size());
+            for (const Round &round : cmd.tables)
+                WriteRound(writer, round);
+            writer.WriteSignedVarint(cmd.active_table);
+        },
+    }, command);
+}
+
+Command ReadCommand(BinaryReader &reader)
+{
+    Command ret = [&]<std::size_t ...I>(std::index_sequence<I...>)
+    {
+        const std::size_t index = reader.ReadIndex(sizeof...(I));
+        Command ret;
+        (void)((index == I ? (ret.emplace<I>(), true) : false) || ...);
+        return ret;
+    }(std::make_index_sequence<std::variant_size_v<Command>>{});
+
+    std::visit(Overload{
+        [&](Commands::AddPlayer &cmd)
+        {
+            cmd.name = reader.ReadString();
+        },
+        [&](Commands::RemovePlayer &cmd)
+        {
+            cmd.index = std::size_t(reader.ReadVarint());
+        },
+        [&](Commands::SetPlayerRole &cmd)
+        {
+            cmd.index = std::size_t(reader.ReadVarint());
+            cmd.role = Role(reader.ReadIndex(std::size_t(Role::_count)));
+        },
+        [&](Commands::SetRoleEnabled &cmd)
+        {
+            cmd.role = Role(reader.ReadIndex(std::size_t(Role::_count)));
+            cmd.enabled = reader.Read<std::uint8_t>() != 0;
+        },
+        [&](Commands::SetActiveRole &cmd)
+        {
+            cmd.index = int(reader.ReadSignedVarint());
+        },
+        [&](Commands::SetActiveDay &cmd)
+        {
+            cmd.index = int(reader.ReadSignedVarint());
+        },
+        [&](Commands::NextTurn &) {},
+        [&](Commands::NewGame &) {},
+        [&](Commands::InsertPlayer &cmd)
+        {
+            cmd.index = std::size_t(reader.ReadVarint());
+            cmd.player.id = int(reader.ReadSignedVarint());
+            // The name is validated when applying the command, since the name pool isn't known here.
+            cmd.player.name = NameId(reader.ReadVarint());
+            cmd.player.role = Role(reader.ReadIndex(std::size_t(Role::_count)));
+            cmd.player.times_targeted_by_captain = int(reader.ReadVarint());
+            cmd.player.times_targeted_by_sheriff = int(reader.ReadVarint());
+            cmd.player.times_targeted_by_prostitute = int(reader.ReadVarint());
+            cmd.player.times_targeted_by_mafia_boss = int(reader.ReadVarint());
+        },
+        [&](Commands::RevertTurn &cmd)
+        {
+            cmd.day_index = int(reader.ReadSignedVarint());
+            cmd.role_index = int(reader.ReadSignedVarint());
+            cmd.remove_last_day = reader.Read<std::uint8_t>() != 0;
+        },
+        [&](Commands::RestoreRound &cmd)
+        {
+            cmd.round = ReadRound(reader);
+        },
+        [&](Commands::SetTargets &cmd)
+        {
+            cmd.role = Role(reader.ReadIndex(std::size_t(Role::_count)));
+            cmd.old_targets = ReadTargets(reader);
+            cmd.new_targets = ReadTargets(reader);
+        },
+        [&](Commands::StartTournament &cmd)
+        {
+            cmd.num_tables = int(reader.ReadSignedVarint());
+        },
+        [&](Commands::NextTournamentRound &) {},
+        [&](Commands::SwitchTable &cmd)
+        {
+            cmd.index = int(reader.ReadSignedVarint());
+        },
+        [&](Commands::EndTournament &) {},
+        [&](Commands::RestoreTournament &cmd)
+        {
+            // Whether the tables match the tournament is validated when applying the command.
+            cmd.tournament = ReadTournament(reader);
+            cmd.tables.resize(std::size_t(reader.ReadVarint()));
+            for (Round &round : cmd.tables)
+                round = ReadRound(reader);
+            cmd.active_table = int(reader.ReadSignedVarint());
+        },
+    }, ret);
+
+    return ret;
+}
+
+// The days share their players and actions with the live state, so this only counts the days themselves and the name pool, which is copied.
+[[nodiscard]] static std::size_t RoundMemoryUsage(const Round &round)
+{
+    const State &state = round.state;
+    std::size_t ret = state.days.capacity() * sizeof(Day);
+    for (std::size_t i = 0; i < state.names.Size(); i++)
+        ret += sizeof(std::string) * 2 + state.names[NameId(i)].size();
+    return ret;
+}
+
+std::size_t CommandMemoryUsage(const Command &command)
+{
+    std::size_t ret = sizeof(Command);
+
+    if (auto add = std::get_if<Commands::AddPlayer>(&command))
+    {
+        ret += add->name.capacity();
+    }
+    else if (auto set_targets = std::get_if<Commands::SetTargets>(&command))
+    {
+        ret += (set_targets->old_targets.capacity() + set_targets->new_targets.capacity()) * sizeof(int);
+    }
+    else if (auto restore = std::get_if<Commands::RestoreRound>(&command))
+    {
+        ret += RoundMemoryUsage(restore->round);
+    }
+    else if (auto restore_tournament = std::get_if<Commands::RestoreTournament>(&command))
+    {
+        for (const std::string &player : restore_tournament->tournament.players)
+            ret += sizeof(std::string) + player.capacity();
+        for (const std::vector<std::uint16_t> &seating : restore_tournament->tournament.seatings)
+            ret += sizeof(seating) + seating.capacity() * sizeof(std::uint16_t);
+        for (const Round &round : restore_tournament->tables)
+            ret += sizeof(Round) + RoundMemoryUsage(round);
+    }
+
+    return ret;
+}
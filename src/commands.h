@@ -0,0 +1,141 @@
+#pragma once
+
+#include "state.h"
+#include "tournament.h"
+
+#include <cstddef>
+#include <string>
+#include <variant>
+#include <vector>
+
+class BinaryReader;
+class BinaryWriter;
+
+// All changes to the session go through those commands, so that they can be written to the journal and replayed from it.
+// The player commands act on the current (last) day.
+namespace Commands
+{
+    struct AddPlayer
+    {
+        std::string name;
+    };
+
+    struct RemovePlayer
+    {
+        std::size_t index = 0;
+    };
+
+    struct SetPlayerRole
+    {
+        std::size_t index = 0;
+        Role role{};
+    };
+
+    struct SetRoleEnabled
+    {
+        Role role{};
+        bool enabled = false;
+    };
+
+    // Selects a turn. This is an index into `Settings::role_order`.
+    struct SetActiveRole
+    {
+        int index = 0;
+    };
+
+    // Navigates to a different day.
+    struct SetActiveDay
+    {
+        int index = 0;
+    };
+
+    struct NextTurn {};
+
+    struct NewGame {};
+
+    // The inverse of `RemovePlayer`.
+    struct InsertPlayer
+    {
+        std::size_t index = 0;
+        Player player;
+    };
+
+    // The inverse of `NextTurn`.
+    struct RevertTurn
+    {
+        int day_index = 0;
+        int role_index = 0;
+        // Whether `NextTurn` started a new day.
+        bool remove_last_day = false;
+    };
+
+    // The inverse of `NewGame`. Since the days share most of their data, this is cheap to store.
+    struct RestoreRound
+    {
+        Round round;
+    };
+
+    // Replaces the targets of a role's action. The targets are `Player::id`s, which don't change when other players are removed.
+    // Throws if `old_targets` don't match the current ones, so that the undo history and the journal can't silently diverge from the state.
+    struct SetTargets
+    {
+        Role role{};
+        std::vector<int> old_targets;
+        std::vector<int> new_targets;
+    };
+
+    // Seats the players of the current table at this many tables, and starts a tournament with them.
+    struct StartTournament
+    {
+        int num_tables = 0;
+    };
+
+    // Starts a new game at every table of the tournament, with the players reseated.
+    struct NextTournamentRound {};
+
+    // Switches to another table of the tournament.
+    // Unlike the other navigation, this is undoable: the commands in the history apply to the table that was active when they ran.
+    struct SwitchTable
+    {
+        int index = 0;
+    };
+
+    // Keeps only the current table.
+    struct EndTournament {};
+
+    // The inverse of the tournament commands. `tables` has all the tables, including the active one. There's one table if there's no tournament.
+    struct RestoreTournament
+    {
+        Tournament tournament;
+        std::vector<Round> tables;
+        int active_table = 0;
+    };
+}
+
+// Don't reorder those, the index is saved in the journal. Only append new ones.
+using Command = std::variant<
+    Commands::AddPlayer,
+    Commands::RemovePlayer,
+    Commands::SetPlayerRole,
+    Commands::SetRoleEnabled,
+    Commands::SetActiveRole,
+    Commands::SetActiveDay,
+    Commands::NextTurn,
+    Commands::NewGame,
+    Commands::InsertPlayer,
+    Commands::RevertTurn,
+    Commands::RestoreRound,
+    Commands::SetTargets,
+    Commands::StartTournament,
+    Commands::NextTournamentRound,
+    Commands::SwitchTable,
+    Commands::EndTournament,
+    Commands::RestoreTournament
+>;
+
+void WriteCommand(BinaryWriter &writer, const Command &command);
+// Throws on invalid data. Only validates the command itself, not whether it makes sense for the current state.
+[[nodiscard]] Command ReadCommand(BinaryReader &reader);
+
+// Approximately how much memory the command holds, for limiting the undo history size.
+[[nodiscard]] std::size_t CommandMemoryUsage(const Command &command);
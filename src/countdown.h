@@ -0,0 +1,100 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+// A pausable countdown, for the discussions and the speeches. The times are on the `SDL_GetTicksNS()` clock, passed in by the caller.
+// It doesn't need continuous redraws: `NextChange()` tells when the displayed value changes next, to pass to `RequestRedrawAt()`.
+class Countdown
+{
+    std::uint64_t duration_ns = 0;
+    // While running, when it was started or resumed.
+    std::uint64_t resume_time_ns = 0;
+    // How long it ran before that.
+    std::uint64_t elapsed_before_resume_ns = 0;
+    bool active = false;
+    bool running = false;
+    bool deadline_reported = false;
+
+    [[nodiscard]] std::uint64_t Elapsed(std::uint64_t now_ns) const
+    {
+        return elapsed_before_resume_ns + (running && now_ns > resume_time_ns ? now_ns - resume_time_ns : 0);
+    }
+
+  public:
+    static constexpr std::uint64_t never = std::numeric_limits<std::uint64_t>::max();
+
+    void Start(std::uint64_t new_duration_ns, std::uint64_t now_ns)
+    {
+        duration_ns = new_duration_ns;
+        resume_time_ns = now_ns;
+        elapsed_before_resume_ns = 0;
+        active = true;
+        running = true;
+        deadline_reported = false;
+    }
+
+    void Stop()
+    {
+        active = false;
+        running = false;
+    }
+
+    void Pause(std::uint64_t now_ns)
+    {
+        if (!running)
+            return;
+        elapsed_before_resume_ns = Elapsed(now_ns);
+        running = false;
+    }
+
+    void Resume(std::uint64_t now_ns)
+    {
+        if (!active || running)
+            return;
+        resume_time_ns = now_ns;
+        running = true;
+    }
+
+    // Started and not stopped. Possibly paused or expired.
+    [[nodiscard]] bool IsActive() const
+    {
+        return active;
+    }
+
+    [[nodiscard]] bool IsRunning() const
+    {
+        return running;
+    }
+
+    [[nodiscard]] std::uint64_t RemainingNs(std::uint64_t now_ns) const
+    {
+        return duration_ns - std::min(duration_ns, Elapsed(now_ns));
+    }
+
+    // Rounded up, so that this becomes 0 exactly at the deadline.
+    [[nodiscard]] int SecondsLeft(std::uint64_t now_ns) const
+    {
+        return int((RemainingNs(now_ns) + 999'999'999) / 1'000'000'000);
+    }
+
+    // When `SecondsLeft()` changes next (the last change is the deadline itself), or `never` if it's paused or expired.
+    [[nodiscard]] std::uint64_t NextChange(std::uint64_t now_ns) const
+    {
+        const std::uint64_t remaining = RemainingNs(now_ns);
+        if (!running || remaining == 0)
+            return never;
+        const std::uint64_t until_change = remaining % 1'000'000'000;
+        return now_ns + (until_change ? until_change : 1'000'000'000);
+    }
+
+    // Returns true once, on the first call at or after the deadline, while it's running.
+    [[nodiscard]] bool TakeDeadline(std::uint64_t now_ns)
+    {
+        if (!running || deadline_reported || RemainingNs(now_ns) > 0)
+            return false;
+        deadline_reported = true;
+        return true;
+    }
+};
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Returns true if `ptr` is the only owner of its object, so that it can be modified in place.
+// The other owners can be destroyed on other threads (e.g. the days sent to `RoleInference`), and `use_count()` is only a relaxed load.
+// Their refcount decrements are release operations, so the acquire fence makes their last reads of the object happen before our writes.
+template <typename T>
+[[nodiscard]] bool IsOnlyOwner(const std::shared_ptr<T> &ptr)
+{
+    if (ptr.use_count() != 1)
+        return false;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return true;
+}
+
+// A copy-on-write value. Copies share the same object until one of them is modified.
+// A default-constructed `Cow` doesn't allocate until modified, and reads as a value-initialized `T`.
+template <typename T>
+class Cow
+{
+    std::shared_ptr<T> ptr;
+
+  public:
+    Cow() {}
+    Cow(T value) : ptr(std::make_shared<T>(std::move(value))) {}
+
+    [[nodiscard]] const T &operator*() const
+    {
+        if (ptr)
+            return *ptr;
+        static const T empty{};
+        return empty;
+    }
+
+    [[nodiscard]] const T *operator->() const
+    {
+        return &**this;
+    }
+
+    // Returns a mutable reference, cloning the value first if it's shared with other copies.
+    [[nodiscard]] T &Mut()
+    {
+        if (!ptr)
+            ptr = std::make_shared<T>();
+        else if (!IsOnlyOwner(ptr))
+            ptr = std::make_shared<T>(*ptr);
+        return *ptr;
+    }
+
+    // Returns true if this copy shares its object with other copies.
+    [[nodiscard]] bool IsShared() const
+    {
+        return ptr && ptr.use_count() > 1;
+    }
+};
+
+// A copy-on-write array, split into fixed-size chunks.
+// Copying a column costs a single refcount increment. Modifying an element of a shared column clones the list of chunks
+//   (which is `ChunkSize` times smaller than the column itself) and only the one chunk that's being modified.
+template <typename T, std::size_t ChunkSize = 64>
+class CowColumn
+{
+    using Chunk = std::array<T, ChunkSize>;
+
+    Cow<std::vector<std::shared_ptr<Chunk>>> chunks;
+    std::size_t size = 0;
+
+    [[nodiscard]] Chunk &MutChunk(std::size_t chunk_index)
+    {
+        std::shared_ptr<Chunk> &chunk = chunks.Mut()[chunk_index];
+        if (!IsOnlyOwner(chunk))
+            chunk = std::make_shared<Chunk>(*chunk);
+        return *chunk;
+    }
+
+  public:
+    [[nodiscard]] std::size_t Size() const
+    {
+        return size;
+    }
+
+    [[nodiscard]] bool IsEmpty() const
+    {
+        return size == 0;
+    }
+
+    [[nodiscard]] const T &operator[](std::size_t i) const
+    {
+        return (*(*chunks)[i / ChunkSize])[i % ChunkSize];
+    }
+
+    void Set(std::size_t i, T value)
+    {
+        MutChunk(i / ChunkSize)[i % ChunkSize] = std::move(value);
+    }
+
+    void PushBack(T value)
+    {
+        if (size % ChunkSize == 0)
+            chunks.Mut().push_back(std::make_shared<Chunk>());
+        MutChunk(size / ChunkSize)[size % ChunkSize] = std::move(value);
+        size++;
+    }
+
+    // Inserts an element before `i`, shifting the following elements forward. Only the chunks starting from the `i`-th element are cloned.
+    void Insert(std::size_t i, T value)
+    {
+        PushBack(value);
+        for (std::size_t j = size - 1; j > i; j--)
+            Set(j, (*this)[j - 1]);
+        Set(i, std::move(value));
+    }
+
+    // Removes the element at `i`, shifting the following elements back. Only the chunks starting from the `i`-th element are cloned.
+    void Erase(std::size_t i)
+    {
+        for (std::size_t j = i; j + 1 < size; j++)
+            Set(j, (*this)[j + 1]);
+        size--;
+        if (size % ChunkSize == 0)
+            chunks.Mut().pop_back();
+    }
+
+    // Compares the elements. The chunks shared between the two columns are skipped.
+    [[nodiscard]] bool operator==(const CowColumn &other) const
+    {
+        if (size != other.size)
+            return false;
+
+        for (std::size_t i = 0; i < chunks->size(); i++)
+        {
+            const std::shared_ptr<Chunk> &a = (*chunks)[i];
+            const std::shared_ptr<Chunk> &b = (*other.chunks)[i];
+            if (a == b)
+                continue;
+
+            const std::size_t n = std::min(ChunkSize, size - i * ChunkSize);
+            if (!std::equal(a->begin(), a->begin() + n, b->begin()))
+                return false;
+        }
+
+        return true;
+    }
+};
@@ -0,0 +1,98 @@
+#include "draw_fingerprint.h"
+
+#include <imgui.h>
+
+#include <cstddef>
+#include <cstring>
+
+// Hashes 8 bytes at a time. The draw data of a large roster is a few megabytes, so a byte-at-a-time hash would be too slow.
+class DrawDataHasher
+{
+    std::uint64_t state = 0x9e3779b97f4a7c15u;
+
+    void Mix(std::uint64_t value)
+    {
+        state = (state ^ value) * 0xbf58476d1ce4e5b9u;
+        state ^= state >> 31;
+    }
+
+  public:
+    void AddBytes(const void *data, std::size_t size)
+    {
+        const unsigned char *bytes = (const unsigned char *)data;
+        Mix(size);
+
+        while (size >= 8)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, bytes, 8);
+            Mix(word);
+            bytes += 8;
+            size -= 8;
+        }
+
+        if (size > 0)
+        {
+            std::uint64_t word = 0;
+            std::memcpy(&word, bytes, size);
+            Mix(word);
+        }
+    }
+
+    template <typename T>
+    void Add(const T &value)
+    {
+        AddBytes(&value, sizeof(T));
+    }
+
+    template <typename T>
+    void AddVector(const ImVector<T> &vec)
+    {
+        AddBytes(vec.Data, sizeof(T) * std::size_t(vec.Size));
+    }
+
+    [[nodiscard]] std::uint64_t Result() const
+    {
+        return state;
+    }
+};
+
+std::uint64_t DrawDataFingerprint(const ImDrawData &draw_data)
+{
+    DrawDataHasher hasher;
+    hasher.Add(draw_data.DisplayPos);
+    hasher.Add(draw_data.DisplaySize);
+    hasher.Add(draw_data.FramebufferScale);
+
+    for (const ImDrawList *list : draw_data.CmdLists)
+    {
+        hasher.AddVector(list->VtxBuffer);
+        hasher.AddVector(list->IdxBuffer);
+
+        for (const ImDrawCmd &cmd : list->CmdBuffer)
+        {
+            hasher.Add(cmd.ClipRect);
+            hasher.Add(cmd.VtxOffset);
+            hasher.Add(cmd.IdxOffset);
+            hasher.Add(cmd.ElemCount);
+            // Not `GetTexID()`, since the texture might not be created yet, and the IDs aren't stable between runs.
+            hasher.Add(cmd.TexRef._TexData ? ImU64(cmd.TexRef._TexData->UniqueID) : ImU64(cmd.TexRef._TexID));
+            hasher.Add(cmd.UserCallback);
+        }
+    }
+
+    return hasher.Result();
+}
+
+bool HasPendingTextureUpdates(const ImDrawData &draw_data)
+{
+    if (!draw_data.Textures)
+        return false;
+
+    for (const ImTextureData *tex : *draw_data.Textures)
+    {
+        if (tex->Status != ImTextureStatus_OK)
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+struct ImDrawData;
+
+// A hash of everything that affects how the draw data looks: the display rect, the vertices, the indices, the draw commands and their textures.
+// If it's the same as in the previous frame, the frame doesn't need to be rendered again.
+// Doesn't hash the texture contents, check `HasPendingTextureUpdates()` for that.
+[[nodiscard]] std::uint64_t DrawDataFingerprint(const ImDrawData &draw_data);
+
+// Whether any of the textures need to be created, updated or destroyed by the renderer.
+[[nodiscard]] bool HasPendingTextureUpdates(const ImDrawData &draw_data);
@@ -0,0 +1,166 @@
+#include "fonts.h"
+
+#include "startup.h"
+
+#include <imgui.h>
+#include <SDL3/SDL_filesystem.h>
+#include <SDL3/SDL_iostream.h>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#include <SDL3/SDL_log.h>
+
+#include <cstring>
+#endif
+
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+// The font is subset to Latin and Cyrillic at build time, see `project.mk`.
+static constexpr const char *font_filename = "NotoSans.ttf";
+
+// The glyphs to warm up, in order. Those are the ones in our strings and in typical player names.
+static constexpr ImWchar warm_up_ranges[] = {
+    0x0410, 0x044f, // Cyrillic, without the less common letters.
+    0x0401, 0x0401, // Ё
+    0x0451, 0x0451, // ё
+    0x0404, 0x0404, // Є
+    0x0406, 0x0407, // І Ї
+    0x0454, 0x0454, // є
+    0x0456, 0x0457, // і ї
+    0x0490, 0x0491, // Ґ ґ
+    0x0020, 0x007e, // ASCII.
+};
+
+static bool fonts_loaded = false;
+
+#ifndef __EMSCRIPTEN__
+struct FontFile
+{
+    // Can't free this data, ImGui needs it to stay alive.
+    void *data = nullptr;
+    std::size_t size = 0;
+};
+
+// Reads the font file, while the main thread is busy creating the window.
+static StartupStage<FontFile> font_file_stage;
+#endif
+
+#ifdef __EMSCRIPTEN__
+static void FinishDownload()
+{
+    fonts_loaded = true;
+
+    // The main loop is paused while waiting for the font.
+    WakeUpMainLoop();
+}
+
+static void OnFontDownloaded(void *userdata, void *buffer, int size)
+{
+    (void)userdata;
+
+    // Emscripten frees the buffer after this returns, so the atlas gets its own copy.
+    void *data = IM_ALLOC(std::size_t(size));
+    std::memcpy(data, buffer, std::size_t(size));
+    ImGui::GetIO().Fonts->AddFontFromMemoryTTF(data, size);
+
+    FinishDownload();
+}
+
+static void OnFontDownloadFailed(void *userdata)
+{
+    (void)userdata;
+
+    // The built-in font has no Cyrillic, but it's better than nothing at all.
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Unable to download the font `%s`, using the default one.", font_filename);
+    ImGui::GetIO().Fonts->AddFontDefault();
+
+    FinishDownload();
+}
+#endif
+
+void StartLoadingFonts()
+{
+    #if defined(__EMSCRIPTEN__)
+    // Download the font next to the page, without blocking the startup on it.
+    emscripten_async_wget_data(font_filename, nullptr, OnFontDownloaded, OnFontDownloadFailed);
+    #else
+    font_file_stage = StartupStage<FontFile>("reading the font", []
+    {
+        // On Android, `SDL_LoadFile()` reads from the APK assets.
+        #if defined(__ANDROID__)
+        const std::string path = font_filename;
+        #else
+        const std::string path = std::string(SDL_GetBasePath()) + font_filename;
+        #endif
+
+        FontFile ret;
+        ret.data = SDL_LoadFile(path.c_str(), &ret.size);
+        if (!ret.data)
+            throw std::runtime_error("Unable to load the font `" + path + "`: " + SDL_GetError());
+        return ret;
+    });
+    #endif
+}
+
+bool FontsLoaded()
+{
+    #ifndef __EMSCRIPTEN__
+    if (!fonts_loaded && font_file_stage.IsReady())
+    {
+        const FontFile file = font_file_stage.Get();
+
+        // This only parses the font. The glyphs are rasterized on demand, see `WarmUpGlyphs()`.
+        ImFontConfig config;
+        config.FontDataOwnedByAtlas = false;
+        ImGui::GetIO().Fonts->AddFontFromMemoryTTF(file.data, int(file.size), 0, &config);
+
+        fonts_loaded = true;
+    }
+    #endif
+
+    return fonts_loaded;
+}
+
+void LoadFonts()
+{
+    StartLoadingFonts();
+    #ifndef __EMSCRIPTEN__
+    font_file_stage.Wait();
+    (void)FontsLoaded();
+    #endif
+}
+
+bool WarmUpGlyphs()
+{
+    // The position in `warm_up_ranges`.
+    static int range_index = 0;
+    static ImWchar next_char = warm_up_ranges[0];
+
+    // Rasterizing one glyph takes a few microseconds, so this is well below a frame.
+    const int glyphs_per_frame = 32;
+
+    ImFontBaked *baked = ImGui::GetFontBaked();
+
+    for (int i = 0; i < glyphs_per_frame; i++)
+    {
+        if (range_index * 2 >= int(std::size(warm_up_ranges)))
+            return false;
+
+        (void)baked->FindGlyph(next_char);
+
+        if (next_char < warm_up_ranges[range_index * 2 + 1])
+        {
+            next_char++;
+        }
+        else
+        {
+            range_index++;
+            if (range_index * 2 < int(std::size(warm_up_ranges)))
+                next_char = warm_up_ranges[range_index * 2];
+        }
+    }
+
+    return range_index * 2 < int(std::size(warm_up_ranges));
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+// Starts reading the UI font file on a worker thread, or downloading it on Emscripten, and returns immediately.
+// This can be called before the ImGui context exists. The main loop is woken up when the font is ready.
+void StartLoadingFonts();
+
+// Returns true once the font is in the current ImGui context. Don't draw anything before that.
+// Once the file is read, this adds it to the context, so call this on the main thread. Throws on failure.
+[[nodiscard]] bool FontsLoaded();
+
+// Loads the UI font into the current ImGui context, and waits for it. Throws on failure.
+// On Emscripten this only starts downloading the font, and returns immediately. Check `FontsLoaded()` before drawing anything.
+void LoadFonts();
+
+// Rasterizes some of the glyphs we're likely to need, a few per call, so that they don't cause hitches when they first appear on screen.
+// Call this every frame after `ImGui::NewFrame()`. Returns true if there's more work left, then keep drawing frames.
+[[nodiscard]] bool WarmUpGlyphs();
@@ -0,0 +1,110 @@
+#include "frame_stats.h"
+
+#include <imgui.h>
+#include <SDL3/SDL_timer.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+#include <iterator>
+
+FrameStats frame_stats;
+
+static constexpr const char *phase_names[] = {
+    "Events",
+    "New frame",
+    "Tick",
+    "Render",
+    "Draw",
+    "Present",
+};
+static_assert(std::size(phase_names) == std::size_t(FramePhase::_count));
+
+void FrameStats::BeginFrame()
+{
+    last_timestamp = SDL_GetPerformanceCounter();
+}
+
+void FrameStats::EndPhase(FramePhase phase)
+{
+    const std::uint64_t now = SDL_GetPerformanceCounter();
+    current_ms[std::size_t(phase)] = float(double(now - last_timestamp) * 1000 / double(SDL_GetPerformanceFrequency()));
+    last_timestamp = now;
+}
+
+void FrameStats::SkipTime()
+{
+    last_timestamp = SDL_GetPerformanceCounter();
+}
+
+void FrameStats::SkipFrame()
+{
+    skipped_since_last_frame++;
+}
+
+void FrameStats::EndFrame()
+{
+    for (int i = 0; i < int(FramePhase::_count); i++)
+        history_ms[std::size_t(i)][std::size_t(next_index)] = current_ms[std::size_t(i)];
+    history_skipped[std::size_t(next_index)] = skipped_since_last_frame;
+
+    skipped_since_last_frame = 0;
+    current_ms = {};
+    next_index = (next_index + 1) % history_size;
+    num_frames = std::min(num_frames + 1, history_size);
+}
+
+void FrameStats::DrawOverlay() const
+{
+    if (!overlay_visible || num_frames == 0)
+        return;
+
+    const ImGuiViewport &viewport = *ImGui::GetMainViewport();
+    ImGui::SetNextWindowPos(ImVec2(viewport.WorkPos.x + viewport.WorkSize.x, viewport.WorkPos.y), ImGuiCond_Always, ImVec2(1, 0));
+    ImGui::SetNextWindowBgAlpha(0.75f);
+    // No inputs, so that the overlay doesn't get in the way of the game.
+    ImGui::Begin("frame_stats", nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav | ImGuiWindowFlags_NoInputs);
+
+    // If the buffer isn't full yet, the frames start at 0. Otherwise the oldest frame is the one that would be overwritten next.
+    const int first_index = num_frames < history_size ? 0 : next_index;
+
+    float total_avg = 0;
+
+    for (int phase = 0; phase < int(FramePhase::_count); phase++)
+    {
+        const std::array<float, history_size> &values = history_ms[std::size_t(phase)];
+
+        // Compute the stats on a copy, since `nth_element()` reorders the values.
+        std::array<float, history_size> sorted = values;
+        const auto sorted_end = sorted.begin() + num_frames;
+        float min = FLT_MAX;
+        float avg = 0;
+        for (auto it = sorted.begin(); it != sorted_end; ++it)
+        {
+            min = std::min(min, *it);
+            avg += *it;
+        }
+        avg /= float(num_frames);
+        total_avg += avg;
+        const auto p99 = sorted.begin() + std::min(num_frames - 1, num_frames * 99 / 100);
+        std::nth_element(sorted.begin(), p99, sorted_end);
+
+        char overlay_text[64];
+        std::snprintf(overlay_text, sizeof overlay_text, "%.2f / %.2f / %.2f", min, avg, *p99);
+
+        ImGui::PushID(phase);
+        ImGui::TextUnformatted(phase_names[phase]);
+        ImGui::PlotLines("###plot", values.data(), num_frames, first_index, overlay_text, 0, FLT_MAX, ImVec2(ImGui::GetFontSize() * 14, ImGui::GetFontSize() * 2));
+        ImGui::PopID();
+    }
+
+    int skipped = 0;
+    for (int i = 0; i < num_frames; i++)
+        skipped += history_skipped[std::size_t(i)];
+
+    ImGui::Separator();
+    ImGui::Text("min / avg / p99, ms. Total avg: %.2f ms", total_avg);
+    ImGui::Text("Skipped iterations: %d of %d (%.0f%%)", skipped, skipped + num_frames, 100.0 * skipped / (skipped + num_frames));
+
+    ImGui::End();
+}
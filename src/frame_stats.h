@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// The phases of `SDL_AppIterate()`, in order.
+enum class FramePhase
+{
+    handle_events, // `TouchController::HandleEvents()`.
+    new_frame, // The backend `NewFrame()`s and `ImGui::NewFrame()`.
+    tick, // `BasicGame::Tick()`.
+    render, // `ImGui::Render()`.
+    render_draw_data, // Clearing the screen and `ImGui_ImplSDLRenderer3_RenderDrawData()`.
+    present, // `SDL_RenderPresent()`. This includes waiting for vsync.
+    _count [[maybe_unused]],
+};
+
+// Collects the timings of the frame phases over the last few seconds, and draws them in an overlay.
+// The history is a fixed-size ring buffer, so recording never allocates or locks.
+class FrameStats
+{
+  public:
+    static constexpr int history_size = 240;
+
+    // Toggled from the menu.
+    bool overlay_visible = false;
+
+  private:
+    // `history_ms[phase][i]` is the duration of the phase in the i-th recorded frame.
+    std::array<std::array<float, history_size>, int(FramePhase::_count)> history_ms{};
+    // How many iterations were skipped by the redraw throttle right before each recorded frame.
+    std::array<int, history_size> history_skipped{};
+    // The position in the ring buffer where the next frame goes.
+    int next_index = 0;
+    // The number of valid entries in the ring buffer.
+    int num_frames = 0;
+
+    // The phases of the current frame.
+    std::array<float, int(FramePhase::_count)> current_ms{};
+    // The end of the last phase, or the beginning of the frame.
+    std::uint64_t last_timestamp = 0;
+    // Skipped iterations since the last recorded frame.
+    int skipped_since_last_frame = 0;
+
+  public:
+    // Call this at the beginning of `SDL_AppIterate()`.
+    void BeginFrame();
+    // Call this after each phase.
+    void EndPhase(FramePhase phase);
+    // Excludes the time since the end of the last phase from the stats.
+    void SkipTime();
+    // Call this if the iteration doesn't draw a frame.
+    void SkipFrame();
+    // Call this after the last phase. Adds the frame to the history.
+    void EndFrame();
+
+    // Draws the overlay, if it's visible. Call this between `ImGui::NewFrame()` and `ImGui::Render()`.
+    void DrawOverlay() const;
+};
+
+extern FrameStats frame_stats;
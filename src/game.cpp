@@ -1,250 +1,1468 @@
 #include "game.h"
 
+#include "archive.h"
+#include "binary_io.h"
+#include "commands.h"
+#include "countdown.h"
+#include "frame_stats.h"
+#include "inference.h"
+#include "journal.h"
+#include "localization.h"
+#include "night.h"
+#include "rating.h"
+#include "redraw.h"
+#include "replication.h"
+#include "simulation.h"
+#include "socket.h"
+#include "state.h"
+#include "tournament.h"
+#include "trace.h"
+#include "undo_history.h"
+#include "vibration.h"
+
 #include <cmath>
-#include <functional>
 #include <imgui.h>
 #include <imgui_internal.h>
 #include <imgui_stdlib.h>
 
+#include <SDL3/SDL_filesystem.h>
+#include <SDL3/SDL_iostream.h>
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_stdinc.h>
 #include <SDL3/SDL_system.h>
+#include <SDL3/SDL_timer.h>
 
 #include <algorithm>
 #include <array>
-#include <map>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
+#include <variant>
 #include <vector>
 
-enum class Role
+// This takes the body as a template parameter rather than `std::function`, to avoid heap allocations.
+template <typename F>
+static void ModalPopup(const char *name, F &&body)
 {
-    // Those are ordered by their default turn order. Sync order with `Strings::roles`.
-    captain, // Blocks night-time ability of any player. Targeting mafia (possibly boss) blocks their combined ability.
-    sheriff, // Detects mafia, or killer if no mafia.
-    prostitute, // Protects from death by vote on the next day.
-    mafia_boss, // Same as normal mafia, but detects sheriff.
-    mafia, // Mafia.
-    yakuza, // Second kind of mafia, "yakuza".
-    killer, // Its own faction, kills at night like mafia, but completely independent.
-    none, // This must be last.
-    _count [[maybe_unused]],
-};
+    if (!ImGui::IsPopupOpen(name))
+        return;
+
+    ImGui::SetNextWindowPos(ImVec2(ImGui::GetIO().DisplaySize.x / 2, ImGui::GetIO().DisplaySize.y / 2), ImGuiCond_Always, ImVec2(0.5f, 0.5f));
+    if (ImGui::BeginPopupModal(name, nullptr, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoMove))
+    {
+        TRACE_ZONE("Modal");
+        body();
+        ImGui::EndPopup();
+    }
+}
+
+// A tap must be shorter than `TouchController::hold_duration_to_right_click`, so that holding to open the context menu doesn't count as one.
+static constexpr float max_tap_duration = 0.4f;
+
+// Returns true if the left mouse button was just released after a short press that didn't move, as opposed to scrolling or holding.
+[[nodiscard]] static bool IsTap()
+{
+    const ImGuiIO &io = ImGui::GetIO();
+    return
+        ImGui::IsMouseReleased(ImGuiMouseButton_Left) &&
+        io.MouseDownDurationPrev[ImGuiMouseButton_Left] < max_tap_duration &&
+        io.MouseDragMaxDistanceSqr[ImGuiMouseButton_Left] < io.MouseDragThreshold * io.MouseDragThreshold;
+}
+
+// Adds 1 to the counters of the players in the set.
+static void IncrementCounters(CowColumn<int> &counters, const PlayerSet &players)
+{
+    players.ForEach([&](std::size_t i){counters.Set(i, counters[i] + 1);});
+}
+
+#if ENABLE_TRACING
+// Saves the trace next to the session files.
+static void SaveTrace()
+{
+    char *pref_path = SDL_GetPrefPath("HolyBlackCat", "mafia");
+    if (!pref_path)
+    {
+        SDL_Log("Unable to get the preferences path, can't save the trace: %s", SDL_GetError());
+        return;
+    }
+
+    const std::string path = std::string(pref_path) + "trace.json";
+    SDL_free(pref_path);
+
+    if (Trace::Save(path))
+        SDL_Log("Saved the trace to `%s`.", path.c_str());
+    else
+        SDL_Log("Unable to save the trace to `%s`: %s", path.c_str(), SDL_GetError());
+}
+#endif
+
+struct Game : BasicGame
+{
+    Settings settings;
+    Round this_round;
+
+    // The tournament, if hosting one. There's only one table otherwise.
+    Tournament tournament;
+    // All tables. The active one is moved out into `this_round`, so that everything else only deals with one round, and its slot here stays empty.
+    // Switching tables only moves two rounds. The other tables don't do anything per frame.
+    std::vector<Round> tables = std::vector<Round>(1);
+    std::size_t active_table = 0;
+    // The current language. Points either to the built-in strings or into `language_packs`.
+    StringTable strings = BuiltinStrings(BuiltinLanguage::russian);
+    // The languages to choose from in the menu: the built-in ones, then the packs (a pack replaces a built-in language with the same code).
+    std::vector<StringTable> languages;
+    std::vector<std::unique_ptr<LanguagePack>> language_packs;
+    // Where to remember the chosen language. Empty if the session isn't persisted.
+    std::string language_setting_path;
+    // Set when the language changes while the menu is open.
+    bool reopen_menu = false;
+
+    std::string add_player_textbox_for_modal;
+    Role new_player_role_for_modal{};
+    int tournament_num_tables_for_modal = 2;
+
+    // The player list is clipped, but the row with an open context menu must be submitted even when it's scrolled out of view.
+    int player_index_with_menu_prev_frame = -1;
+
+    int player_id_counter = 1;
+
+    // Resolves the actions of the displayed day, for the preview in the player list.
+    NightResolver night_resolver;
+
+    // Null if the session isn't persisted.
+    std::unique_ptr<Journal> journal;
+    // Reused between commands, to avoid heap allocations.
+    BinaryWriter command_writer;
+    UndoHistory undo_history;
+
+    // Null unless broadcasting to the players' devices is enabled in the menu.
+    std::unique_ptr<ReplicationServer> replication_server;
+    // What the players see, as last published.
+    PublicView public_view;
+    // Set by every command, to republish `public_view` at the end of the frame.
+    bool public_view_dirty = true;
+    // Incremented by every command, to tell when the state changed.
+    std::uint64_t state_version = 0;
+    // The address to show to the players, looked up when the broadcasting starts. Empty if unknown.
+    std::string broadcast_local_address;
+    // Why the broadcasting couldn't start, if it couldn't.
+    std::string broadcast_error;
+
+    // Null if the finished games aren't archived.
+    std::unique_ptr<ArchiveWriter> archive_writer;
+    // The rounds finished by the last new game or tournament round, if that's the last change. They're archived when the next change is made,
+    //   rather than right away, so that undoing a new game started by mistake doesn't leave the unfinished round in the archive and the ratings.
+    std::vector<Round> rounds_to_archive;
+    // The hashes of the games archived during this session, with the time zeroed.
+    // Undoing and redoing a new game or a tournament round (which archives every table) shouldn't archive the same games twice.
+    std::unordered_set<std::size_t> archived_game_hashes;
+    // Reused between the archived games, to hash them.
+    BinaryWriter archived_game_writer;
+    // The statistics query, while it runs. This is declared after `archive_writer`, to be destroyed before it.
+    std::future<ArchiveStats> stats_future;
+    std::optional<ArchiveStats> stats;
+    std::string stats_error;
+
+    // The player ratings. Computed from the archive in the background on startup, then updated after each game.
+    Ratings ratings;
+    std::future<Ratings> ratings_future;
+    // The games archived while `ratings_future` is running, to add to the ratings when it's done.
+    std::vector<ArchivedGame> games_to_rate;
+    // What to show next to the player names, indexed by `NameId`. Empty for the players without a rating.
+    // Rebuilt when the ratings change or when `this_round` is replaced by another table (each has its own name pool), and extended when new names appear, so that drawing the list doesn't look anything up.
+    std::vector<std::string> rating_labels_by_name;
+
+    // The balance simulation for the current table, while it runs.
+    std::unique_ptr<BackgroundSimulation> simulation;
+    std::optional<SimulationResult> simulation_result;
+    std::string simulation_error;
+    SimulationPolicy simulation_policy = SimulationPolicy::informed;
+    std::uint64_t simulation_num_games = 1'000'000;
+
+    // The role probabilities for the commentators. Created when first shown.
+    std::unique_ptr<RoleInference> role_inference;
+    // The `state_version` that `role_inference` was last asked about.
+    std::uint64_t inference_requested_version = std::uint64_t(-1);
+
+    // The day discussion, started when the day turn comes and paused when it ends. Its length is chosen in the menu, 0 disables it.
+    Countdown discussion_timer;
+    int discussion_minutes = 0;
+    // The speech of one player, started from their context menu.
+    Countdown speech_timer;
+    std::string speech_player_name;
+    // The screen flashes until this time (on the `SDL_GetTicksNS()` clock) when a timer runs out.
+    std::uint64_t flash_end_ns = 0;
+
+    // The number of commands written to the journal since the last snapshot.
+    int commands_since_snapshot = 0;
+
+    // Write a new snapshot after this many commands, so that the journal doesn't grow forever.
+    static constexpr int commands_per_snapshot = 256;
+
+    static constexpr int speech_seconds = 60;
+    static constexpr int final_speech_seconds = 30;
+    static constexpr std::uint64_t flash_duration_ns = 600'000'000;
+    static constexpr std::uint32_t vibration_duration_ms = 400;
+
+    // Increment when changing the format of `SaveSession()`. Version 1 had no tournaments.
+    static constexpr std::uint64_t session_format_version = 2;
+
+    void SetFirstActiveRole()
+    {
+        if (!this_round.state.days[std::size_t(this_round.active_day_index)].players.IsEmpty())
+        {
+            this_round.active_role_index = -1;
+            NextTurn();
+        }
+    }
+
+    void NextTurn()
+    {
+        TRACE_ZONE("NextTurn");
+        const Day &day = this_round.state.days[std::size_t(this_round.active_day_index)];
+        const unsigned turns = settings.RoleMaskToTurnMask(day.players.role_mask);
+        if (!turns)
+            return; // No players, nobody can make a turn.
+
+        // Try the remaining turns of this day.
+        const unsigned next_turns = turns & ~((1u << (this_round.active_role_index + 1)) - 1);
+        if (next_turns)
+        {
+            this_round.active_role_index = std::countr_zero(next_turns);
+            return;
+        }
+
+        // Otherwise start a new day. It has the same players, so the same turns.
+        // The players remember how many times they were targeted by the roles that can find out something about them. The actions start over.
+        // The deaths aren't applied, the moderator removes the players, since they can be saved by the rules that the app doesn't know about.
+        std::vector<Day> &days = this_round.state.days;
+        const bool was_roll_call = days.size() == 1;
+        const NightOutcome outcome = was_roll_call ? NightOutcome{} : ResolveNight(days.back(), settings);
+        days.push_back(days.back());
+        days.back().actions = {};
+        if (!was_roll_call)
+        {
+            PlayerTable &players = days.back().players;
+            IncrementCounters(players.times_targeted_by_captain, outcome.effective_targets[std::size_t(Role::captain)]);
+            IncrementCounters(players.times_targeted_by_sheriff, outcome.effective_targets[std::size_t(Role::sheriff)]);
+            IncrementCounters(players.times_targeted_by_prostitute, outcome.effective_targets[std::size_t(Role::prostitute)]);
+            IncrementCounters(players.times_targeted_by_mafia_boss, outcome.effective_targets[std::size_t(Role::mafia_boss)]);
+        }
+        this_round.active_day_index = int(days.size()) - 1;
+        this_round.active_role_index = std::countr_zero(turns);
+    }
+
+    // Performs a command without recording it anywhere. Returns the inverse command, if the command is undoable.
+    // Throws on invalid commands, before changing anything.
+    [[nodiscard]] std::optional<Command> Apply(const Command &command)
+    {
+        return std::visit([&](const auto &cmd){return Apply(cmd);}, command);
+    }
+
+    // Writes an applied command to the journal.
+    void Record(const Command &command)
+    {
+        if (!journal)
+            return;
+
+        command_writer.Clear();
+        WriteCommand(command_writer, command);
+        journal->Append(command_writer.Data());
+
+        if (++commands_since_snapshot >= commands_per_snapshot)
+            WriteSnapshot();
+    }
+
+    // Returns the rounds that a command finishes, to archive them. Call this before applying the command, and not for undos.
+    // A new game or a tournament round comes back from the redo stack as the command that restores its result. A redone `RestoreRound` is always a new game,
+    //   and a redone `RestoreTournament` between two active tournaments is always a tournament round, since the other tournament commands start or end one.
+    [[nodiscard]] std::vector<Round> FinishedRounds(const Command &command) const
+    {
+        std::vector<Round> ret;
+        if (std::holds_alternative<Commands::NewGame>(command) || std::holds_alternative<Commands::RestoreRound>(command))
+        {
+            ret.push_back(this_round);
+        }
+        else if (
+            std::holds_alternative<Commands::NextTournamentRound>(command) ||
+            (std::holds_alternative<Commands::RestoreTournament>(command) && tournament.IsActive() && std::get<Commands::RestoreTournament>(command).tournament.IsActive())
+        )
+        {
+            for (std::size_t i = 0; i < tables.size(); i++)
+                ret.push_back(Table(i));
+        }
+        return ret;
+    }
+
+    // Call this after applying an undoable command, other than an undo. The previous new game can't be undone by mistake anymore, so archive its rounds.
+    void UpdateRoundsToArchive(std::vector<Round> finished_rounds)
+    {
+        for (const Round &round : rounds_to_archive)
+            ArchiveRound(round);
+        rounds_to_archive = std::move(finished_rounds);
+    }
+
+    // Performs a command, writes it to the journal, and adds it to the undo history.
+    void Execute(const Command &command)
+    {
+        TRACE_ZONE("Execute");
+        std::vector<Round> finished_rounds = FinishedRounds(command);
+        std::optional<Command> inverse = Apply(command);
+        Record(command);
+        public_view_dirty = true;
+        state_version++;
+        if (inverse)
+        {
+            UpdateRoundsToArchive(std::move(finished_rounds));
+            undo_history.AddUndo(std::move(*inverse));
+        }
+        else
+        {
+            undo_history.ClearRedo(); // Only the navigation isn't undoable. The redone commands act on the active day and turn, so after navigating they would do something else.
+        }
+    }
+
+    void Undo()
+    {
+        if (std::optional<Command> command = undo_history.TakeUndo())
+        {
+            // If there are rounds to archive, then this undoes the command that finished them.
+            rounds_to_archive.clear();
+
+            std::optional<Command> inverse = Apply(*command);
+            Record(*command);
+            public_view_dirty = true;
+            state_version++;
+            if (inverse)
+                undo_history.AddRedo(std::move(*inverse));
+        }
+    }
+
+    void Redo()
+    {
+        if (std::optional<Command> command = undo_history.TakeRedo())
+        {
+            std::vector<Round> finished_rounds = FinishedRounds(*command);
+            std::optional<Command> inverse = Apply(*command);
+            Record(*command);
+            public_view_dirty = true;
+            state_version++;
+            if (inverse)
+            {
+                UpdateRoundsToArchive(std::move(finished_rounds));
+                undo_history.AddUndoFromRedo(std::move(*inverse));
+            }
+        }
+    }
+
+    [[nodiscard]] PlayerTable &CurrentPlayers()
+    {
+        return this_round.state.days.back().players;
+    }
+
+    [[nodiscard]] std::optional<Command> Apply(const Commands::AddPlayer &cmd)
+    {
+        State &state = this_round.state;
+        CurrentPlayers().Add({.id = player_id_counter++, .name = state.names.Intern(cmd.name), .role = Role::none});
+        return Commands::RemovePlayer{.index = CurrentPlayers().Size() - 1};
+    }
+
+    [[nodiscard]] std::optional<Command> Apply(const Commands::RemovePlayer &cmd)
+    {
+        PlayerTable &players = CurrentPlayers();
+        if (cmd.index >= players.Size())
+            throw std::runtime_error("Player index is out of range.");
+        Commands::InsertPlayer inverse{.index = cmd.index, .player = players.Get(cmd.index)};
+        players.Remove(cmd.index);
+        return inverse;
+    }
+
+    [[nodiscard]] std::optional<Command> Apply(const Commands::InsertPlayer &cmd)
+    {
+        PlayerTable &players = CurrentPlayers();
+        if (cmd.index > players.Size())
+            throw std::runtime_error("Player index is out of range.");
+        if (std::size_t(cmd.player.name) >= this_round.state.names.Size())
+            throw std::runtime_error("Player name is out of range.");
+        players.Insert(cmd.index, cmd.player);
+        return Commands::RemovePlayer{.index = cmd.index};
+    }
+
+    [[nodiscard]] std::optional<Command> Apply(const Commands::SetPlayerRole &cmd)
+    {
+        PlayerTable &players = CurrentPlayers();
+        if (cmd.index >= players.Size())
+            throw std::runtime_error("Player index is out of range.");
+        Commands::SetPlayerRole inverse{.index = cmd.index, .role = players.roles[cmd.index]};
+        players.SetRole(cmd.index, cmd.role);
+        return inverse;
+    }
+
+    [[nodiscard]] std::optional<Command> Apply(const Commands::SetTargets &cmd)
+    {
+        if (this_round.state.days.size() < 2)
+            throw std::runtime_error("There are no actions during the roll call.");
+
+        Day &day = this_round.state.days.back();
+        if ((*day.actions)[std::size_t(cmd.role)].targets != cmd.old_targets)
+            throw std::runtime_error("The targets don't match the ones to replace.");
+
+        // The old targets can include the players that were removed since, only check the added ones.
+        for (int id : cmd.new_targets)
+        {
+            if (std::find(cmd.old_targets.begin(), cmd.old_targets.end(), id) != cmd.old_targets.end())
+                continue;
+            bool found = false;
+            for (std::size_t i = 0; i < day.players.Size() && !found; i++)
+                found = day.players.ids[i] == id;
+            if (!found)
+                throw std::runtime_error("No player with this id.");
+        }
+
+        day.actions.Mut()[std::size_t(cmd.role)].targets = cmd.new_targets;
+        return Commands::SetTargets{.role = cmd.role, .old_targets = cmd.new_targets, .new_targets = cmd.old_targets};
+    }
+
+    [[nodiscard]] std::optional<Command> Apply(const Commands::SetRoleEnabled &cmd)
+    {
+        bool &enabled = this_round.enabled_roles[std::size_t(cmd.role)];
+        Commands::SetRoleEnabled inverse{.role = cmd.role, .enabled = enabled};
+        enabled = cmd.enabled;
+        return inverse;
+    }
+
+    // Navigation isn't undoable, the history only contains the actual changes.
+
+    [[nodiscard]] std::optional<Command> Apply(const Commands::SetActiveRole &cmd)
+    {
+        if (cmd.index < 0 || cmd.index >= int(Role::_count))
+            throw std::runtime_error("Turn index is out of range.");
+        this_round.active_role_index = cmd.index;
+        return {};
+    }
+
+    [[nodiscard]] std::optional<Command> Apply(const Commands::SetActiveDay &cmd)
+    {
+        if (cmd.index < 0 || cmd.index >= int(this_round.state.days.size()))
+            throw std::runtime_error("Day index is out of range.");
+
+        const bool was_viewing_current_day = this_round.active_day_index + 1 == int(this_round.state.days.size());
+        this_round.active_day_index = cmd.index;
+        if (was_viewing_current_day)
+            SetFirstActiveRole();
+        return {};
+    }
+
+    [[nodiscard]] std::optional<Command> Apply(const Commands::NextTurn &)
+    {
+        Commands::RevertTurn inverse{.day_index = this_round.active_day_index, .role_index = this_round.active_role_index};
+        const std::size_t num_days = this_round.state.days.size();
+        NextTurn();
+        inverse.remove_last_day = this_round.state.days.size() != num_days;
+        return inverse;
+    }
+
+    [[nodiscard]] std::optional<Command> Apply(const Commands::RevertTurn &cmd)
+    {
+        const int num_days = int(this_round.state.days.size()) - cmd.remove_last_day;
+        if (num_days < 1 || cmd.day_index < 0 || cmd.day_index >= num_days || cmd.role_index < 0 || cmd.role_index >= int(Role::_count))
+            throw std::runtime_error("Invalid turn to revert to.");
+
+        if (cmd.remove_last_day)
+            this_round.state.days.pop_back();
+        this_round.active_day_index = cmd.day_index;
+        this_round.active_role_index = cmd.role_index;
+        return Commands::NextTurn{};
+    }
+
+    [[nodiscard]] std::optional<Command> Apply(const Commands::NewGame &)
+    {
+        Commands::RestoreRound inverse{.round = this_round};
+
+        State &state = this_round.state;
+
+        auto players = std::move(state.days.back().players);
+        auto names = std::move(state.names);
+        auto roles = std::move(this_round.enabled_roles);
+        state = {};
+        state.days.emplace_back();
+
+        state.days.back().players = std::move(players);
+        state.names = std::move(names);
+        this_round.enabled_roles = std::move(roles);
+
+        // Reset the turn here rather than relying on `Tick()` to clamp it, since the replayed commands and the snapshots don't go through `Tick()`.
+        this_round.active_day_index = 0;
+        this_round.active_role_index = 0;
+        SetFirstActiveRole();
+
+        return inverse;
+    }
+
+    [[nodiscard]] std::optional<Command> Apply(const Commands::RestoreRound &cmd)
+    {
+        // `ReadRound()` already validated the round itself.
+        Commands::RestoreRound inverse{.round = this_round};
+
+        // The name pool only grows, so the longer one includes the other. Keep it, since other commands can refer to those names.
+        NamePool names = std::move(this_round.state.names);
+        this_round = cmd.round;
+        if (names.Size() > this_round.state.names.Size())
+            this_round.state.names = std::move(names);
+
+        return inverse;
+    }
+
+    // Returns a table, including the active one.
+    [[nodiscard]] const Round &Table(std::size_t index) const
+    {
+        return index == active_table ? this_round : tables[index];
+    }
+
+    // Copies all tables, to undo a tournament command.
+    [[nodiscard]] Commands::RestoreTournament SaveTables() const
+    {
+        Commands::RestoreTournament ret{.tournament = tournament, .tables = tables, .active_table = int(active_table)};
+        ret.tables[active_table] = this_round;
+        return ret;
+    }
+
+    void SetTables(std::vector<Round> new_tables, std::size_t new_active_table)
+    {
+        tables = std::move(new_tables);
+        active_table = new_active_table;
+        this_round = std::move(tables[active_table]);
+        // Each table has its own name pool.
+        rating_labels_by_name.clear();
+    }
+
+    // Makes a new round for each table, with the players seated as in `seating` (the table of each tournament player).
+    [[nodiscard]] std::vector<Round> SeatTables(const std::vector<std::uint16_t> &seating, const std::vector<std::array<bool, int(Role::_count)>> &enabled_roles_by_table)
+    {
+        std::vector<Round> ret(enabled_roles_by_table.size());
+        for (std::size_t i = 0; i < ret.size(); i++)
+        {
+            ret[i].state.days.emplace_back();
+            ret[i].enabled_roles = enabled_roles_by_table[i];
+        }
+
+        for (std::size_t i = 0; i < seating.size(); i++)
+        {
+            State &state = ret[seating[i]].state;
+            state.days.back().players.Add({.id = player_id_counter++, .name = state.names.Intern(tournament.players[i]), .role = Role::none});
+        }
+
+        // Same as `SetFirstActiveRole()`. The roles aren't dealt yet, so this is the first turn of the roll call.
+        for (Round &round : ret)
+        {
+            const unsigned turns = settings.RoleMaskToTurnMask(round.state.days.back().players.role_mask);
+            round.active_role_index = turns ? std::countr_zero(turns) : 0;
+        }
+        return ret;
+    }
+
+    [[nodiscard]] std::optional<Command> Apply(const Commands::StartTournament &cmd)
+    {
+        if (tournament.IsActive())
+            throw std::runtime_error("The tournament has already started.");
+        const PlayerTable &players = CurrentPlayers();
+        if (cmd.num_tables < 1 || std::size_t(cmd.num_tables) > std::min(players.Size(), Tournament::max_tables))
+            throw std::runtime_error("Invalid number of tables.");
+
+        Commands::RestoreTournament inverse = SaveTables();
+
+        Tournament new_tournament;
+        for (std::size_t i = 0; i < players.Size(); i++)
+            new_tournament.players.push_back(this_round.state.names[players.names[i]]);
+        new_tournament.num_tables = std::size_t(cmd.num_tables);
+        new_tournament.seatings.push_back(new_tournament.ScheduleNextRound());
+
+        tournament = std::move(new_tournament);
+        SetTables(SeatTables(tournament.seatings.back(), std::vector(tournament.num_tables, this_round.enabled_roles)), 0);
+        return inverse;
+    }
+
+    [[nodiscard]] std::optional<Command> Apply(const Commands::NextTournamentRound &)
+    {
+        if (!tournament.IsActive())
+            throw std::runtime_error("There's no tournament.");
+
+        Commands::RestoreTournament inverse = SaveTables();
+
+        std::vector<std::array<bool, int(Role::_count)>> enabled_roles_by_table(tables.size());
+        for (std::size_t i = 0; i < tables.size(); i++)
+            enabled_roles_by_table[i] = Table(i).enabled_roles;
+
+        tournament.seatings.push_back(tournament.ScheduleNextRound());
+        SetTables(SeatTables(tournament.seatings.back(), enabled_roles_by_table), active_table);
+        return inverse;
+    }
+
+    [[nodiscard]] std::optional<Command> Apply(const Commands::SwitchTable &cmd)
+    {
+        if (cmd.index < 0 || std::size_t(cmd.index) >= tables.size())
+            throw std::runtime_error("Table index is out of range.");
+
+        Commands::SwitchTable inverse{.index = int(active_table)};
+        tables[active_table] = std::move(this_round);
+        active_table = std::size_t(cmd.index);
+        this_round = std::move(tables[active_table]);
+        // Each table has its own name pool.
+        rating_labels_by_name.clear();
+        return inverse;
+    }
+
+    [[nodiscard]] std::optional<Command> Apply(const Commands::EndTournament &)
+    {
+        if (!tournament.IsActive())
+            throw std::runtime_error("There's no tournament.");
+
+        Commands::RestoreTournament inverse = SaveTables();
+        tournament = {};
+        tables.assign(1, Round{});
+        active_table = 0;
+        return inverse;
+    }
+
+    [[nodiscard]] std::optional<Command> Apply(const Commands::RestoreTournament &cmd)
+    {
+        // `ReadRound()` and `ReadTournament()` already validated the parts themselves.
+        if (cmd.tables.size() != (cmd.tournament.IsActive() ? cmd.tournament.num_tables : 1))
+            throw std::runtime_error("The number of tables doesn't match the tournament.");
+        if (cmd.active_table < 0 || std::size_t(cmd.active_table) >= cmd.tables.size())
+            throw std::runtime_error("Table index is out of range.");
+
+        Commands::RestoreTournament inverse = SaveTables();
+        tournament = cmd.tournament;
+        SetTables(cmd.tables, std::size_t(cmd.active_table));
+        return inverse;
+    }
+
+    [[nodiscard]] std::vector<unsigned char> SaveSession() const
+    {
+        BinaryWriter writer;
+        writer.WriteVarint(session_format_version);
+        WriteSettings(writer, settings);
+        WriteRound(writer, this_round);
+        writer.WriteSignedVarint(player_id_counter);
+
+        // The other tables, if any.
+        WriteTournament(writer, tournament);
+        writer.WriteVarint(tables.size());
+        writer.WriteVarint(active_table);
+        for (std::size_t i = 0; i < tables.size(); i++)
+        {
+            if (i != active_table)
+                WriteRound(writer, tables[i]);
+        }
+
+        return std::move(writer.Data());
+    }
+
+    // Throws on invalid data, without changing anything.
+    void LoadSession(std::span<const unsigned char> data)
+    {
+        BinaryReader reader(data);
+        const std::uint64_t version = reader.ReadVarint();
+        if (version < 1 || version > session_format_version)
+            throw std::runtime_error("Unknown session format version.");
+        Settings new_settings = ReadSettings(reader);
+        Round new_round = ReadRound(reader);
+        const int new_player_id_counter = int(reader.ReadSignedVarint());
+
+        Tournament new_tournament;
+        std::vector<Round> new_tables(1);
+        std::size_t new_active_table = 0;
+        if (version >= 2)
+        {
+            new_tournament = ReadTournament(reader);
+            new_tables.resize(std::size_t(reader.ReadVarint()));
+            if (new_tables.size() != (new_tournament.IsActive() ? new_tournament.num_tables : 1))
+                throw std::runtime_error("The number of tables doesn't match the tournament.");
+            new_active_table = reader.ReadIndex(new_tables.size());
+            for (std::size_t i = 0; i < new_tables.size(); i++)
+            {
+                if (i != new_active_table)
+                    new_tables[i] = ReadRound(reader);
+            }
+        }
+
+        if (!reader.AtEnd())
+            throw std::runtime_error("Junk at the end of the saved session.");
+
+        settings = std::move(new_settings);
+        this_round = std::move(new_round);
+        rating_labels_by_name.clear();
+        player_id_counter = new_player_id_counter;
+        tournament = std::move(new_tournament);
+        tables = std::move(new_tables);
+        active_table = new_active_table;
+    }
+
+    void WriteSnapshot()
+    {
+        journal->WriteSnapshot(SaveSession());
+        commands_since_snapshot = 0;
+    }
+
+    // Restores the session saved at `path_prefix` (if any), and starts saving the session there.
+    void OpenJournal(std::string path_prefix)
+    {
+        journal = std::make_unique<Journal>(std::move(path_prefix));
+
+        if (std::optional<Journal::Contents> contents = journal->Load())
+        {
+            try
+            {
+                LoadSession(contents->snapshot);
+            }
+            catch (std::exception &e)
+            {
+                SDL_Log("Unable to restore the session: %s", e.what());
+                contents->records.clear();
+            }
+
+            std::size_t num_replayed = 0;
+            try
+            {
+                for (const std::vector<unsigned char> &record : contents->records)
+                {
+                    BinaryReader reader(record);
+                    const Command command = ReadCommand(reader);
+                    (void)Apply(command);
+                    num_replayed++;
+                }
+            }
+            catch (std::exception &e)
+            {
+                // The commands only throw before making changes, so the state is still consistent here.
+                SDL_Log("Stopped replaying the session journal after %d commands: %s", int(num_replayed), e.what());
+            }
+        }
+
+        // Start from a fresh snapshot, so that the replayed commands don't have to be replayed again next time.
+        WriteSnapshot();
+    }
+
+    // Updates `public_view` from the current state.
+    // Only the latest day is public. While the moderator looks at the previous days, the players keep seeing the phase of the latest one.
+    void UpdatePublicView()
+    {
+        const State &state = this_round.state;
+        const PlayerTable &players = state.days.back().players;
+
+        public_view.day = int(state.days.size()) - 1;
+
+        if (this_round.active_day_index + 1 == int(state.days.size()))
+        {
+            const Role active_role = settings.role_order[std::size_t(this_round.active_role_index)];
+            if (active_role == Role::none)
+                public_view.phase = PublicPhase::day;
+            else if (public_view.day == 0)
+                public_view.phase = PublicPhase::roll_call;
+            else
+                public_view.phase = PublicPhase::night;
+        }
+
+        public_view.players.resize(players.Size());
+        for (std::size_t i = 0; i < players.Size(); i++)
+        {
+            const std::string &name = state.names[players.names[i]];
+            if (public_view.players[i] != name)
+                public_view.players[i] = name;
+        }
+
+        public_view.faction_counts = players.faction_counts;
+    }
+
+    void SetBroadcasting(bool enable)
+    {
+        replication_server = nullptr;
+        broadcast_error.clear();
+        if (!enable)
+            return;
+
+        try
+        {
+            replication_server = std::make_unique<ReplicationServer>();
+            broadcast_local_address = Socket::GuessLocalAddress();
+            public_view_dirty = true;
+        }
+        catch (std::exception &e)
+        {
+            broadcast_error = e.what();
+        }
+    }
+
+    // Adds a finished round to the archive. See `rounds_to_archive`.
+    void ArchiveRound(const Round &round)
+    {
+        // Skip rounds that never got past the roll call.
+        if (!archive_writer || round.state.days.size() <= 1)
+            return;
+
+        ArchivedGame game = MakeArchivedGame(round.state, 0);
+        archived_game_writer.Clear();
+        WriteArchiveBlock(archived_game_writer, std::span(&game, 1));
+        const std::vector<unsigned char> &bytes = archived_game_writer.Data();
+        if (!archived_game_hashes.insert(std::hash<std::string_view>{}(std::string_view((const char *)bytes.data(), bytes.size()))).second)
+            return;
+
+        game.time = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+        if (ratings_future.valid())
+        {
+            games_to_rate.push_back(game);
+        }
+        else
+        {
+            ratings.AddGame(game);
+            rating_labels_by_name.clear();
+        }
+
+        archive_writer->Append(std::move(game));
+    }
+
+    // Starts recomputing the ratings from the archive on a background thread.
+    void StartRatingsRecompute()
+    {
+        if (!archive_writer || ratings_future.valid())
+            return;
+
+        try
+        {
+            // Open the archive here rather than on the thread, so that the games archived from now on are not in it, and go to `games_to_rate` instead.
+            archive_writer->Flush();
+            ratings_future = std::async(std::launch::async, [archive = Archive(archive_writer->Path())]
+            {
+                return Ratings::Compute(archive, {});
+            });
+        }
+        catch (std::exception &e)
+        {
+            SDL_Log("Unable to compute the player ratings: %s", e.what());
+        }
+    }
+
+    // Picks up the recomputed ratings, and updates `rating_labels_by_name`.
+    void UpdateRatingLabels()
+    {
+        if (ratings_future.valid())
+        {
+            if (ratings_future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                RequestRedrawIn(0.1);
+            }
+            else
+            {
+                try
+                {
+                    ratings = ratings_future.get();
+                }
+                catch (std::exception &e)
+                {
+                    SDL_Log("Unable to compute the player ratings: %s", e.what());
+                }
+
+                for (const ArchivedGame &game : games_to_rate)
+                    ratings.AddGame(game);
+                games_to_rate.clear();
+                rating_labels_by_name.clear();
+            }
+        }
+
+        const NamePool &names = this_round.state.names;
+        if (rating_labels_by_name.size() > names.Size())
+            rating_labels_by_name.clear();
+        while (rating_labels_by_name.size() < names.Size())
+        {
+            std::string &label = rating_labels_by_name.emplace_back();
+            std::optional<NameId> player = ratings.Find(names[NameId(rating_labels_by_name.size() - 1)]);
+            if (player && ratings.NumGames(*player) > 0)
+                label = std::to_string(std::lround(ratings.Rating(*player)));
+        }
+    }
+
+    // Starts scanning the archive on a background thread, unless it's already running.
+    void StartStatsQuery()
+    {
+        if (!archive_writer || stats_future.valid())
+            return;
+
+        stats = std::nullopt;
+        stats_error.clear();
+        stats_future = std::async(std::launch::async, [writer = archive_writer.get()]
+        {
+            writer->Flush();
+            return RunArchiveQuery(Archive(writer->Path()), {});
+        });
+    }
+
+    void DisplayStats()
+    {
+        if (stats_future.valid())
+        {
+            if (stats_future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                ImGui::TextDisabled("%s", strings[StringId::stats_loading]);
+                RequestRedrawIn(0.1);
+                return;
+            }
+
+            try
+            {
+                stats = stats_future.get();
+            }
+            catch (std::exception &e)
+            {
+                stats_error = e.what();
+            }
+        }
+
+        if (!stats)
+        {
+            ImGui::TextWrapped("%s", stats_error.c_str());
+            return;
+        }
+
+        ImGui::Text(strings[StringId::stats_num_games], (long long)stats->num_games, (long long)stats->num_players);
+
+        auto Percentage = [](std::int64_t part, std::int64_t total){return total > 0 ? double(part) * 100 / double(total) : 0.0;};
+
+        { // Wins by the number of players.
+            ImGui::SeparatorText(strings[StringId::stats_wins]);
+            if (ImGui::BeginTable("Wins", int(Faction::_count) + 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit))
+            {
+                ImGui::TableSetupColumn(strings[StringId::stats_num_players]);
+                ImGui::TableSetupColumn(strings[StringId::stats_games]);
+                for (int i = 0; i < int(Faction::_count); i++)
+                    ImGui::TableSetupColumn(strings.FactionNamePlural(Faction(i)));
+                ImGui::TableSetupColumn(strings[StringId::stats_no_winner]);
+                ImGui::TableHeadersRow();
+
+                for (std::size_t i = 0; i < stats->games_won.size(); i++)
+                {
+                    std::int64_t total = 0;
+                    for (std::int64_t count : stats->games_won[i])
+                        total += count;
+                    if (total == 0)
+                        continue;
+
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::Text(i == stats->games_won.size() - 1 ? "%d+" : "%d", int(i));
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%lld", (long long)total);
+                    for (std::int64_t count : stats->games_won[i])
+                    {
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%.0f%%", Percentage(count, total));
+                    }
+                }
+
+                ImGui::EndTable();
+            }
+        }
+
+        ImGui::Spacing();
+        ImGui::Text(strings[StringId::stats_sheriff], (long long)stats->sheriff_checks, Percentage(stats->sheriff_hits, stats->sheriff_checks));
+
+        { // Survival by the number of times targeted.
+            ImGui::SeparatorText(strings[StringId::stats_survival]);
+            if (ImGui::BeginTable("Survival", ArchiveStats::max_times_targeted + 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit))
+            {
+                ImGui::TableSetupColumn("");
+                for (int i = 0; i <= ArchiveStats::max_times_targeted; i++)
+                    ImGui::TableSetupColumn(i == ArchiveStats::max_times_targeted ? (std::to_string(i) + "+").c_str() : std::to_string(i).c_str());
+                ImGui::TableSetupColumn(strings[StringId::stats_correlation]);
+                ImGui::TableHeadersRow();
+
+                // Sync with `Targeting`.
+                static constexpr Role targeting_roles[] = {Role::captain, Role::sheriff, Role::prostitute, Role::mafia_boss};
+                static_assert(std::size(targeting_roles) == std::size_t(Targeting::_count));
+
+                for (std::size_t i = 0; i < stats->targeting.size(); i++)
+                {
+                    const ArchiveStats::TargetingStats &target_stats = stats->targeting[i];
+
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::TextUnformatted(strings.RoleName(targeting_roles[i]));
+                    for (std::size_t j = 0; j < target_stats.players.size(); j++)
+                    {
+                        ImGui::TableNextColumn();
+                        if (target_stats.players[j] > 0)
+                            ImGui::Text("%.0f%%", Percentage(target_stats.survived[j], target_stats.players[j]));
+                    }
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%+.2f", target_stats.correlation.Coefficient());
+                }
+
+                ImGui::EndTable();
+            }
+        }
+    }
+
+    // Plays random games with the current table size and the enabled roles. The games are played on all cores, in the background.
+    void StartSimulation()
+    {
+        simulation_result = std::nullopt;
+        simulation_error.clear();
+
+        SimulationConfig config;
+        config.num_players = int(CurrentPlayers().Size());
+        config.enabled_roles = this_round.enabled_roles;
+        config.policy = simulation_policy;
+        config.settings = settings;
+        config.num_games = simulation_num_games;
+
+        try
+        {
+            (void)DealSimulationRoles(config); // Check that the roles fit, before starting the threads.
+            simulation = std::make_unique<BackgroundSimulation>(config);
+        }
+        catch (std::exception &e)
+        {
+            simulation_error = e.what();
+        }
+    }
+
+    void DisplaySimulation()
+    {
+        ImGui::Text(strings[StringId::simulation_setup], int(CurrentPlayers().Size()));
+
+        if (simulation && simulation->IsDone())
+        {
+            try
+            {
+                simulation_result = simulation->Result();
+            }
+            catch (std::exception &e)
+            {
+                simulation_error = e.what();
+            }
+            simulation = nullptr;
+        }
+
+        if (simulation)
+        {
+            ImGui::ProgressBar(simulation->Progress(), ImVec2(ImGui::GetContentRegionAvail().x, 0));
+            if (ImGui::Button(strings[StringId::button_cancel], ImVec2(ImGui::GetContentRegionAvail().x, 0)))
+                simulation->Cancel();
+            RequestRedrawIn(0.1);
+            return;
+        }
+
+        static constexpr std::uint64_t num_games_choices[] = {100'000, 1'000'000, 10'000'000};
+        ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x / 2);
+        if (ImGui::BeginCombo(strings[StringId::stats_games], std::to_string(simulation_num_games).c_str()))
+        {
+            for (std::uint64_t choice : num_games_choices)
+            {
+                if (ImGui::Selectable(std::to_string(choice).c_str(), choice == simulation_num_games))
+                    simulation_num_games = choice;
+            }
+            ImGui::EndCombo();
+        }
+
+        const StringId policy_names[] = {StringId::simulation_policy_random, StringId::simulation_policy_informed};
+        ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x / 2);
+        if (ImGui::BeginCombo(strings[StringId::simulation_policy], strings[policy_names[int(simulation_policy)]]))
+        {
+            for (int i = 0; i < int(SimulationPolicy::_count); i++)
+            {
+                if (ImGui::Selectable(strings[policy_names[i]], i == int(simulation_policy)))
+                    simulation_policy = SimulationPolicy(i);
+            }
+            ImGui::EndCombo();
+        }
+
+        if (ImGui::Button(strings[StringId::simulation_start], ImVec2(ImGui::GetContentRegionAvail().x, 0)))
+            StartSimulation();
+
+        if (!simulation_error.empty())
+        {
+            ImGui::TextWrapped("%s", simulation_error.c_str());
+            return;
+        }
+        if (!simulation_result)
+            return;
+
+        const SimulationResult &result = *simulation_result;
+        ImGui::Text(strings[StringId::simulation_summary], (long long)result.num_games, result.AverageDays());
+        if (ImGui::BeginTable("simulation", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingFixedFit))
+        {
+            ImGui::TableSetupColumn(strings[StringId::simulation_winner]);
+            ImGui::TableSetupColumn(strings[StringId::simulation_win_rate]);
+            ImGui::TableSetupColumn(strings[StringId::simulation_interval]);
+            ImGui::TableHeadersRow();
+
+            for (std::size_t i = 0; i < result.wins.size(); i++)
+            {
+                if (result.wins[i] == 0)
+                    continue;
+
+                const auto [low, high] = result.WinRateInterval(i);
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(i < std::size_t(Faction::_count) ? strings.FactionNamePlural(Faction(i)) : strings[StringId::stats_no_winner]);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f%%", result.WinRate(i) * 100);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f..%.1f%%", low * 100, high * 100);
+            }
+
+            ImGui::EndTable();
+        }
+    }
+
+    // Shows how likely each player is to have each role, given only what the public knows. Recomputed in the background when the state changes.
+    void DisplayInference()
+    {
+        if (!role_inference)
+            role_inference = std::make_unique<RoleInference>();
+        if (inference_requested_version != state_version)
+        {
+            inference_requested_version = state_version;
+            role_inference->Request(this_round.state.days, settings);
+        }
+
+        const std::shared_ptr<const InferenceResult> result = role_inference->Result();
+        if (role_inference->IsBusy())
+            RequestRedrawIn(0.1);
+
+        if (!result || role_inference->IsBusy())
+            ImGui::TextDisabled("%s", strings[StringId::stats_loading]);
+        else if (!result->consistent)
+            ImGui::TextWrapped("%s", strings[StringId::inference_inconsistent]);
+        else if (result->exact)
+            ImGui::TextDisabled("%s", strings[StringId::inference_exact]);
+        else
+            ImGui::TextDisabled(strings[StringId::inference_approximate], (long long)result->num_samples);
+
+        if (!result || !result->consistent)
+            return;
+
+        // Only the roles that someone can have.
+        const PlayerTable &players = CurrentPlayers();
+        std::vector<Role> roles;
+        for (int i = 0; i < int(Role::_count); i++)
+        {
+            if (players.role_mask & (1u << i))
+                roles.push_back(Role(i));
+        }
+
+        if (ImGui::BeginTable("inference", int(roles.size()) + 1, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_ScrollY, ImVec2(0, ImGui::GetIO().DisplaySize.y / 2)))
+        {
+            ImGui::TableSetupScrollFreeze(1, 1);
+            ImGui::TableSetupColumn(strings[StringId::inference_player]);
+            for (Role role : roles)
+                ImGui::TableSetupColumn(strings.RoleName(role));
+            ImGui::TableHeadersRow();
+
+            ImGuiListClipper clipper;
+            clipper.Begin(int(players.Size()));
+            while (clipper.Step())
+            {
+                for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+                {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::TextUnformatted(this_round.state.names[players.names[std::size_t(i)]].c_str());
+
+                    // The result can be a bit older than the table, while the new one is computed, so it can miss the new players.
+                    const std::array<float, int(Role::_count)> *probabilities = result->Find(players.ids[std::size_t(i)]);
+                    for (Role role : roles)
+                    {
+                        ImGui::TableNextColumn();
+                        if (probabilities)
+                            ImGui::Text("%.0f%%", (*probabilities)[std::size_t(role)] * 100);
+                    }
+                }
+            }
 
-enum class Faction
-{
-    // Sync with `Strings::factions`.
-    peaceful,
-    mafia,
-    yakuza,
-    killer,
-    _count [[maybe_unused]],
-};
+            ImGui::EndTable();
+        }
+    }
 
-[[nodiscard]] static Faction RoleToFaction(Role role)
-{
-    switch (role)
+    // The tournament setup, or the list of tables. The commands are returned in `command` rather than executed, since they replace `this_round`.
+    void DisplayTournament(std::optional<Command> &command, bool &close_menu)
     {
-        case Role::captain:    return Faction::peaceful;
-        case Role::sheriff:    return Faction::peaceful;
-        case Role::prostitute: return Faction::peaceful;
-        case Role::mafia_boss: return Faction::mafia;
-        case Role::mafia:      return Faction::mafia;
-        case Role::yakuza:     return Faction::yakuza;
-        case Role::killer:     return Faction::killer;
-        case Role::none:       return Faction::peaceful;
-    }
-}
+        if (!tournament.IsActive())
+        {
+            const int num_players = int(CurrentPlayers().Size());
+            ImGui::Text(strings[StringId::tournament_setup], num_players);
 
-static void ModalPopup(const std::string &name, std::function<void()> body)
-{
-    if (!ImGui::IsPopupOpen(name.c_str()))
-        return;
+            ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x / 2);
+            ImGui::InputInt(strings[StringId::tournament_num_tables], &tournament_num_tables_for_modal);
+            tournament_num_tables_for_modal = std::clamp(tournament_num_tables_for_modal, 1, std::max(1, std::min(num_players, int(Tournament::max_tables))));
 
-    ImGui::SetNextWindowPos(ImVec2(ImGui::GetIO().DisplaySize.x / 2, ImGui::GetIO().DisplaySize.y / 2), ImGuiCond_Always, ImVec2(0.5f, 0.5f));
-    if (ImGui::BeginPopupModal(name.c_str(), nullptr, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoMove))
-    {
-        body();
-        ImGui::EndPopup();
-    }
-}
+            ImGui::BeginDisabled(num_players == 0);
+            if (ImGui::Button(strings[StringId::tournament_start], ImVec2(ImGui::GetContentRegionAvail().x, 0)))
+            {
+                command = Commands::StartTournament{.num_tables = tournament_num_tables_for_modal};
+                close_menu = true;
+                ImGui::CloseCurrentPopup();
+            }
+            ImGui::EndDisabled();
+            return;
+        }
 
-struct Strings
-{
-    std::string button_cancel = "Отмена";
-
-    struct RoleStrings
-    {
-        std::string name;
-        std::string prompt;
-    };
-
-    std::array<RoleStrings, int(Role::_count)> roles = {{
-        {.name = "Капитан",       .prompt = "Кого блокирует капитан?"  },
-        {.name = "Шериф",         .prompt = "Кого проверяет шериф?"    },
-        {.name = "Красотка",      .prompt = "К кому приходит красотка?"},
-        {.name = "Дон мафии",     .prompt = "Кого проверяет дон?"      },
-        {.name = "Мафия",         .prompt = "Кого убивает мафия?"      },
-        {.name = "Якудза",        .prompt = "Кого убивает якудза?"     },
-        {.name = "Маньяк",        .prompt = "Кого убивает маньяк?"     },
-        {.name = "Мирный житель", .prompt = "Кого убивает город?"      },
-    }};
-
-    struct FactionStrings
-    {
-        std::string name;
-        std::string name_pl;
-    };
-
-    std::array<FactionStrings, int(Faction::_count)> factions = {{
-        {.name = "Мирный", .name_pl = "Мирные" },
-        {.name = "Мафия",  .name_pl = "Мафия"  },
-        {.name = "Якудза", .name_pl = "Якудза" },
-        {.name = "Маньяк", .name_pl = "Маньяки"},
-    }};
-
-    std::string menu_button = "Меню";
-    std::string menu_window = "Меню";
-    std::string menu_button_back = "Назад";
-    std::string menu_button_new_game = "Новая игра";
-
-    std::string new_game_window = "Начать новую игру?";
-    std::string new_game_confirm = "Новая игра";
-
-    std::string day = "День";
-    std::string night = "Ночь";
-    std::string day_turn = "Город";
-    std::string choosing_roles = "Перекличка";
-
-    std::string players = "Игроки:";
-    std::string turns = "Ход:";
-
-    std::string next_turn = "Дальше";
-    std::string restart_from_here = "Переиграть с этого дня";
-
-    std::string add_player_button = "+ игрок";
-    std::string add_player_window = "Добавить игрока";
-    std::string add_player_name_hint = "Имя";
-    std::string add_player_confirm = "Добавить";
-
-    std::string remove_player_button = "Удалить";
-    std::string remove_player_window = "Удалить игрока";
-    std::string remove_player_confirm = "Удалить";
-
-    std::string edit_role_button = "Сменить роль";
-    std::string edit_role_window = "Сменить роль";
-    std::string edit_role_confirm = "Сменить";
-};
+        ImGui::Text(strings[StringId::tournament_status], int(tournament.seatings.size()), int(tables.size()));
 
-struct Player
-{
-    int id = 0;
-    std::string name;
-    Role role;
-
-    int times_targeted_by_captain = 0;
-    int times_targeted_by_sheriff = 0;
-    int times_targeted_by_prostitute = 0;
-    int times_targeted_by_mafia_boss = 0;
-};
+        // Only the visible rows are submitted, since there can be hundreds of tables.
+        ImGui::BeginChild("tables", ImVec2(ImGui::GetFontSize() * 16, ImGui::GetIO().DisplaySize.y / 2));
+        ImGuiListClipper clipper;
+        clipper.Begin(int(tables.size()));
+        while (clipper.Step())
+        {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+            {
+                const Round &round = Table(std::size_t(i));
+                char label[128];
+                std::snprintf(label, sizeof label, strings[StringId::tournament_table_row], i + 1, int(round.state.days.back().players.Size()), int(round.state.days.size()) - 1);
 
-struct Action
-{
-    std::vector<int> targets;
-};
+                ImGui::PushID(i);
+                if (ImGui::Selectable(label, std::size_t(i) == active_table) && std::size_t(i) != active_table)
+                {
+                    command = Commands::SwitchTable{.index = i};
+                    close_menu = true;
+                    ImGui::CloseCurrentPopup();
+                }
+                ImGui::PopID();
+            }
+        }
+        ImGui::EndChild();
 
-struct Day
-{
-    std::vector<Player> players;
+        if (ImGui::Button(strings[StringId::tournament_next_round], ImVec2(ImGui::GetContentRegionAvail().x, 0)))
+            ImGui::OpenPopup(strings[StringId::tournament_next_round_window]);
 
-    // The indices here are `Role`s.
-    std::array<Action, int(Role::_count)> actions;
+        bool close_outer_modal = false;
+        ModalPopup(strings[StringId::tournament_next_round_window], [&]
+        {
+            if (ImGui::Button(strings[StringId::tournament_next_round]))
+            {
+                command = Commands::NextTournamentRound{};
+                close_outer_modal = true;
+                ImGui::CloseCurrentPopup();
+            }
 
-    [[nodiscard]] bool HavePlayersWithRole(Role role) const
-    {
-        return std::any_of(players.begin(), players.end(), [&](const Player &pl){return pl.role == role;});
+            ImGui::SameLine();
+
+            if (ImGui::Button(strings[StringId::button_cancel]))
+                ImGui::CloseCurrentPopup();
+        });
+        if (close_outer_modal)
+        {
+            close_menu = true;
+            ImGui::CloseCurrentPopup();
+        }
+
+        if (ImGui::Button(strings[StringId::tournament_end], ImVec2(ImGui::GetContentRegionAvail().x, 0)))
+        {
+            command = Commands::EndTournament{};
+            close_menu = true;
+            ImGui::CloseCurrentPopup();
+        }
     }
-};
 
-struct State
-{
-    std::vector<Day> days;
-};
+    // Loads `*.pack` from this directory, if it exists. Logs the errors.
+    void LoadLanguagePacks(const std::string &dir)
+    {
+        std::error_code ec;
+        for (std::filesystem::directory_iterator iter(dir, ec), end; !ec && iter != end; iter.increment(ec))
+        {
+            if (iter->path().extension() != ".pack")
+                continue;
 
-struct Settings
-{
-    std::array<Role, int(Role::_count)> role_order;
+            try
+            {
+                auto &pack = language_packs.emplace_back(std::make_unique<LanguagePack>(iter->path().string()));
+                const StringTable pack_strings = pack->Strings();
+
+                auto it = std::find_if(languages.begin(), languages.end(), [&](const StringTable &language)
+                {
+                    return std::string_view(language[StringId::language_code]) == pack_strings[StringId::language_code];
+                });
+                if (it != languages.end())
+                    *it = pack_strings;
+                else
+                    languages.push_back(pack_strings);
+            }
+            catch (std::exception &e)
+            {
+                SDL_Log("Unable to load the language pack: %s", e.what());
+            }
+        }
+    }
 
-    void SetDefault()
+    // Picks the language remembered in `language_setting_path`, or the one matching the system locale.
+    void LoadLanguageSetting()
     {
-        for (int i = 0; i < int(Role::_count); i++)
-            role_order[std::size_t(i)] = Role(i);
+        std::string code = BuiltinStrings(PreferredBuiltinLanguage())[StringId::language_code];
+        std::size_t size = 0;
+        if (void *data = SDL_LoadFile(language_setting_path.c_str(), &size))
+        {
+            code.assign((const char *)data, size);
+            SDL_free(data);
+        }
+
+        for (const StringTable &language : languages)
+        {
+            if (language[StringId::language_code] == code)
+            {
+                strings = language;
+                return;
+            }
+        }
+        strings = BuiltinStrings(PreferredBuiltinLanguage());
     }
-};
 
-struct Round
-{
-    State state;
+    void SetLanguage(StringTable language)
+    {
+        strings = language;
+
+        if (!language_setting_path.empty())
+        {
+            const std::string_view code = strings[StringId::language_code];
+            if (!SDL_SaveFile(language_setting_path.c_str(), code.data(), code.size()))
+                SDL_Log("Unable to save the language setting: %s", SDL_GetError());
+        }
+    }
 
-    int active_day_index = 0;
-    int active_role_index = 0; // This is an index into `Settings::role_order`.
+    void Persist() override
+    {
+        // The app might not come back, and those aren't in the journal.
+        UpdateRoundsToArchive({});
 
-    std::array<bool, int(Role::_count)> enabled_roles{};
+        if (journal)
+            journal->Flush();
+    }
 
-    Round()
+    // Call after the moderator moves to the next turn. Pauses the speech, and starts the discussion if the day turn has come, or pauses it otherwise.
+    void UpdateTimersAfterTurn(std::uint64_t now_ns)
     {
-        enabled_roles[std::size_t(Role::none)] = true;
-        enabled_roles[std::size_t(Role::mafia)] = true;
+        speech_timer.Pause(now_ns);
+
+        const Role active_role = settings.role_order[std::size_t(this_round.active_role_index)];
+        if (this_round.active_day_index > 0 && active_role == Role::none && discussion_minutes > 0)
+            discussion_timer.Start(std::uint64_t(discussion_minutes) * 60'000'000'000, now_ns);
+        else
+            discussion_timer.Pause(now_ns);
     }
-};
 
-struct Game : BasicGame
-{
-    Settings settings;
-    Round this_round;
-    Strings strings;
+    // Alerts the moderator when a timer runs out, and wakes up exactly when a displayed timer changes next.
+    // The timers don't redraw continuously: a frame is only drawn once per second while one runs, and not at all while they're paused.
+    void UpdateTimers(std::uint64_t now_ns)
+    {
+        const bool discussion_ended = discussion_timer.TakeDeadline(now_ns);
+        const bool speech_ended = speech_timer.TakeDeadline(now_ns);
+        if (discussion_ended || speech_ended)
+        {
+            Vibrate(vibration_duration_ms);
+            flash_end_ns = now_ns + flash_duration_ns;
+        }
 
-    std::string add_player_textbox_for_modal;
-    Role new_player_role_for_modal{};
+        RequestRedrawAt(std::min(discussion_timer.NextChange(now_ns), speech_timer.NextChange(now_ns)));
 
-    int player_id_counter = 1;
+        if (now_ns < flash_end_ns)
+        {
+            ImGui::GetForegroundDrawList()->AddRectFilled(ImVec2{}, ImGui::GetIO().DisplaySize, ImGui::GetColorU32(ImVec4(1, 0.2f, 0.1f, 0.4f)));
+            RequestRedrawAt(flash_end_ns);
+        }
+    }
 
-    void SetFirstActiveRole()
+    // Draws a timer on the current line of the status, ending at `right_x` (in window coordinates): the time left, then the pause and stop buttons.
+    // Returns where the next timer to the left of it should end.
+    [[nodiscard]] float DisplayTimer(Countdown &timer, const char *label, std::uint64_t now_ns, float right_x)
     {
-        if (!this_round.state.days[std::size_t(this_round.active_day_index)].players.empty())
+        if (!timer.IsActive())
+            return right_x;
+
+        const int seconds = timer.SecondsLeft(now_ns);
+        char text[256];
+        std::snprintf(text, sizeof text, "%s %d:%02d", label, seconds / 60, seconds % 60);
+        const char *pause_label = timer.IsRunning() ? "||" : ">";
+
+        const ImGuiStyle &style = ImGui::GetStyle();
+        const float width =
+            ImGui::CalcTextSize(text).x +
+            ImGui::CalcTextSize(pause_label).x + ImGui::CalcTextSize("x").x +
+            style.FramePadding.x * 4 + style.ItemSpacing.x * 2;
+
+        ImGui::SameLine(right_x - width);
+        ImGui::PushID(&timer);
+
+        if (seconds == 0)
+            ImGui::TextColored(ImVec4(1, 0.3f, 0.2f, 1), "%s", text);
+        else
+            ImGui::TextUnformatted(text);
+
+        ImGui::SameLine();
+        if (ImGui::SmallButton(pause_label))
         {
-            this_round.active_role_index = -1;
-            NextTurn();
+            if (timer.IsRunning())
+                timer.Pause(now_ns);
+            else
+                timer.Resume(now_ns);
         }
+
+        ImGui::SameLine();
+        if (ImGui::SmallButton("x"))
+            timer.Stop();
+
+        ImGui::PopID();
+        return right_x - width - style.ItemSpacing.x * 2;
     }
 
-    void NextTurn()
+    Game(const GameOptions &options)
     {
-        this_round.active_role_index++;
-        while (true)
+        for (int i = 0; i < int(BuiltinLanguage::_count); i++)
+            languages.push_back(BuiltinStrings(BuiltinLanguage(i)));
+
+        settings.SetDefault();
+
+        State &state = this_round.state;
+        state.days.emplace_back();
+        if (options.players.empty())
+        {
+            state.days.back().players.Add({.id = player_id_counter++, .name = state.names.Intern("Вася"), .role = Role::none});
+            state.days.back().players.Add({.id = player_id_counter++, .name = state.names.Intern("Петя"), .role = Role::mafia});
+        }
+        else
         {
-            if (this_round.active_role_index == int(Role::_count))
+            for (const GameOptions::InitialPlayer &pl : options.players)
             {
-                this_round.state.days.push_back(this_round.state.days.back());
-                this_round.active_day_index = int(this_round.state.days.size()) - 1;
-                SetFirstActiveRole();
+                state.days.back().players.Add({.id = player_id_counter++, .name = state.names.Intern(pl.name), .role = pl.role});
+                this_round.enabled_roles[std::size_t(pl.role)] = true;
             }
-
-            if (this_round.state.days[std::size_t(this_round.active_day_index)].HavePlayersWithRole(settings.role_order[std::size_t(this_round.active_role_index)]))
-                break;
-            this_round.active_role_index++;
         }
+        SetFirstActiveRole();
     }
 
-    Game()
-    {
-        settings.SetDefault();
+    Game(const Game &) = delete;
+    Game &operator=(const Game &) = delete;
 
-        this_round.state.days.emplace_back();
-        this_round.state.days.back().players.push_back({player_id_counter++, "Вася", Role::none});
-        this_round.state.days.back().players.push_back({player_id_counter++, "Петя", Role::mafia});
-        SetFirstActiveRole();
+    ~Game()
+    {
+        UpdateRoundsToArchive({});
     }
 
     void Tick() override
     {
+        TRACE_ZONE("Tick");
+
         State &state = this_round.state;
 
         // Clamp active day.
@@ -255,31 +1473,50 @@ struct Game : BasicGame
 
         const Role active_role = settings.role_order[std::size_t(this_round.active_role_index)];
 
+        UpdateRatingLabels();
+
+        const std::uint64_t now_ns = SDL_GetTicksNS();
+
+        // The outcome of the displayed day, kept up to date as the actions change. There are no actions during the roll call.
+        const NightOutcome *night = nullptr;
+        if (this_round.active_day_index > 0)
+        {
+            TRACE_ZONE("Night");
+            night = &night_resolver.Update(active_day, settings);
+        }
+
         ImGui::SetNextWindowPos(ImVec2{});
         ImGui::SetNextWindowSize(ImGui::GetIO().DisplaySize);
         ImGui::Begin("Mafia", nullptr, ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoScrollWithMouse | ImGuiWindowFlags_NoTitleBar);
 
-        // Zeroes are not written here.
-        std::map<Faction, int> faction_summary;
-        for (const Player &pl : active_day.players)
-            faction_summary[RoleToFaction(pl.role)]++;
-
         { // Top status.
+            TRACE_ZONE("Status");
             ImGui::BeginChild("status", ImVec2(0, ImGui::GetTextLineHeight()));
 
+            if (tournament.IsActive())
+            {
+                ImGui::TextDisabled(strings[StringId::tournament_table], int(active_table) + 1);
+                ImGui::SameLine();
+            }
+
             if (this_round.active_day_index == 0 && active_role != Role::none)
             {
-                ImGui::Text("%s - %s", strings.choosing_roles.c_str(), strings.roles[std::size_t(active_role)].name.c_str());
+                ImGui::Text("%s - %s", strings[StringId::choosing_roles], strings.RoleName(active_role));
             }
             else
             {
                 ImGui::Text("%s %i - %s",
-                    active_role == Role::none ? strings.day.c_str() : strings.night.c_str(),
+                    active_role == Role::none ? strings[StringId::day] : strings[StringId::night],
                     this_round.active_day_index,
-                    strings.roles[std::size_t(active_role)].prompt.c_str()
+                    strings.RolePrompt(active_role)
                 );
             }
 
+            // The timers, right-aligned.
+            float timers_right_x = ImGui::GetCursorPosX() + ImGui::GetContentRegionAvail().x;
+            timers_right_x = DisplayTimer(discussion_timer, strings[StringId::timer_discussion], now_ns, timers_right_x);
+            (void)DisplayTimer(speech_timer, speech_player_name.c_str(), now_ns, timers_right_x);
+
             ImGui::EndChild();
 
             ImGui::Separator();
@@ -287,141 +1524,233 @@ struct Game : BasicGame
 
         ImGui::BeginTable("Table", 2, ImGuiTableFlags_NoHostExtendY, ImVec2(ImGui::GetContentRegionAvail().x, ImGui::GetContentRegionAvail().y - ImGui::GetFrameHeight() * 2 - ImGui::GetStyle().ItemSpacing.y * 5 - ImGui::GetTextLineHeight()));
         ImGui::TableNextColumn();
-        ImGui::TextDisabled("%s (%d)", strings.players.c_str(), int(active_day.players.size()));
+        ImGui::TextDisabled("%s (%d)", strings[StringId::players], int(active_day.players.Size()));
         ImGui::BeginChild("player_list", ImGui::GetContentRegionAvail());
 
         { // Player list.
+            TRACE_ZONE("Player list");
             std::size_t player_index_to_remove = -1zu;
+            std::optional<int> player_id_to_target;
 
-            for (std::size_t i = 0; Player &pl : active_day.players)
-            {
-                ImGui::BeginChild(("player_box:" + std::to_string(i)).c_str(), ImVec2(0, ImGui::GetTextLineHeight() * 2 + ImGui::GetStyle().FramePadding.y * 2), ImGuiChildFlags_FrameStyle, ImGuiWindowFlags_NoScrollbar);
-
-                ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2());
-                ImGui::TextUnformatted(pl.name.c_str());
-                ImGui::TextUnformatted(strings.roles[std::size_t(int(pl.role))].name.c_str());
-                ImGui::PopStyleVar();
+            // Tapping a player toggles them as a target of the current turn.
+            const bool can_pick_targets = night && viewing_current_day && active_day.HavePlayersWithRole(active_role);
+            const PlayerSet *active_targets = night ? &night_resolver.Targets(active_role) : nullptr;
 
-                if (ImGui::BeginPopupContextWindow())
-                {
-                    bool close_menu = false;
+            const float row_height = ImGui::GetTextLineHeight() * 2 + ImGui::GetStyle().FramePadding.y * 2;
 
-                    ImGui::TextDisabled("%s", pl.name.c_str());
-                    ImGui::Separator();
+            // Only the visible rows are submitted. The row with an open context menu is always submitted, to keep the menu (and its modals) alive.
+            int player_index_with_menu = -1;
+            ImGuiListClipper clipper;
+            clipper.Begin(int(active_day.players.Size()), row_height + ImGui::GetStyle().ItemSpacing.y);
+            if (player_index_with_menu_prev_frame >= 0 && player_index_with_menu_prev_frame < int(active_day.players.Size()))
+                clipper.IncludeItemByIndex(player_index_with_menu_prev_frame);
 
-                    { // Edit player role.
-                        ImGui::BeginDisabled(!viewing_current_day);
-                        if (ImGui::Selectable(strings.edit_role_button.c_str(), false, ImGuiSelectableFlags_NoAutoClosePopups))
+            while (clipper.Step())
+            {
+                for (std::size_t i = std::size_t(clipper.DisplayStart); i < std::size_t(clipper.DisplayEnd); i++)
+                {
+                    const NameId pl_name_id = active_day.players.names[i];
+                    const std::string &pl_name = state.names[pl_name_id];
+                    const Role pl_role = active_day.players.roles[i];
+
+                    ImGui::PushID(int(i));
+
+                    // The row is a plain item rather than a child window, since those are expensive.
+                    // It has no button behavior, so that pressing it acts like pressing the window background, which lets `TouchController` scroll the list.
+                    const ImVec2 row_pos = ImGui::GetCursorScreenPos();
+                    const ImRect row_rect(row_pos, ImVec2(row_pos.x + ImGui::GetContentRegionAvail().x, row_pos.y + row_height));
+                    ImGui::ItemSize(row_rect);
+                    if (ImGui::ItemAdd(row_rect, ImGui::GetID("player_row")))
+                    {
+                        const ImGuiStyle &style = ImGui::GetStyle();
+                        const bool is_target = active_targets && active_targets->Contains(i);
+                        ImGui::RenderFrame(row_rect.Min, row_rect.Max, ImGui::GetColorU32(is_target ? ImGuiCol_FrameBgActive : ImGuiCol_FrameBg), true, style.FrameRounding);
+
+                        ImDrawList &draw_list = *ImGui::GetWindowDrawList();
+                        const ImVec2 text_pos(row_rect.Min.x + style.FramePadding.x, row_rect.Min.y + style.FramePadding.y);
+                        draw_list.AddText(text_pos, ImGui::GetColorU32(ImGuiCol_Text), pl_name.c_str());
+                        if (std::size_t(pl_name_id) < rating_labels_by_name.size() && !rating_labels_by_name[std::size_t(pl_name_id)].empty())
                         {
-                            ImGui::OpenPopup(strings.edit_role_window.c_str());
-                            new_player_role_for_modal = pl.role;
+                            const std::string &label = rating_labels_by_name[std::size_t(pl_name_id)];
+                            draw_list.AddText(ImVec2(row_rect.Max.x - style.FramePadding.x - ImGui::CalcTextSize(label.c_str()).x, text_pos.y), ImGui::GetColorU32(ImGuiCol_TextDisabled), label.c_str());
                         }
-                        ImGui::EndDisabled();
-                        ModalPopup(strings.edit_role_window, [&]
-                        {
-                            ImGui::TextUnformatted(pl.name.c_str());
+                        draw_list.AddText(ImVec2(text_pos.x, text_pos.y + ImGui::GetTextLineHeight()), ImGui::GetColorU32(ImGuiCol_Text), strings.RoleName(pl_role));
 
-                            ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
-                            if (ImGui::BeginCombo("###role", strings.roles[std::size_t(int(new_player_role_for_modal))].name.c_str()))
+                        // The outcome of the day for this player, right-aligned on the second line.
+                        if (night)
+                        {
+                            std::array<const char *, 3> tags{};
+                            std::size_t num_tags = 0;
+                            if (night->killed.Contains(i))
+                                tags[num_tags++] = strings[StringId::night_killed];
+                            else if (night->executed.Contains(i))
+                                tags[num_tags++] = strings[StringId::night_executed];
+                            else if (night->protected_players.Contains(i))
+                                tags[num_tags++] = strings[StringId::night_protected];
+                            if (night->sheriff_checked.Contains(i))
+                                tags[num_tags++] = strings[night->sheriff_found.Contains(i) ? StringId::night_sheriff_found : StringId::night_sheriff_not_found];
+                            if (night->boss_checked.Contains(i))
+                                tags[num_tags++] = strings[night->boss_found.Contains(i) ? StringId::night_boss_found : StringId::night_boss_not_found];
+
+                            float tag_x = row_rect.Max.x - style.FramePadding.x;
+                            for (std::size_t j = num_tags; j-- > 0;)
                             {
-                                for (int i = 0; i < int(Role::_count); i++)
-                                {
-                                    if (ImGui::Selectable(strings.roles[std::size_t(i)].name.c_str(), i == int(new_player_role_for_modal)))
-                                        new_player_role_for_modal = Role(i);
-                                }
-                                ImGui::EndCombo();
+                                tag_x -= ImGui::CalcTextSize(tags[j]).x;
+                                draw_list.AddText(ImVec2(tag_x, text_pos.y + ImGui::GetTextLineHeight()), ImGui::GetColorU32(ImGuiCol_Text), tags[j]);
+                                tag_x -= style.ItemSpacing.x;
                             }
+                        }
+                    }
+
+                    if (can_pick_targets && ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenBlockedByActiveItem) && IsTap())
+                        player_id_to_target = active_day.players.ids[i];
+
+                    if (ImGui::BeginPopupContextItem())
+                    {
+                        player_index_with_menu = int(i);
+
+                        bool close_menu = false;
 
-                            ImGui::Spacing();
+                        ImGui::TextDisabled("%s", pl_name.c_str());
+                        ImGui::Separator();
 
-                            // Confirm button.
-                            if (ImGui::Button(strings.edit_role_confirm.c_str()))
+                        { // Time the player's speech.
+                            char label[256];
+                            std::snprintf(label, sizeof label, strings[StringId::timer_speech], speech_seconds);
+                            const bool speech = ImGui::Selectable(label);
+                            std::snprintf(label, sizeof label, strings[StringId::timer_final_speech], final_speech_seconds);
+                            const bool final_speech = ImGui::Selectable(label);
+                            if (speech || final_speech)
                             {
-                                close_menu = true;
-                                pl.role = new_player_role_for_modal;
-                                ImGui::CloseCurrentPopup();
+                                speech_player_name = pl_name;
+                                speech_timer.Start(std::uint64_t(speech ? speech_seconds : final_speech_seconds) * 1'000'000'000, now_ns);
                             }
-                            ImGui::SameLine();
-                            // Cancel button.
-                            if (ImGui::Button(strings.button_cancel.c_str()) || ImGui::IsKeyPressed(ImGuiKey_Escape, false))
+                        }
+
+                        { // Edit player role.
+                            ImGui::BeginDisabled(!viewing_current_day);
+                            if (ImGui::Selectable(strings[StringId::edit_role_button], false, ImGuiSelectableFlags_NoAutoClosePopups))
                             {
-                                close_menu = true;
-                                ImGui::CloseCurrentPopup();
+                                ImGui::OpenPopup(strings[StringId::edit_role_window]);
+                                new_player_role_for_modal = pl_role;
                             }
-                        });
-                    }
+                            ImGui::EndDisabled();
+                            ModalPopup(strings[StringId::edit_role_window], [&]
+                            {
+                                ImGui::TextUnformatted(pl_name.c_str());
 
-                    { // Delete the player.
-                        ImGui::BeginDisabled(!viewing_current_day);
-                        if (ImGui::Selectable(strings.remove_player_button.c_str(), false, ImGuiSelectableFlags_NoAutoClosePopups))
-                            ImGui::OpenPopup(strings.remove_player_window.c_str());
-                        ImGui::EndDisabled();
-                        ModalPopup(strings.remove_player_window, [&]
-                        {
-                            ImGui::TextUnformatted(pl.name.c_str());
-                            ImGui::Spacing();
+                                ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+                                if (ImGui::BeginCombo("###role", strings.RoleName(new_player_role_for_modal)))
+                                {
+                                    for (int i = 0; i < int(Role::_count); i++)
+                                    {
+                                        if (ImGui::Selectable(strings.RoleName(Role(i)), i == int(new_player_role_for_modal)))
+                                            new_player_role_for_modal = Role(i);
+                                    }
+                                    ImGui::EndCombo();
+                                }
 
-                            // Confirm button.
-                            if (ImGui::Button(strings.remove_player_confirm.c_str()))
-                            {
-                                player_index_to_remove = i;
-                                close_menu = true;
-                                ImGui::CloseCurrentPopup();
-                            }
-                            ImGui::SameLine();
-                            // Cancel button.
-                            if (ImGui::Button(strings.button_cancel.c_str()) || ImGui::IsKeyPressed(ImGuiKey_Escape, false))
+                                ImGui::Spacing();
+
+                                // Confirm button.
+                                if (ImGui::Button(strings[StringId::edit_role_confirm]))
+                                {
+                                    close_menu = true;
+                                    Execute(Commands::SetPlayerRole{.index = i, .role = new_player_role_for_modal});
+                                    ImGui::CloseCurrentPopup();
+                                }
+                                ImGui::SameLine();
+                                // Cancel button.
+                                if (ImGui::Button(strings[StringId::button_cancel]) || ImGui::IsKeyPressed(ImGuiKey_Escape, false))
+                                {
+                                    close_menu = true;
+                                    ImGui::CloseCurrentPopup();
+                                }
+                            });
+                        }
+
+                        { // Delete the player.
+                            ImGui::BeginDisabled(!viewing_current_day);
+                            if (ImGui::Selectable(strings[StringId::remove_player_button], false, ImGuiSelectableFlags_NoAutoClosePopups))
+                                ImGui::OpenPopup(strings[StringId::remove_player_window]);
+                            ImGui::EndDisabled();
+                            ModalPopup(strings[StringId::remove_player_window], [&]
                             {
-                                close_menu = true;
-                                ImGui::CloseCurrentPopup();
-                            }
-                        });
-                    }
+                                ImGui::TextUnformatted(pl_name.c_str());
+                                ImGui::Spacing();
 
-                    if (close_menu)
-                        ImGui::CloseCurrentPopup();
+                                // Confirm button.
+                                if (ImGui::Button(strings[StringId::remove_player_confirm]))
+                                {
+                                    player_index_to_remove = i;
+                                    close_menu = true;
+                                    ImGui::CloseCurrentPopup();
+                                }
+                                ImGui::SameLine();
+                                // Cancel button.
+                                if (ImGui::Button(strings[StringId::button_cancel]) || ImGui::IsKeyPressed(ImGuiKey_Escape, false))
+                                {
+                                    close_menu = true;
+                                    ImGui::CloseCurrentPopup();
+                                }
+                            });
+                        }
 
-                    ImGui::EndPopup();
-                }
+                        if (close_menu)
+                            ImGui::CloseCurrentPopup();
 
-                ImGui::EndChild();
+                        ImGui::EndPopup();
+                    }
 
-                i++;
+                    ImGui::PopID();
+                }
             }
 
-            if (player_index_to_remove < active_day.players.size())
-                active_day.players.erase(active_day.players.begin() + std::ptrdiff_t(player_index_to_remove));
+            player_index_with_menu_prev_frame = player_index_with_menu;
+
+            if (player_index_to_remove < active_day.players.Size())
+                Execute(Commands::RemovePlayer{.index = player_index_to_remove});
+            else if (player_id_to_target)
+            {
+                const std::vector<int> &targets = (*active_day.actions)[std::size_t(active_role)].targets;
+                std::vector<int> new_targets = targets;
+                if (auto it = std::find(new_targets.begin(), new_targets.end(), *player_id_to_target); it != new_targets.end())
+                    new_targets.erase(it);
+                else
+                    new_targets.push_back(*player_id_to_target);
+                Execute(Commands::SetTargets{.role = active_role, .old_targets = targets, .new_targets = std::move(new_targets)});
+            }
 
             // "Add player" button.
             if (viewing_current_day)
             {
-                if (ImGui::Button(strings.add_player_button.c_str()))
+                if (ImGui::Button(strings[StringId::add_player_button]))
                 {
-                    ImGui::OpenPopup(strings.add_player_window.c_str());
+                    ImGui::OpenPopup(strings[StringId::add_player_window]);
                     add_player_textbox_for_modal.clear();
                 }
 
-                ModalPopup(strings.add_player_window, [&]
+                ModalPopup(strings[StringId::add_player_window], [&]
                 {
                     ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
                     if (ImGui::IsWindowAppearing())
                         ImGui::SetKeyboardFocusHere();
-                    bool confirmed = ImGui::InputTextWithHint("###player name", strings.add_player_name_hint.c_str(), &add_player_textbox_for_modal, ImGuiInputTextFlags_EnterReturnsTrue);
+                    bool confirmed = ImGui::InputTextWithHint("###player name", strings[StringId::add_player_name_hint], &add_player_textbox_for_modal, ImGuiInputTextFlags_EnterReturnsTrue);
 
                     ImGui::Spacing();
 
                     // Confirm button.
                     ImGui::BeginDisabled(add_player_textbox_for_modal.empty());
-                    if (ImGui::Button(strings.add_player_confirm.c_str()) || (!add_player_textbox_for_modal.empty() && confirmed))
+                    if (ImGui::Button(strings[StringId::add_player_confirm]) || (!add_player_textbox_for_modal.empty() && confirmed))
                     {
-                        active_day.players.push_back(Player{.id = player_id_counter++, .name = std::move(add_player_textbox_for_modal), .role = Role::none});
+                        Execute(Commands::AddPlayer{.name = add_player_textbox_for_modal});
                         add_player_textbox_for_modal.clear();
                         ImGui::CloseCurrentPopup();
                     }
                     ImGui::EndDisabled();
                     ImGui::SameLine();
                     // Cancel button.
-                    if (ImGui::Button(strings.button_cancel.c_str()) || ImGui::IsKeyPressed(ImGuiKey_Escape, false))
+                    if (ImGui::Button(strings[StringId::button_cancel]) || ImGui::IsKeyPressed(ImGuiKey_Escape, false))
                     {
                         add_player_textbox_for_modal.clear();
                         ImGui::CloseCurrentPopup();
@@ -432,36 +1761,36 @@ struct Game : BasicGame
 
         ImGui::EndChild();
         ImGui::TableNextColumn();
-        ImGui::TextDisabled("%s", strings.turns.c_str());
+        ImGui::TextDisabled("%s", strings[StringId::turns]);
         ImGui::BeginChild("turn_list");
 
         { // Turns.
+            TRACE_ZONE("Turns");
             bool first_role = true;
             for (int i = 0; i < int(Role::_count); i++)
             {
                 const Role this_role = settings.role_order[std::size_t(i)];
-                Action &this_action = active_day.actions[std::size_t(this_role)];
 
                 if (this_round.active_day_index > 0 && !this_round.enabled_roles[std::size_t(this_role)])
                     continue;
 
                 const bool have_players = this_round.active_day_index > 0 ? active_day.HavePlayersWithRole(this_role) : this_round.enabled_roles[std::size_t(this_role)];
 
-                std::string_view turn_name;
+                const char *turn_name = nullptr;
                 if (this_role != Role::none)
                 {
                     if (this_round.active_day_index > 0 && std::exchange(first_role, false))
-                        ImGui::SeparatorText(strings.night.c_str());
+                        ImGui::SeparatorText(strings[StringId::night]);
 
-                    turn_name = strings.roles[std::size_t(this_role)].name;
+                    turn_name = strings.RoleName(this_role);
                 }
                 else
                 {
                     if (this_round.active_day_index == 0)
                         continue;
 
-                    ImGui::SeparatorText(strings.day.c_str());
-                    turn_name = strings.day_turn;
+                    ImGui::SeparatorText(strings[StringId::day]);
+                    turn_name = strings[StringId::day_turn];
                 }
 
                 const ImVec2 base_pos = ImGui::GetCursorPos();
@@ -470,19 +1799,26 @@ struct Game : BasicGame
                 {
                     ImGui::SetCursorPosX(base_pos.x + ImGui::GetContentRegionAvail().x - ImGui::GetFrameHeight());
 
-                    ImGui::Checkbox(("###toggle_role:" + std::to_string(i)).c_str(), &this_round.enabled_roles[std::size_t(this_role)]);
+                    ImGui::PushID(i);
+                    bool enabled = this_round.enabled_roles[std::size_t(this_role)];
+                    if (ImGui::Checkbox("###toggle_role", &enabled))
+                        Execute(Commands::SetRoleEnabled{.role = this_role, .enabled = enabled});
+                    ImGui::PopID();
                     ImGui::SameLine();
 
                     ImGui::SetCursorPos(base_pos);
                 }
 
                 ImGui::BeginDisabled(!have_players);
-                ImGui::RadioButton(turn_name.data(), &this_round.active_role_index, i);
+                if (ImGui::RadioButton(turn_name, this_round.active_role_index == i))
+                    Execute(Commands::SetActiveRole{.index = i});
                 ImGui::EndDisabled();
 
-
-                if (!have_players && viewing_current_day)
-                    this_action = {}; // Reset the action, just in case.
+                if (night && night->blocked_roles & (1u << int(this_role)))
+                {
+                    ImGui::SameLine();
+                    ImGui::TextDisabled("(%s)", strings[StringId::night_blocked]);
+                }
             }
         }
 
@@ -490,41 +1826,70 @@ struct Game : BasicGame
         ImGui::EndTable();
 
         { // Summary.
+            TRACE_ZONE("Summary");
             ImGui::Separator();
 
-            std::string summary_str;
-            for (auto [fac, n] : faction_summary)
+            ImGui::BeginChild("factions_summary", ImVec2(0, ImGui::GetTextLineHeight()));
+
+            // This is printed piece by piece, rather than concatenated into a string, to avoid heap allocations.
+            bool first_faction = true;
+            for (int fac = 0; fac < int(Faction::_count); fac++)
             {
-                if (!summary_str.empty())
-                    summary_str += " | ";
-                const auto &strs = strings.factions[std::size_t(fac)];
-                summary_str += n == 1 ? strs.name : strs.name_pl;
-                summary_str += ": ";
-                summary_str += std::to_string(n);
+                const int n = active_day.players.faction_counts[std::size_t(fac)];
+                if (n == 0)
+                    continue;
+
+                if (!std::exchange(first_faction, false))
+                {
+                    ImGui::SameLine(0, 0);
+                    ImGui::TextUnformatted(" | ");
+                    ImGui::SameLine(0, 0);
+                }
+
+                ImGui::Text("%s: %d", n == 1 ? strings.FactionName(Faction(fac)) : strings.FactionNamePlural(Faction(fac)), n);
             }
 
-            ImGui::BeginChild("factions_summary", ImVec2(0, ImGui::GetTextLineHeight()));
-            ImGui::TextUnformatted(summary_str.c_str());
             ImGui::EndChild();
         }
 
         bool want_new_game = false;
+        std::optional<Command> tournament_command;
+        bool want_undo = ImGui::Shortcut(ImGuiMod_Ctrl | ImGuiKey_Z, ImGuiInputFlags_RouteGlobal);
+        bool want_redo = ImGui::Shortcut(ImGuiMod_Ctrl | ImGuiKey_Y, ImGuiInputFlags_RouteGlobal) || ImGui::Shortcut(ImGuiMod_Ctrl | ImGuiMod_Shift | ImGuiKey_Z, ImGuiInputFlags_RouteGlobal);
 
         { // Bottom buttons.
+            TRACE_ZONE("Bottom buttons");
             ImGui::Separator();
 
-            if (ImGui::Button(strings.menu_button.c_str()))
-                ImGui::OpenPopup(strings.menu_window.c_str());
-            ModalPopup(strings.menu_button, [&]
+            if (ImGui::Button(strings[StringId::menu_button]) || std::exchange(reopen_menu, false))
+                ImGui::OpenPopup(strings[StringId::menu_window]);
+            ModalPopup(strings[StringId::menu_window], [&]
             {
+                { // Undo and redo buttons.
+                    const float width = std::round((ImGui::GetContentRegionAvail().x - ImGui::GetStyle().ItemSpacing.x) / 2);
+
+                    ImGui::BeginDisabled(!undo_history.CanUndo());
+                    if (ImGui::Button(strings[StringId::menu_button_undo], ImVec2(width, 0)))
+                        want_undo = true;
+                    ImGui::EndDisabled();
+
+                    ImGui::SameLine();
+
+                    // Same as the "next turn" button.
+                    ImGui::BeginDisabled(!undo_history.CanRedo() || !viewing_current_day);
+                    if (ImGui::Button(strings[StringId::menu_button_redo], ImVec2(ImGui::GetContentRegionAvail().x, 0)))
+                        want_redo = true;
+                    ImGui::EndDisabled();
+                }
+
                 // New game button.
-                if (ImGui::Button(strings.menu_button_new_game.c_str(), ImVec2(ImGui::GetContentRegionAvail().x, 0)))
-                    ImGui::OpenPopup(strings.new_game_window.c_str());
+                if (ImGui::Button(strings[StringId::menu_button_new_game], ImVec2(ImGui::GetContentRegionAvail().x, 0)))
+                    ImGui::OpenPopup(strings[StringId::new_game_window]);
 
                 bool close_outer_modal = false;
-                ModalPopup(strings.new_game_window, [&]
+                ModalPopup(strings[StringId::new_game_window], [&]
                 {
-                    if (ImGui::Button(strings.new_game_confirm.c_str()))
+                    if (ImGui::Button(strings[StringId::new_game_confirm]))
                     {
                         close_outer_modal = true;
                         want_new_game = true;
@@ -533,22 +1898,145 @@ struct Game : BasicGame
 
                     ImGui::SameLine();
 
-                    if (ImGui::Button(strings.button_cancel.c_str()))
+                    if (ImGui::Button(strings[StringId::button_cancel]))
                         ImGui::CloseCurrentPopup();
                 });
                 if (close_outer_modal)
                     ImGui::CloseCurrentPopup();
 
+                // The tournament mode, with several tables at once.
+                if (ImGui::Button(strings[StringId::menu_button_tournament], ImVec2(ImGui::GetContentRegionAvail().x, 0)))
+                    ImGui::OpenPopup(strings[StringId::tournament_window]);
+                bool close_menu = false;
+                ModalPopup(strings[StringId::tournament_window], [&]
+                {
+                    DisplayTournament(tournament_command, close_menu);
+
+                    if (ImGui::Button(strings[StringId::menu_button_back], ImVec2(ImGui::GetContentRegionAvail().x, 0)))
+                        ImGui::CloseCurrentPopup();
+                });
+                if (close_menu)
+                    ImGui::CloseCurrentPopup();
+
+                // Frame timing overlay toggle.
+                ImGui::Checkbox(strings[StringId::menu_checkbox_frame_stats], &frame_stats.overlay_visible);
+
+                { // The length of the day discussion. It's timed from the day turn.
+                    const auto format_minutes = [&](char (&buffer)[64], int minutes) -> const char *
+                    {
+                        if (minutes == 0)
+                            return strings[StringId::menu_timer_off];
+                        std::snprintf(buffer, sizeof buffer, strings[StringId::menu_timer_minutes], minutes);
+                        return buffer;
+                    };
+
+                    char preview[64];
+                    ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x - ImGui::CalcTextSize(strings[StringId::menu_discussion_timer]).x - ImGui::GetStyle().ItemInnerSpacing.x);
+                    if (ImGui::BeginCombo(strings[StringId::menu_discussion_timer], format_minutes(preview, discussion_minutes)))
+                    {
+                        for (int minutes : {0, 1, 2, 3, 5, 10})
+                        {
+                            char label[64];
+                            if (ImGui::Selectable(format_minutes(label, minutes), minutes == discussion_minutes))
+                                discussion_minutes = minutes;
+                        }
+                        ImGui::EndCombo();
+                    }
+                }
+
+                // Language selection. Switching only repoints `strings`, but the popup names change with it, so reopen the menu under its new name.
+                ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x - ImGui::CalcTextSize(strings[StringId::menu_language]).x - ImGui::GetStyle().ItemInnerSpacing.x);
+                if (ImGui::BeginCombo(strings[StringId::menu_language], strings[StringId::language_name]))
+                {
+                    for (std::size_t i = 0; i < languages.size(); i++)
+                    {
+                        const bool selected = std::string_view(languages[i][StringId::language_code]) == strings[StringId::language_code];
+                        if (ImGui::Selectable(languages[i][StringId::language_name], selected) && !selected)
+                        {
+                            SetLanguage(languages[i]);
+                            reopen_menu = true;
+                        }
+                    }
+                    ImGui::EndCombo();
+                }
+
+                // Broadcasting to the players' devices. There are no threads in our web build, so it's not available there.
+                #ifndef __EMSCRIPTEN__
+                bool broadcasting = bool(replication_server);
+                if (ImGui::Checkbox(strings[StringId::menu_checkbox_broadcast], &broadcasting))
+                    SetBroadcasting(broadcasting);
+                if (replication_server)
+                {
+                    if (broadcast_local_address.empty())
+                        ImGui::TextDisabled(strings[StringId::broadcast_port], int(replication_server->Port()), replication_server->NumSubscribers());
+                    else
+                        ImGui::TextDisabled(strings[StringId::broadcast_address], broadcast_local_address.c_str(), int(replication_server->Port()), replication_server->NumSubscribers());
+                    // Keep the number of subscribers up to date.
+                    RequestRedrawIn(1);
+                }
+                else if (!broadcast_error.empty())
+                {
+                    ImGui::TextWrapped("%s", broadcast_error.c_str());
+                }
+
+                // The statistics over the archived games.
+                if (archive_writer)
+                {
+                    if (ImGui::Button(strings[StringId::menu_button_stats], ImVec2(ImGui::GetContentRegionAvail().x, 0)))
+                    {
+                        StartStatsQuery();
+                        ImGui::OpenPopup(strings[StringId::stats_window]);
+                    }
+                    ModalPopup(strings[StringId::stats_window], [&]
+                    {
+                        DisplayStats();
+
+                        if (ImGui::Button(strings[StringId::menu_button_back], ImVec2(ImGui::GetContentRegionAvail().x, 0)))
+                            ImGui::CloseCurrentPopup();
+                    });
+                }
+
+                // The balance simulation. It keeps running if the window is closed.
+                if (ImGui::Button(strings[StringId::menu_button_simulation], ImVec2(ImGui::GetContentRegionAvail().x, 0)))
+                    ImGui::OpenPopup(strings[StringId::simulation_window]);
+                ModalPopup(strings[StringId::simulation_window], [&]
+                {
+                    DisplaySimulation();
+
+                    if (ImGui::Button(strings[StringId::menu_button_back], ImVec2(ImGui::GetContentRegionAvail().x, 0)))
+                        ImGui::CloseCurrentPopup();
+                });
+
+                // The role probabilities, for the commentators.
+                if (ImGui::Button(strings[StringId::menu_button_inference], ImVec2(ImGui::GetContentRegionAvail().x, 0)))
+                    ImGui::OpenPopup(strings[StringId::inference_window]);
+                ModalPopup(strings[StringId::inference_window], [&]
+                {
+                    DisplayInference();
+
+                    if (ImGui::Button(strings[StringId::menu_button_back], ImVec2(ImGui::GetContentRegionAvail().x, 0)))
+                        ImGui::CloseCurrentPopup();
+                });
+                #endif
+
+                #if ENABLE_TRACING
+                if (ImGui::Button(strings[StringId::menu_button_save_trace], ImVec2(ImGui::GetContentRegionAvail().x, 0)))
+                    SaveTrace();
+                #endif
+
                 // Close menu button.
-                if (ImGui::Button(strings.menu_button_back.c_str(), ImVec2(ImGui::GetContentRegionAvail().x, 0)))
+                if (ImGui::Button(strings[StringId::menu_button_back], ImVec2(ImGui::GetContentRegionAvail().x, 0)))
                     ImGui::CloseCurrentPopup();
             });
 
             ImGui::SameLine();
 
             ImGui::BeginDisabled(!viewing_current_day);
-            if (ImGui::Button(strings.next_turn.c_str(), ImVec2(ImGui::GetContentRegionAvail().x, 0)))
-                NextTurn();
+            if (ImGui::Button(strings[StringId::next_turn], ImVec2(ImGui::GetContentRegionAvail().x, 0)))
+            {
+                Execute(Commands::NextTurn{});
+                UpdateTimersAfterTurn(now_ns);
+            }
             ImGui::EndDisabled();
 
             const float width = std::round((ImGui::GetContentRegionAvail().x + ImGui::GetStyle().ItemSpacing.x) / 4 - ImGui::GetStyle().ItemSpacing.x);
@@ -583,30 +2071,72 @@ struct Game : BasicGame
 
             // Actually switch day.
             if (next_day_index != -1)
-            {
-                this_round.active_day_index = next_day_index;
-                if (viewing_current_day)
-                    SetFirstActiveRole();
-            }
+                Execute(Commands::SetActiveDay{.index = next_day_index});
         }
 
         ImGui::End();
 
+        UpdateTimers(now_ns);
+
         // Lastly, act on the "new game" button.
         if (std::exchange(want_new_game, false))
-        {
-            auto players = std::move(state.days.back().players);
-            auto roles = std::move(this_round.enabled_roles);
-            state = {};
-            state.days.emplace_back();
+            Execute(Commands::NewGame{});
+
+        // The tournament commands are delayed too, since they replace `this_round`.
+        if (tournament_command)
+            Execute(*tournament_command);
 
-            state.days.back().players = std::move(players);
-            this_round.enabled_roles = std::move(roles);
+        // Undo and redo are delayed too, since they can remove days.
+        if (want_undo)
+            Undo();
+        else if (want_redo && viewing_current_day)
+            Redo();
+
+        // Send the changes made during this frame to the players.
+        if (replication_server && std::exchange(public_view_dirty, false))
+        {
+            UpdatePublicView();
+            replication_server->Publish(public_view);
         }
     }
 };
 
-std::unique_ptr<BasicGame> MakeGame()
+std::unique_ptr<BasicGame> MakeGame(const GameOptions &options)
 {
-    return std::make_unique<Game>();
+    auto ret = std::make_unique<Game>(options);
+
+    // On the web there's no persistent storage worth journaling or archiving to, and no threads in our build.
+    #ifndef __EMSCRIPTEN__
+    if (!options.session_path_prefix.empty())
+    {
+        ret->OpenJournal(options.session_path_prefix);
+    }
+    else if (options.persist_session)
+    {
+        if (char *pref_path = SDL_GetPrefPath("HolyBlackCat", "mafia"))
+        {
+            ret->OpenJournal(std::string(pref_path) + "session");
+            ret->archive_writer = std::make_unique<ArchiveWriter>(std::string(pref_path) + "archive");
+            ret->StartRatingsRecompute();
+
+            // The language packs can be shipped next to the executable, or added by the user.
+            if (const char *base_path = SDL_GetBasePath())
+                ret->LoadLanguagePacks(std::string(base_path) + "languages");
+            ret->LoadLanguagePacks(std::string(pref_path) + "languages");
+            ret->language_setting_path = std::string(pref_path) + "language";
+            ret->LoadLanguageSetting();
+
+            SDL_free(pref_path);
+        }
+        else
+        {
+            SDL_Log("Unable to get the preferences path, the session won't be saved: %s", SDL_GetError());
+        }
+    }
+    #else
+    // There's nowhere to remember the language, so follow the browser.
+    ret->strings = BuiltinStrings(PreferredBuiltinLanguage());
+    #endif
+
+    return ret;
 }
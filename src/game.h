@@ -1,7 +1,30 @@
 #pragma once
 
 #include "basic_game.h"
+#include "state.h"
 
 #include <memory>
+#include <string>
+#include <vector>
 
-[[nodiscard]] std::unique_ptr<BasicGame> MakeGame();
+struct GameOptions
+{
+    // Restore the session from disk on startup, and keep saving it. Ignored on Emscripten, where it's always disabled.
+    bool persist_session = true;
+
+    // If not empty, the session is restored from and saved to `<prefix>.snapshot` and `<prefix>.journal` instead, and nothing else is persisted.
+    // This is used by `tools/journal_replay`. Ignored on Emscripten.
+    std::string session_path_prefix;
+
+    struct InitialPlayer
+    {
+        std::string name;
+        Role role = Role::none;
+    };
+
+    // If not empty, replaces the default players, and the roles they have are enabled. This is used by the benchmark.
+    // Ignored if the session is restored from disk.
+    std::vector<InitialPlayer> players;
+};
+
+[[nodiscard]] std::unique_ptr<BasicGame> MakeGame(const GameOptions &options = {});
@@ -0,0 +1,602 @@
+#include "inference.h"
+
+#include "random.h"
+#include "trace.h"
+
+#include <SDL3/SDL_log.h>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <deque>
+#include <exception>
+#include <limits>
+#include <utility>
+
+static constexpr std::size_t num_roles = std::size_t(Role::_count);
+using RoleCounts = std::array<int, num_roles>;
+
+// The sampler makes this many sweeps (one step per player each) in total, split between the threads, after the burn-in.
+static constexpr std::uint64_t num_sample_sweeps = 10'000;
+static constexpr std::uint64_t num_burn_in_sweeps = 50;
+
+static constexpr double negative_infinity = -std::numeric_limits<double>::infinity();
+
+[[nodiscard]] static double LogAddExp(double a, double b)
+{
+    if (a < b)
+        std::swap(a, b);
+    if (b == negative_infinity)
+        return a;
+    return a + std::log1p(std::exp(b - a));
+}
+
+// The players with the same allowed roles are interchangeable, so the counting and the sampling work on groups of them.
+struct PlayerGroups
+{
+    std::vector<unsigned> masks;
+    std::vector<std::vector<std::size_t>> players;
+};
+
+[[nodiscard]] static PlayerGroups GroupPlayers(const InferenceProblem &problem)
+{
+    PlayerGroups ret;
+    std::array<int, 1 << num_roles> groups_by_mask;
+    groups_by_mask.fill(-1);
+    for (std::size_t i = 0; i < problem.allowed_roles.size(); i++)
+    {
+        int &group = groups_by_mask[problem.allowed_roles[i]];
+        if (group < 0)
+        {
+            group = int(ret.masks.size());
+            ret.masks.push_back(problem.allowed_roles[i]);
+            ret.players.emplace_back();
+        }
+        ret.players[std::size_t(group)].push_back(i);
+    }
+    return ret;
+}
+
+// Calls `func(x)` for each way to split `n` players between the roles in `mask`, with at most `limits[r]` players getting role `r`.
+template <typename F>
+static void ForEachComposition(int n, unsigned mask, const RoleCounts &limits, F &&func)
+{
+    RoleCounts x{};
+    auto Recurse = [&](auto &self, unsigned remaining_roles, int remaining_players) -> void
+    {
+        if (!remaining_roles)
+        {
+            if (remaining_players == 0)
+                func(std::as_const(x));
+            return;
+        }
+
+        const std::size_t r = std::size_t(std::countr_zero(remaining_roles));
+        const unsigned other_roles = remaining_roles & (remaining_roles - 1);
+        // The last role takes everyone who's left.
+        const int min_here = other_roles ? 0 : remaining_players;
+        for (int k = std::min(remaining_players, limits[r]); k >= min_here; k--)
+        {
+            x[r] = k;
+            self(self, other_roles, remaining_players - k);
+        }
+        x[r] = 0;
+    };
+    Recurse(Recurse, mask, n);
+}
+
+// Counts the role assignments exactly, with dynamic programming over the groups: the state is how many players of each role are left to assign.
+// Returns the expected number of players of each role in each group, or an empty vector if there are no valid assignments.
+// Returns null if that takes too many steps, or if it's cancelled.
+[[nodiscard]] static std::optional<std::vector<std::array<double, num_roles>>> CountExactly(
+    const PlayerGroups &groups, const RoleCounts &role_counts, std::uint64_t max_steps, const std::atomic<bool> &cancel
+)
+{
+    TRACE_ZONE("Count exactly");
+
+    const std::size_t num_groups = groups.masks.size();
+
+    // The states are the remaining counts, in a mixed-radix encoding.
+    std::array<std::uint64_t, num_roles> radices{};
+    {
+        std::uint64_t radix = 1;
+        for (std::size_t r = 0; r < num_roles; r++)
+        {
+            radices[r] = radix;
+            if (radix > std::numeric_limits<std::uint64_t>::max() / std::uint64_t(role_counts[r] + 1))
+                return std::nullopt;
+            radix *= std::uint64_t(role_counts[r] + 1);
+        }
+    }
+    auto Encode = [&](const RoleCounts &counts)
+    {
+        std::uint64_t ret = 0;
+        for (std::size_t r = 0; r < num_roles; r++)
+            ret += radices[r] * std::uint64_t(counts[r]);
+        return ret;
+    };
+    auto Decode = [&](std::uint64_t key)
+    {
+        RoleCounts ret{};
+        for (std::size_t r = num_roles; r-- > 0;)
+        {
+            ret[r] = int(key / radices[r]);
+            key %= radices[r];
+        }
+        return ret;
+    };
+    auto NonZeroRoles = [](const RoleCounts &counts)
+    {
+        unsigned ret = 0;
+        for (std::size_t r = 0; r < num_roles; r++)
+        {
+            if (counts[r] > 0)
+                ret |= 1u << r;
+        }
+        return ret;
+    };
+
+    // How many players of each role the groups starting from the N-th one can take. A state is dead if it has more left than that.
+    std::vector<RoleCounts> capacities(num_groups + 1);
+    for (std::size_t g = num_groups; g-- > 0;)
+    {
+        capacities[g] = capacities[g + 1];
+        for (std::size_t r = 0; r < num_roles; r++)
+        {
+            if (groups.masks[g] & (1u << r))
+                capacities[g][r] += int(groups.players[g].size());
+        }
+    }
+
+    std::vector<double> log_factorials(groups.masks.empty() ? 1 : 1 + std::max_element(groups.players.begin(), groups.players.end(), [](const auto &a, const auto &b){return a.size() < b.size();})->size());
+    for (std::size_t i = 1; i < log_factorials.size(); i++)
+        log_factorials[i] = log_factorials[i - 1] + std::log(double(i));
+    // The number of ways to give the roles to the players of a group, given how many of each role there are.
+    auto LogWays = [&](std::size_t g, const RoleCounts &x)
+    {
+        double ret = log_factorials[groups.players[g].size()];
+        for (int count : x)
+            ret -= log_factorials[std::size_t(count)];
+        return ret;
+    };
+
+    std::uint64_t steps = 0;
+    auto Step = [&]
+    {
+        return ++steps <= max_steps && (steps % 4096 != 0 || !cancel.load(std::memory_order_relaxed));
+    };
+
+    // The log of the number of ways to reach each state, group by group.
+    std::vector<std::unordered_map<std::uint64_t, double>> forward(num_groups + 1);
+    forward[0].emplace(Encode(role_counts), 0);
+    for (std::size_t g = 0; g < num_groups; g++)
+    {
+        for (const auto &[key, log_count] : forward[g])
+        {
+            const RoleCounts state = Decode(key);
+            bool ok = true;
+            ForEachComposition(int(groups.players[g].size()), groups.masks[g] & NonZeroRoles(state), state, [&](const RoleCounts &x)
+            {
+                if (!ok || !(ok = Step()))
+                    return;
+
+                RoleCounts next = state;
+                for (std::size_t r = 0; r < num_roles; r++)
+                {
+                    next[r] -= x[r];
+                    if (next[r] > capacities[g + 1][r])
+                        return;
+                }
+
+                const double log_next = log_count + LogWays(g, x);
+                auto [it, is_new] = forward[g + 1].try_emplace(Encode(next), log_next);
+                if (!is_new)
+                    it->second = LogAddExp(it->second, log_next);
+            });
+            if (!ok)
+                return std::nullopt;
+        }
+    }
+
+    std::vector<std::array<double, num_roles>> ret;
+    if (forward[num_groups].empty())
+        return ret;
+
+    // The log of the number of ways to finish from each state.
+    std::vector<std::unordered_map<std::uint64_t, double>> backward(num_groups + 1);
+    backward[num_groups].emplace(0, 0);
+    for (std::size_t g = num_groups; g-- > 0;)
+    {
+        for (const auto &[key, log_count] : forward[g])
+        {
+            const RoleCounts state = Decode(key);
+            double log_total = negative_infinity;
+            bool ok = true;
+            ForEachComposition(int(groups.players[g].size()), groups.masks[g] & NonZeroRoles(state), state, [&](const RoleCounts &x)
+            {
+                if (!ok || !(ok = Step()))
+                    return;
+
+                auto it = backward[g + 1].find(key - Encode(x));
+                if (it != backward[g + 1].end())
+                    log_total = LogAddExp(log_total, LogWays(g, x) + it->second);
+            });
+            if (!ok)
+                return std::nullopt;
+            if (log_total != negative_infinity)
+                backward[g].emplace(key, log_total);
+        }
+    }
+
+    const double log_total = backward[0].at(Encode(role_counts));
+
+    // Now each split of a group is weighted by the number of assignments that go through it.
+    ret.resize(num_groups);
+    for (std::size_t g = 0; g < num_groups; g++)
+    {
+        for (const auto &[key, log_count] : forward[g])
+        {
+            if (!backward[g].contains(key))
+                continue;
+
+            const RoleCounts state = Decode(key);
+            bool ok = true;
+            ForEachComposition(int(groups.players[g].size()), groups.masks[g] & NonZeroRoles(state), state, [&](const RoleCounts &x)
+            {
+                if (!ok || !(ok = Step()))
+                    return;
+
+                auto it = backward[g + 1].find(key - Encode(x));
+                if (it == backward[g + 1].end())
+                    return;
+
+                const double probability = std::exp(log_count + LogWays(g, x) + it->second - log_total);
+                for (std::size_t r = 0; r < num_roles; r++)
+                    ret[g][r] += probability * x[r];
+            });
+            if (!ok)
+                return std::nullopt;
+        }
+    }
+
+    return ret;
+}
+
+// Finds some valid assignment, as a maximum flow from the groups to the roles. Returns an empty vector if there's none.
+[[nodiscard]] static std::vector<Role> FindAssignment(const PlayerGroups &groups, const RoleCounts &role_counts, std::size_t num_players)
+{
+    // The nodes are: the source, the groups, the roles, the sink.
+    const std::size_t num_groups = groups.masks.size();
+    const std::size_t num_nodes = num_groups + num_roles + 2;
+    const std::size_t source = 0;
+    const std::size_t sink = num_nodes - 1;
+    auto GroupNode = [&](std::size_t g){return 1 + g;};
+    auto RoleNode = [&](std::size_t r){return 1 + num_groups + r;};
+
+    std::vector<int> capacity(num_nodes * num_nodes);
+    auto Capacity = [&](std::size_t a, std::size_t b) -> int & {return capacity[a * num_nodes + b];};
+    for (std::size_t g = 0; g < num_groups; g++)
+    {
+        Capacity(source, GroupNode(g)) = int(groups.players[g].size());
+        for (std::size_t r = 0; r < num_roles; r++)
+        {
+            if (groups.masks[g] & (1u << r))
+                Capacity(GroupNode(g), RoleNode(r)) = int(groups.players[g].size());
+        }
+    }
+    for (std::size_t r = 0; r < num_roles; r++)
+        Capacity(RoleNode(r), sink) = role_counts[r];
+    const std::vector<int> original_capacity = capacity;
+
+    // Edmonds-Karp. The graph is tiny, there are at most 255 groups.
+    std::size_t flow = 0;
+    std::vector<std::size_t> parents(num_nodes);
+    std::deque<std::size_t> queue;
+    while (true)
+    {
+        std::fill(parents.begin(), parents.end(), std::size_t(-1));
+        parents[source] = source;
+        queue.assign(1, source);
+        while (!queue.empty() && parents[sink] == std::size_t(-1))
+        {
+            const std::size_t node = queue.front();
+            queue.pop_front();
+            for (std::size_t next = 0; next < num_nodes; next++)
+            {
+                if (parents[next] == std::size_t(-1) && Capacity(node, next) > 0)
+                {
+                    parents[next] = node;
+                    queue.push_back(next);
+                }
+            }
+        }
+        if (parents[sink] == std::size_t(-1))
+            break;
+
+        int amount = std::numeric_limits<int>::max();
+        for (std::size_t node = sink; node != source; node = parents[node])
+            amount = std::min(amount, Capacity(parents[node], node));
+        for (std::size_t node = sink; node != source; node = parents[node])
+        {
+            Capacity(parents[node], node) -= amount;
+            Capacity(node, parents[node]) += amount;
+        }
+        flow += std::size_t(amount);
+    }
+
+    std::vector<Role> ret;
+    if (flow != num_players)
+        return ret;
+
+    ret.resize(num_players);
+    for (std::size_t g = 0; g < num_groups; g++)
+    {
+        std::size_t member = 0;
+        for (std::size_t r = 0; r < num_roles; r++)
+        {
+            const std::size_t a = GroupNode(g), b = RoleNode(r);
+            for (int i = original_capacity[a * num_nodes + b] - Capacity(a, b); i > 0; i--)
+                ret[groups.players[g][member++]] = Role(r);
+        }
+    }
+    return ret;
+}
+
+// Samples the assignments with a Markov chain: swapping the roles of two players, or rotating the roles of three, when the new roles are allowed.
+// Both moves are their own kind of inverse with the same probability, so the chain converges to the uniform distribution over the valid assignments.
+// Adds the number of times each player had each role to `counts`. Returns false if cancelled.
+[[nodiscard]] static bool Sample(
+    const InferenceProblem &problem, std::vector<Role> roles, Rng &rng, std::uint64_t num_sweeps,
+    std::vector<std::array<std::uint64_t, num_roles>> &counts, const std::atomic<bool> &cancel
+)
+{
+    const std::uint32_t num_players = std::uint32_t(roles.size());
+    auto Allowed = [&](std::uint32_t player, Role role){return bool(problem.allowed_roles[player] & (1u << int(role)));};
+
+    for (std::uint64_t sweep = 0; sweep < num_burn_in_sweeps + num_sweeps; sweep++)
+    {
+        if (cancel.load(std::memory_order_relaxed))
+            return false;
+
+        for (std::uint32_t step = 0; step < num_players; step++)
+        {
+            const std::uint32_t a = rng.Below(num_players);
+            const std::uint32_t b = rng.Below(num_players);
+            if (rng.Next() & 1)
+            {
+                if (roles[a] != roles[b] && Allowed(a, roles[b]) && Allowed(b, roles[a]))
+                    std::swap(roles[a], roles[b]);
+            }
+            else
+            {
+                const std::uint32_t c = rng.Below(num_players);
+                if (a != b && b != c && a != c && Allowed(a, roles[b]) && Allowed(b, roles[c]) && Allowed(c, roles[a]))
+                {
+                    const Role role_a = roles[a];
+                    roles[a] = roles[b];
+                    roles[b] = roles[c];
+                    roles[c] = role_a;
+                }
+            }
+        }
+
+        if (sweep >= num_burn_in_sweeps)
+        {
+            for (std::size_t i = 0; i < roles.size(); i++)
+                counts[i][std::size_t(roles[i])]++;
+        }
+    }
+    return true;
+}
+
+InferenceResult SolveInferenceProblem(const InferenceProblem &problem, const std::atomic<bool> &cancel, std::uint64_t max_exact_steps, int num_threads)
+{
+    TRACE_ZONE("SolveInferenceProblem");
+
+    const std::size_t num_players = problem.player_ids.size();
+
+    InferenceResult ret;
+    ret.player_ids = problem.player_ids;
+    for (std::size_t i = 0; i < num_players; i++)
+        ret.indices_by_id.emplace(problem.player_ids[i], i);
+    ret.probabilities.resize(num_players);
+
+    const PlayerGroups groups = GroupPlayers(problem);
+
+    // The expected number of players of each role in each group. The members of a group are interchangeable, so they share it.
+    std::vector<std::array<double, num_roles>> expected;
+
+    if (auto exact = CountExactly(groups, problem.role_counts, max_exact_steps, cancel))
+    {
+        expected = std::move(*exact);
+    }
+    else
+    {
+        if (cancel.load(std::memory_order_relaxed))
+            return ret;
+
+        TRACE_ZONE("Sample");
+        ret.exact = false;
+
+        const std::vector<Role> initial_roles = FindAssignment(groups, problem.role_counts, num_players);
+        if (!initial_roles.empty())
+        {
+            if (num_threads <= 0)
+                num_threads = int(std::max(1u, std::thread::hardware_concurrency()));
+            const std::size_t thread_count = std::size_t(num_threads);
+
+            std::vector<std::vector<std::array<std::uint64_t, num_roles>>> thread_counts(thread_count, std::vector<std::array<std::uint64_t, num_roles>>(num_players));
+            std::vector<std::thread> threads;
+            for (std::size_t i = 0; i < thread_count; i++)
+            {
+                const std::uint64_t num_sweeps = num_sample_sweeps * (i + 1) / thread_count - num_sample_sweeps * i / thread_count;
+                threads.emplace_back([&, i, num_sweeps]
+                {
+                    Rng rng(1, i);
+                    (void)Sample(problem, initial_roles, rng, num_sweeps, thread_counts[i], cancel);
+                });
+            }
+            for (std::thread &thread : threads)
+                thread.join();
+
+            ret.num_samples = num_sample_sweeps;
+            expected.resize(groups.masks.size());
+            for (std::size_t g = 0; g < groups.masks.size(); g++)
+            {
+                for (std::size_t player : groups.players[g])
+                {
+                    for (const auto &counts : thread_counts)
+                    {
+                        for (std::size_t r = 0; r < num_roles; r++)
+                            expected[g][r] += double(counts[player][r]) / double(num_sample_sweeps);
+                    }
+                }
+            }
+        }
+    }
+
+    if (expected.empty() && num_players > 0)
+    {
+        ret.consistent = false;
+        return ret;
+    }
+
+    for (std::size_t g = 0; g < groups.masks.size(); g++)
+    {
+        for (std::size_t player : groups.players[g])
+        {
+            for (std::size_t r = 0; r < num_roles; r++)
+                ret.probabilities[player][r] = float(expected[g][r] / double(groups.players[g].size()));
+        }
+    }
+    return ret;
+}
+
+RoleInference::RoleInference()
+{
+    thread = std::thread([this]{ThreadFunc();});
+}
+
+RoleInference::~RoleInference()
+{
+    {
+        std::lock_guard lock(mutex);
+        stop = true;
+        cancel = true;
+    }
+    cond.notify_one();
+    thread.join();
+}
+
+void RoleInference::Request(std::vector<Day> days, const Settings &settings)
+{
+    {
+        std::lock_guard lock(mutex);
+        pending_days = std::move(days);
+        pending_settings = settings;
+        busy = true;
+        // This is under the lock, so that the thread can't reset it after taking this request.
+        cancel = true;
+    }
+    cond.notify_one();
+}
+
+std::shared_ptr<const InferenceResult> RoleInference::Result()
+{
+    std::lock_guard lock(mutex);
+    return result;
+}
+
+bool RoleInference::IsBusy()
+{
+    std::lock_guard lock(mutex);
+    return busy;
+}
+
+InferenceProblem RoleInference::MakeProblem(const std::vector<Day> &days, const Settings &settings)
+{
+    InferenceProblem ret;
+
+    const PlayerTable &players = days.back().players;
+    ret.role_counts = players.role_counts;
+
+    std::unordered_map<int, std::size_t> indices_by_id;
+    for (std::size_t i = 0; i < players.Size(); i++)
+    {
+        indices_by_id.emplace(players.ids[i], i);
+        ret.player_ids.push_back(players.ids[i]);
+        ret.allowed_roles.push_back(players.role_mask);
+    }
+
+    // There are no checks during the roll call.
+    resolvers.resize(days.size());
+    for (std::size_t d = 1; d < days.size(); d++)
+    {
+        const NightOutcome &outcome = resolvers[d].Update(days[d], settings);
+        const PlayerTable &day_players = days[d].players;
+
+        auto Constrain = [&](const PlayerSet &checked, const PlayerSet &found, unsigned roles)
+        {
+            checked.ForEach([&](std::size_t i)
+            {
+                auto it = indices_by_id.find(day_players.ids[i]);
+                if (it != indices_by_id.end())
+                    ret.allowed_roles[it->second] &= found.Contains(i) ? roles : ~roles;
+            });
+        };
+
+        // The sheriff finds the mafia, or the killer if there's no mafia left. The public knows which, since the roles of the dead are revealed.
+        const unsigned mafia_roles = (1u << int(Role::mafia)) | (1u << int(Role::mafia_boss));
+        Constrain(outcome.sheriff_checked, outcome.sheriff_found, day_players.faction_counts[std::size_t(Faction::mafia)] > 0 ? mafia_roles : 1u << int(Role::killer));
+        Constrain(outcome.boss_checked, outcome.boss_found, 1u << int(Role::sheriff));
+    }
+
+    return ret;
+}
+
+void RoleInference::ThreadFunc()
+{
+    TRACE_THREAD_NAME("Role inference");
+
+    std::unique_lock lock(mutex);
+
+    while (true)
+    {
+        cond.wait(lock, [&]{return stop || pending_days;});
+        if (stop)
+            return;
+
+        const std::vector<Day> days = std::move(*pending_days);
+        pending_days.reset();
+        const Settings settings = pending_settings;
+        cancel = false;
+
+        lock.unlock();
+
+        std::shared_ptr<const InferenceResult> new_result;
+        try
+        {
+            TRACE_ZONE("Role inference");
+
+            InferenceProblem problem = MakeProblem(days, settings);
+            if (problem != last_problem)
+            {
+                InferenceResult solved = SolveInferenceProblem(problem, cancel);
+                if (!cancel.load(std::memory_order_relaxed))
+                {
+                    new_result = std::make_shared<const InferenceResult>(std::move(solved));
+                    last_problem = std::move(problem);
+                }
+            }
+        }
+        catch (std::exception &e)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Unable to compute the role probabilities: %s", e.what());
+        }
+
+        lock.lock();
+        if (new_result)
+            result = std::move(new_result);
+        busy = pending_days.has_value();
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "night.h"
+#include "state.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Guesses the roles of the living players from the public information, for the commentators.
+//
+// The public knows how many players of each role are still alive (the roles of the dead are revealed), and the results of the sheriff's
+//   and the boss's checks (who was checked and what was found, but not who checked). Each check limits the roles of its target,
+//   so every player gets a set of allowed roles, and every assignment of the remaining roles that fits those sets is considered equally likely.
+// Whether a check was blocked isn't public, only the results that came through are used.
+
+// The constraints that the public information puts on the living players.
+struct InferenceProblem
+{
+    std::vector<int> player_ids;
+    // Bit N is `Role(N)`.
+    std::vector<unsigned> allowed_roles;
+    // The number of living players with each role.
+    std::array<int, int(Role::_count)> role_counts{};
+
+    [[nodiscard]] bool operator==(const InferenceProblem &) const = default;
+};
+
+struct InferenceResult
+{
+    std::vector<int> player_ids;
+    std::unordered_map<int, std::size_t> indices_by_id;
+    // Per player, the probability of each role.
+    std::vector<std::array<float, int(Role::_count)>> probabilities;
+
+    // False if no assignment of the roles fits the public information (e.g. if the moderator changed someone's role mid-game).
+    bool consistent = true;
+    // If the table is too large to count the assignments exactly, they're sampled instead.
+    bool exact = true;
+    std::uint64_t num_samples = 0;
+
+    // Returns null if the player isn't in the result.
+    [[nodiscard]] const std::array<float, int(Role::_count)> *Find(int player_id) const
+    {
+        auto it = indices_by_id.find(player_id);
+        return it != indices_by_id.end() ? &probabilities[it->second] : nullptr;
+    }
+};
+
+// Only returns when it's done, or when `cancel` becomes true (then the result is meaningless).
+// Counts exactly if that takes at most `max_exact_steps` steps, otherwise samples on `num_threads` threads (all cores if 0).
+[[nodiscard]] InferenceResult SolveInferenceProblem(const InferenceProblem &problem, const std::atomic<bool> &cancel, std::uint64_t max_exact_steps = 4'000'000, int num_threads = 0);
+
+// Computes the probabilities on a background thread, so that the frames don't wait for it.
+// Only the latest request matters: a new request abandons the computation of the previous one.
+// Reuses the work from the previous request: the days that didn't change aren't resolved again, and if the constraints came out the same,
+//   the previous result is kept as is. Most actions (kills, votes, blocks of other roles) don't change the constraints.
+class RoleInference
+{
+    std::mutex mutex;
+    std::condition_variable cond;
+
+    // Those are protected by the mutex: [
+    std::optional<std::vector<Day>> pending_days;
+    Settings pending_settings;
+    std::shared_ptr<const InferenceResult> result;
+    bool busy = false;
+    bool stop = false;
+    // ]
+
+    // Set when a new request arrives, to abandon the current computation.
+    std::atomic<bool> cancel = false;
+
+    // Only used by the thread.
+    std::vector<NightResolver> resolvers;
+    std::optional<InferenceProblem> last_problem;
+
+    std::thread thread;
+
+    void ThreadFunc();
+    [[nodiscard]] InferenceProblem MakeProblem(const std::vector<Day> &days, const Settings &settings);
+
+  public:
+    RoleInference();
+    RoleInference(const RoleInference &) = delete;
+    RoleInference &operator=(const RoleInference &) = delete;
+    ~RoleInference();
+
+    // Copying the days is cheap, they share their data with the originals.
+    void Request(std::vector<Day> days, const Settings &settings);
+
+    // The latest finished result, or null if there's none yet.
+    [[nodiscard]] std::shared_ptr<const InferenceResult> Result();
+
+    // Whether a request is being computed.
+    [[nodiscard]] bool IsBusy();
+};
@@ -0,0 +1,258 @@
+#include "input_recording.h"
+
+#include <SDL3/SDL_iostream.h>
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_timer.h>
+
+#include <memory>
+#include <stdexcept>
+
+static constexpr std::uint32_t recording_magic = 0x4946414d; // `MAFI`
+static constexpr std::uint32_t format_version = 1;
+
+// Write the buffer to the file when it gets this large.
+static constexpr std::size_t write_threshold = 1 << 16;
+
+enum class RecordKind : unsigned char
+{
+    event,
+    skipped_iteration,
+    frame,
+};
+
+void InputRecorder::WriteTime(std::uint64_t time_ns)
+{
+    const std::int64_t relative_time_ns = std::int64_t(time_ns - start_time_ns);
+    writer.WriteSignedVarint(relative_time_ns - last_time_ns);
+    last_time_ns = relative_time_ns;
+}
+
+void InputRecorder::WriteToFile()
+{
+    if (writer.Data().empty())
+        return;
+    if (SDL_WriteIO(file, writer.Data().data(), writer.Data().size()) != writer.Data().size())
+        throw std::runtime_error(std::string("Unable to write the input recording: ") + SDL_GetError());
+    writer.Clear();
+}
+
+InputRecorder::InputRecorder(const std::string &path, float display_scale, ImGuiConfigFlags config_flags)
+    : start_time_ns(SDL_GetTicksNS())
+{
+    file = SDL_IOFromFile(path.c_str(), "wb");
+    if (!file)
+        throw std::runtime_error("Unable to create the input recording `" + path + "`: " + SDL_GetError());
+
+    writer.Write<std::uint32_t>(recording_magic);
+    writer.Write<std::uint32_t>(format_version);
+    writer.Write<float>(display_scale);
+    writer.WriteVarint(std::uint64_t(config_flags));
+}
+
+InputRecorder::~InputRecorder()
+{
+    try
+    {
+        WriteToFile();
+    }
+    catch (std::exception &e)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s", e.what());
+    }
+
+    SDL_CloseIO(file);
+}
+
+void InputRecorder::AddEvent(const SDL_Event &event)
+{
+    switch (event.type)
+    {
+        case SDL_EVENT_MOUSE_MOTION:
+        case SDL_EVENT_MOUSE_BUTTON_DOWN:
+        case SDL_EVENT_MOUSE_BUTTON_UP:
+        case SDL_EVENT_MOUSE_WHEEL:
+        case SDL_EVENT_KEY_DOWN:
+        case SDL_EVENT_KEY_UP:
+        case SDL_EVENT_TEXT_INPUT:
+        case SDL_EVENT_WINDOW_MOUSE_ENTER:
+        case SDL_EVENT_WINDOW_MOUSE_LEAVE:
+        case SDL_EVENT_WINDOW_FOCUS_GAINED:
+        case SDL_EVENT_WINDOW_FOCUS_LOST:
+            break;
+        default:
+            return;
+    }
+
+    writer.Write(RecordKind::event);
+    WriteTime(event.common.timestamp);
+    writer.WriteVarint(event.type);
+
+    switch (event.type)
+    {
+        case SDL_EVENT_MOUSE_MOTION:
+            writer.WriteVarint(event.motion.which);
+            writer.WriteVarint(event.motion.state);
+            writer.Write(event.motion.x);
+            writer.Write(event.motion.y);
+            writer.Write(event.motion.xrel);
+            writer.Write(event.motion.yrel);
+            break;
+        case SDL_EVENT_MOUSE_BUTTON_DOWN:
+        case SDL_EVENT_MOUSE_BUTTON_UP:
+            writer.WriteVarint(event.button.which);
+            writer.WriteVarint(event.button.button);
+            writer.WriteVarint(event.button.clicks);
+            writer.Write(event.button.x);
+            writer.Write(event.button.y);
+            break;
+        case SDL_EVENT_MOUSE_WHEEL:
+            writer.WriteVarint(event.wheel.which);
+            writer.Write(event.wheel.x);
+            writer.Write(event.wheel.y);
+            writer.WriteVarint(std::uint64_t(event.wheel.direction));
+            writer.Write(event.wheel.mouse_x);
+            writer.Write(event.wheel.mouse_y);
+            writer.WriteSignedVarint(event.wheel.integer_x);
+            writer.WriteSignedVarint(event.wheel.integer_y);
+            break;
+        case SDL_EVENT_KEY_DOWN:
+        case SDL_EVENT_KEY_UP:
+            writer.WriteVarint(event.key.which);
+            writer.WriteVarint(std::uint64_t(event.key.scancode));
+            writer.WriteVarint(event.key.key);
+            writer.WriteVarint(event.key.mod);
+            writer.WriteVarint(event.key.raw);
+            writer.WriteVarint(event.key.repeat);
+            break;
+        case SDL_EVENT_TEXT_INPUT:
+            writer.WriteString(event.text.text);
+            break;
+        default:
+            // The window events have no data we need.
+            break;
+    }
+}
+
+void InputRecorder::AddIteration(const std::optional<RecordedFrame> &frame)
+{
+    writer.Write(frame ? RecordKind::frame : RecordKind::skipped_iteration);
+    WriteTime(SDL_GetTicksNS());
+    if (frame)
+    {
+        writer.Write(frame->display_size);
+        writer.Write(frame->framebuffer_scale);
+        writer.Write(frame->delta_time);
+    }
+
+    if (writer.Data().size() >= write_threshold)
+        WriteToFile();
+}
+
+InputRecording LoadInputRecording(const std::string &path, SDL_WindowID window_id)
+{
+    std::size_t size = 0;
+    void *data = SDL_LoadFile(path.c_str(), &size);
+    if (!data)
+        throw std::runtime_error("Unable to load the input recording `" + path + "`: " + SDL_GetError());
+    std::unique_ptr<void, decltype(&SDL_free)> data_guard(data, SDL_free);
+
+    BinaryReader reader({(const unsigned char *)data, size});
+    if (reader.Read<std::uint32_t>() != recording_magic || reader.Read<std::uint32_t>() != format_version)
+        throw std::runtime_error("Unknown input recording format.");
+
+    InputRecording ret;
+    ret.display_scale = reader.Read<float>();
+    ret.config_flags = ImGuiConfigFlags(reader.ReadVarint());
+
+    std::int64_t time_ns = 0;
+    RecordedIteration iteration;
+
+    while (!reader.AtEnd())
+    {
+        const RecordKind kind = reader.Read<RecordKind>();
+        time_ns += reader.ReadSignedVarint();
+
+        if (kind == RecordKind::skipped_iteration || kind == RecordKind::frame)
+        {
+            iteration.time_ns = std::uint64_t(time_ns);
+            if (kind == RecordKind::frame)
+            {
+                iteration.frame.emplace();
+                iteration.frame->display_size = reader.Read<ImVec2>();
+                iteration.frame->framebuffer_scale = reader.Read<ImVec2>();
+                iteration.frame->delta_time = reader.Read<float>();
+            }
+            ret.iterations.push_back(std::move(iteration));
+            iteration = {};
+            continue;
+        }
+
+        if (kind != RecordKind::event)
+            throw std::runtime_error("Invalid record in the input recording.");
+
+        SDL_Event &event = iteration.events.emplace_back();
+        event.type = Uint32(reader.ReadVarint());
+        event.common.timestamp = std::uint64_t(time_ns);
+
+        switch (event.type)
+        {
+            case SDL_EVENT_MOUSE_MOTION:
+                event.motion.windowID = window_id;
+                event.motion.which = SDL_MouseID(reader.ReadVarint());
+                event.motion.state = SDL_MouseButtonFlags(reader.ReadVarint());
+                event.motion.x = reader.Read<float>();
+                event.motion.y = reader.Read<float>();
+                event.motion.xrel = reader.Read<float>();
+                event.motion.yrel = reader.Read<float>();
+                break;
+            case SDL_EVENT_MOUSE_BUTTON_DOWN:
+            case SDL_EVENT_MOUSE_BUTTON_UP:
+                event.button.windowID = window_id;
+                event.button.which = SDL_MouseID(reader.ReadVarint());
+                event.button.button = Uint8(reader.ReadVarint());
+                event.button.down = event.type == SDL_EVENT_MOUSE_BUTTON_DOWN;
+                event.button.clicks = Uint8(reader.ReadVarint());
+                event.button.x = reader.Read<float>();
+                event.button.y = reader.Read<float>();
+                break;
+            case SDL_EVENT_MOUSE_WHEEL:
+                event.wheel.windowID = window_id;
+                event.wheel.which = SDL_MouseID(reader.ReadVarint());
+                event.wheel.x = reader.Read<float>();
+                event.wheel.y = reader.Read<float>();
+                event.wheel.direction = SDL_MouseWheelDirection(reader.ReadVarint());
+                event.wheel.mouse_x = reader.Read<float>();
+                event.wheel.mouse_y = reader.Read<float>();
+                event.wheel.integer_x = Sint32(reader.ReadSignedVarint());
+                event.wheel.integer_y = Sint32(reader.ReadSignedVarint());
+                break;
+            case SDL_EVENT_KEY_DOWN:
+            case SDL_EVENT_KEY_UP:
+                event.key.windowID = window_id;
+                event.key.which = SDL_KeyboardID(reader.ReadVarint());
+                event.key.scancode = SDL_Scancode(reader.ReadVarint());
+                event.key.key = SDL_Keycode(reader.ReadVarint());
+                event.key.mod = SDL_Keymod(reader.ReadVarint());
+                event.key.raw = Uint16(reader.ReadVarint());
+                event.key.down = event.type == SDL_EVENT_KEY_DOWN;
+                event.key.repeat = reader.ReadIndex(2) != 0; // Not `Read<bool>()`, since a byte other than 0 or 1 isn't a valid `bool`.
+                break;
+            case SDL_EVENT_TEXT_INPUT:
+                event.text.windowID = window_id;
+                event.text.text = ret.text_storage.emplace_back(reader.ReadString()).c_str();
+                break;
+            case SDL_EVENT_WINDOW_MOUSE_ENTER:
+            case SDL_EVENT_WINDOW_MOUSE_LEAVE:
+            case SDL_EVENT_WINDOW_FOCUS_GAINED:
+            case SDL_EVENT_WINDOW_FOCUS_LOST:
+                event.window.windowID = window_id;
+                break;
+            default:
+                throw std::runtime_error("Unexpected event type in the input recording.");
+        }
+    }
+
+    // The events after the last iteration were never processed by the app, so we drop them.
+
+    return ret;
+}
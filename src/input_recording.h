@@ -0,0 +1,80 @@
+#pragma once
+
+#include "binary_io.h"
+
+#include <imgui.h>
+#include <SDL3/SDL_events.h>
+#include <SDL3/SDL_video.h>
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <vector>
+
+struct SDL_IOStream;
+
+// Records the raw SDL input events, to replay them later without a window. See `tools/input_replay`.
+// Only the events that `ImGui_ImplSDL3_ProcessEvent()` acts on are recorded.
+
+// What ImGui normally gets from the window and the clock, for one frame.
+struct RecordedFrame
+{
+    ImVec2 display_size;
+    ImVec2 framebuffer_scale;
+    float delta_time = 0;
+};
+
+// One `SDL_AppIterate()` call.
+struct RecordedIteration
+{
+    // Nanoseconds since the start of the recording.
+    std::uint64_t time_ns = 0;
+    // The events received since the previous iteration.
+    // The timestamps are also relative to the start of the recording. The text of text events points into `InputRecording::text_storage`.
+    std::vector<SDL_Event> events;
+    // Unset if this iteration didn't draw a frame. `TouchController::HandleEvents()` runs either way.
+    std::optional<RecordedFrame> frame;
+};
+
+struct InputRecording
+{
+    // The value passed to `ImGuiStyle::ScaleAllSizes()`.
+    float display_scale = 1;
+    ImGuiConfigFlags config_flags = 0;
+
+    std::vector<RecordedIteration> iterations;
+
+    // A deque, so that the pointers to the strings stay valid.
+    std::deque<std::string> text_storage;
+};
+
+class InputRecorder
+{
+    SDL_IOStream *file = nullptr;
+    BinaryWriter writer;
+    std::uint64_t start_time_ns = 0;
+    // The time of the last written record, relative to `start_time_ns`. The records store the differences from it.
+    std::int64_t last_time_ns = 0;
+
+    void WriteTime(std::uint64_t time_ns);
+    void WriteToFile();
+
+  public:
+    // Creates the file. Throws on failure.
+    InputRecorder(const std::string &path, float display_scale, ImGuiConfigFlags config_flags);
+    InputRecorder(const InputRecorder &) = delete;
+    InputRecorder &operator=(const InputRecorder &) = delete;
+    // Writes everything that's still buffered.
+    ~InputRecorder();
+
+    // Call this for every event, before passing it to ImGui. The events irrelevant to ImGui are ignored.
+    void AddEvent(const SDL_Event &event);
+
+    // Call this once per `SDL_AppIterate()`: with the frame parameters after `ImGui_ImplSDL3_NewFrame()` if the frame is drawn, or with nothing if it's skipped.
+    void AddIteration(const std::optional<RecordedFrame> &frame);
+};
+
+// Reads a recording made by `InputRecorder`. Throws on failure.
+// The events are assigned to the window `window_id`, so that `ImGui_ImplSDL3_ProcessEvent()` accepts them.
+[[nodiscard]] InputRecording LoadInputRecording(const std::string &path, SDL_WindowID window_id);
@@ -0,0 +1,247 @@
+#include "journal.h"
+
+#include "binary_io.h"
+#include "trace.h"
+
+#include <SDL3/SDL.h>
+
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+static constexpr std::uint32_t snapshot_magic = 0x5346414d; // `MAFS`
+static constexpr std::uint32_t journal_magic = 0x4a46414d; // `MAFJ`
+static constexpr std::uint32_t format_version = 1;
+
+// Loads a file, or returns an empty vector if it doesn't exist.
+[[nodiscard]] static std::vector<unsigned char> LoadFileIfExists(const std::string &path)
+{
+    std::size_t size = 0;
+    void *data = SDL_LoadFile(path.c_str(), &size);
+    if (!data)
+        return {};
+
+    std::vector<unsigned char> ret((unsigned char *)data, (unsigned char *)data + size);
+    SDL_free(data);
+    return ret;
+}
+
+static void WriteOrThrow(SDL_IOStream *file, std::span<const unsigned char> bytes)
+{
+    if (SDL_WriteIO(file, bytes.data(), bytes.size()) != bytes.size())
+        throw std::runtime_error(std::string("Unable to write to the journal: ") + SDL_GetError());
+}
+
+// `SDL_FlushIO()` also syncs the file to disk, not only its userspace buffer.
+static void FlushOrThrow(SDL_IOStream *file)
+{
+    if (!SDL_FlushIO(file))
+        throw std::runtime_error(std::string("Unable to flush the journal: ") + SDL_GetError());
+}
+
+Journal::Journal(std::string path_prefix)
+    : snapshot_path(path_prefix + ".snapshot"), journal_path(path_prefix + ".journal")
+{
+    thread = std::thread([this]{ThreadFunc();});
+}
+
+Journal::~Journal()
+{
+    {
+        std::lock_guard lock(mutex);
+        stop = true;
+    }
+    cond.notify_one();
+    thread.join();
+
+    if (journal_file)
+        SDL_CloseIO(journal_file);
+}
+
+std::optional<Journal::Contents> Journal::Load()
+{
+    Contents ret;
+
+    std::uint64_t snapshot_generation = 0;
+
+    try
+    {
+        std::vector<unsigned char> snapshot_file = LoadFileIfExists(snapshot_path);
+        if (snapshot_file.empty())
+            return {};
+
+        BinaryReader reader(snapshot_file);
+        if (reader.Read<std::uint32_t>() != snapshot_magic || reader.Read<std::uint32_t>() != format_version)
+            throw std::runtime_error("Unknown snapshot format.");
+        snapshot_generation = reader.Read<std::uint64_t>();
+        const std::uint32_t checksum = reader.Read<std::uint32_t>();
+        std::span<const unsigned char> payload = reader.ReadBytes(snapshot_file.size() - reader.Position());
+        if (Checksum(payload) != checksum)
+            throw std::runtime_error("Snapshot checksum mismatch.");
+        ret.snapshot.assign(payload.begin(), payload.end());
+    }
+    catch (std::exception &e)
+    {
+        SDL_Log("Unable to load the session snapshot: %s", e.what());
+        return {};
+    }
+
+    {
+        std::lock_guard lock(mutex);
+        generation = snapshot_generation;
+    }
+
+    std::vector<unsigned char> journal_file_data = LoadFileIfExists(journal_path);
+    BinaryReader reader(journal_file_data);
+    try
+    {
+        if (reader.Read<std::uint32_t>() != journal_magic || reader.Read<std::uint32_t>() != format_version)
+            throw std::runtime_error("Unknown journal format.");
+        if (reader.Read<std::uint64_t>() != snapshot_generation)
+            return ret; // This journal belongs to a different snapshot, most probably an older one. The new snapshot already includes it.
+
+        while (!reader.AtEnd())
+        {
+            const std::uint32_t size = reader.Read<std::uint32_t>();
+            const std::uint32_t checksum = reader.Read<std::uint32_t>();
+            std::span<const unsigned char> record = reader.ReadBytes(size);
+            if (Checksum(record) != checksum)
+                throw std::runtime_error("Record checksum mismatch.");
+            ret.records.emplace_back(record.begin(), record.end());
+        }
+    }
+    catch (std::exception &e)
+    {
+        // Expected after a crash mid-write. Keep the records read so far.
+        if (!journal_file_data.empty())
+            SDL_Log("Stopped reading the session journal after %d records: %s", int(ret.records.size()), e.what());
+    }
+
+    return ret;
+}
+
+void Journal::Append(std::span<const unsigned char> record)
+{
+    {
+        std::lock_guard lock(mutex);
+        BinaryWriter writer;
+        writer.Data() = std::move(pending_records);
+        writer.Write<std::uint32_t>(std::uint32_t(record.size()));
+        writer.Write<std::uint32_t>(Checksum(record));
+        writer.WriteBytes(record);
+        pending_records = std::move(writer.Data());
+    }
+    cond.notify_one();
+}
+
+void Journal::WriteSnapshot(std::vector<unsigned char> snapshot)
+{
+    {
+        std::lock_guard lock(mutex);
+        generation++;
+        pending_snapshot = std::move(snapshot);
+        // Those are included in the snapshot.
+        pending_records.clear();
+    }
+    cond.notify_one();
+}
+
+void Journal::Flush()
+{
+    std::unique_lock lock(mutex);
+    const int target = ++flush_requests;
+    cond.notify_one();
+    flushed_cond.wait(lock, [&]{return flushes_done >= target;});
+}
+
+void Journal::WriteSnapshotFile(std::uint64_t snapshot_generation, std::span<const unsigned char> snapshot)
+{
+    // Write to a temporary file first, then rename it over the old one, so there's always a valid snapshot on disk.
+    const std::string temp_path = snapshot_path + ".tmp";
+
+    SDL_IOStream *file = SDL_IOFromFile(temp_path.c_str(), "wb");
+    if (!file)
+        throw std::runtime_error(std::string("Unable to create the session snapshot: ") + SDL_GetError());
+    std::unique_ptr<SDL_IOStream, decltype(&SDL_CloseIO)> file_guard(file, SDL_CloseIO);
+
+    BinaryWriter header;
+    header.Write<std::uint32_t>(snapshot_magic);
+    header.Write<std::uint32_t>(format_version);
+    header.Write<std::uint64_t>(snapshot_generation);
+    header.Write<std::uint32_t>(Checksum(snapshot));
+    WriteOrThrow(file, header.Data());
+    WriteOrThrow(file, snapshot);
+    FlushOrThrow(file);
+    file_guard.reset();
+
+    if (!SDL_RenamePath(temp_path.c_str(), snapshot_path.c_str()))
+        throw std::runtime_error(std::string("Unable to replace the session snapshot: ") + SDL_GetError());
+
+    // Start a new journal for this snapshot.
+    if (journal_file)
+        SDL_CloseIO(std::exchange(journal_file, nullptr));
+    journal_file = SDL_IOFromFile(journal_path.c_str(), "wb");
+    if (!journal_file)
+        throw std::runtime_error(std::string("Unable to create the session journal: ") + SDL_GetError());
+
+    header.Clear();
+    header.Write<std::uint32_t>(journal_magic);
+    header.Write<std::uint32_t>(format_version);
+    header.Write<std::uint64_t>(snapshot_generation);
+    WriteOrThrow(journal_file, header.Data());
+}
+
+void Journal::ThreadFunc()
+{
+    TRACE_THREAD_NAME("Journal");
+
+    std::unique_lock lock(mutex);
+
+    std::vector<unsigned char> records;
+
+    while (true)
+    {
+        cond.wait(lock, [&]{return stop || flush_requests > flushes_done || pending_snapshot || !pending_records.empty();});
+
+        // Wait a bit more to collect more records, so we sync them in one go.
+        if (!stop && flush_requests == flushes_done)
+            cond.wait_for(lock, batch_interval, [&]{return stop || flush_requests > flushes_done;});
+
+        std::optional<std::vector<unsigned char>> snapshot = std::exchange(pending_snapshot, {});
+        const std::uint64_t snapshot_generation = generation;
+        records.clear();
+        records.swap(pending_records);
+        const int flush_target = flush_requests;
+        const bool stopping = stop;
+
+        lock.unlock();
+
+        try
+        {
+            TRACE_ZONE("Journal write");
+
+            if (snapshot)
+                WriteSnapshotFile(snapshot_generation, *snapshot);
+
+            // If we have no journal file, we haven't written the first snapshot yet, and there's nothing to append records to.
+            if (journal_file && !records.empty())
+            {
+                WriteOrThrow(journal_file, records);
+                FlushOrThrow(journal_file);
+            }
+        }
+        catch (std::exception &e)
+        {
+            // There's nobody to report this to. The session just won't be restorable.
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s", e.what());
+        }
+
+        lock.lock();
+
+        flushes_done = flush_target;
+        flushed_cond.notify_all();
+
+        if (stopping && !pending_snapshot && pending_records.empty())
+            break;
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct SDL_IOStream;
+
+// An append-only log of records plus a periodic snapshot, used to restore the session after the app gets killed.
+// The files are `<prefix>.snapshot` and `<prefix>.journal`.
+// Restoring means loading the snapshot and replaying the records written after it.
+// All writes happen on a background thread, which syncs the files to disk in batches, so the caller never blocks on disk.
+class Journal
+{
+  public:
+    struct Contents
+    {
+        std::vector<unsigned char> snapshot;
+        // The records written after the snapshot. A torn record at the end (from a crash mid-write) is dropped.
+        std::vector<std::vector<unsigned char>> records;
+    };
+
+  private:
+    std::string snapshot_path;
+    std::string journal_path;
+
+    // How long to collect records before syncing them to disk.
+    std::chrono::milliseconds batch_interval{250};
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::condition_variable flushed_cond;
+
+    // Those are protected by the mutex: [
+    // Incremented with every snapshot. The journal file remembers the generation of its snapshot, so we don't replay the journal on top of a wrong snapshot.
+    std::uint64_t generation = 0;
+    std::optional<std::vector<unsigned char>> pending_snapshot;
+    // Encoded records that weren't written yet.
+    std::vector<unsigned char> pending_records;
+    int flush_requests = 0;
+    int flushes_done = 0;
+    bool stop = false;
+    // ]
+
+    // Only used by the thread.
+    SDL_IOStream *journal_file = nullptr;
+
+    std::thread thread;
+
+    void ThreadFunc();
+    void WriteSnapshotFile(std::uint64_t snapshot_generation, std::span<const unsigned char> snapshot);
+
+  public:
+    Journal(std::string path_prefix);
+    Journal(const Journal &) = delete;
+    Journal &operator=(const Journal &) = delete;
+    // Writes everything that's still pending.
+    ~Journal();
+
+    // Reads the existing files, if any. Call this before writing anything.
+    [[nodiscard]] std::optional<Contents> Load();
+
+    // Queues a record to be written.
+    void Append(std::span<const unsigned char> record);
+
+    // Queues a new snapshot. It replaces the existing snapshot and all the records, so it must include the effects of all of them.
+    void WriteSnapshot(std::vector<unsigned char> snapshot);
+
+    // Blocks until everything queued so far is synced to disk.
+    void Flush();
+};
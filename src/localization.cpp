@@ -0,0 +1,254 @@
+#include "localization.h"
+
+#include "binary_io.h"
+
+#include <SDL3/SDL_locale.h>
+#include <SDL3/SDL_stdinc.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+static constexpr std::uint32_t pack_magic = 0x4c46414d; // `MAFL`
+static constexpr std::uint32_t pack_version = 1;
+
+static constexpr std::string_view string_id_names[] = {
+    #define X(id_, ...) #id_,
+    UI_STRINGS(X)
+    #undef X
+};
+
+static constexpr std::string_view builtin_literals[int(BuiltinLanguage::_count)][int(StringId::_count)] = {
+    {
+        #define X(id_, ru_, en_, uk_) ru_,
+        UI_STRINGS(X)
+        #undef X
+    },
+    {
+        #define X(id_, ru_, en_, uk_) en_,
+        UI_STRINGS(X)
+        #undef X
+    },
+    {
+        #define X(id_, ru_, en_, uk_) uk_,
+        UI_STRINGS(X)
+        #undef X
+    },
+};
+
+// The strings of a built-in language, packed back to back (null-terminated) at compile time.
+template <BuiltinLanguage L>
+struct BuiltinStringData
+{
+    static constexpr std::size_t size = []{
+        std::size_t ret = 0;
+        for (std::string_view str : builtin_literals[int(L)])
+            ret += str.size() + 1;
+        return ret;
+    }();
+
+    static constexpr std::array<char, size> chars = []{
+        std::array<char, size> ret{};
+        std::size_t pos = 0;
+        for (std::string_view str : builtin_literals[int(L)])
+        {
+            for (char ch : str)
+                ret[pos++] = ch;
+            ret[pos++] = '\0';
+        }
+        return ret;
+    }();
+
+    static constexpr std::array<const char *, int(StringId::_count)> strings = []{
+        std::array<const char *, int(StringId::_count)> ret{};
+        std::size_t pos = 0;
+        for (std::size_t i = 0; i < ret.size(); i++)
+        {
+            ret[i] = chars.data() + pos;
+            pos += builtin_literals[int(L)][i].size() + 1;
+        }
+        return ret;
+    }();
+};
+
+// The parts of a format specifier that determine which arguments it reads.
+struct FormatSpecifier
+{
+    // The number of `*` in the width and the precision. Each reads an extra `int` argument.
+    int num_stars = 0;
+    // The length modifier and the conversion. Empty if there are no specifiers left.
+    std::string_view type;
+
+    [[nodiscard]] constexpr bool operator==(const FormatSpecifier &) const = default;
+};
+
+// Returns the next format specifier, and removes everything up to it from `str`.
+static constexpr FormatSpecifier NextFormatSpecifier(std::string_view &str)
+{
+    while (true)
+    {
+        const std::size_t pos = str.find('%');
+        if (pos == std::string_view::npos)
+        {
+            str = {};
+            return {};
+        }
+
+        FormatSpecifier ret;
+        const std::size_t type_begin = std::min(str.find_first_not_of("-+ #0123456789.*", pos + 1), str.size());
+        for (std::size_t i = pos + 1; i < type_begin; i++)
+            ret.num_stars += str[i] == '*';
+        std::size_t end = std::min(str.find_first_not_of("hljztL", type_begin), str.size());
+        if (end < str.size())
+            end++;
+
+        ret.type = str.substr(type_begin, end - type_begin);
+        str.remove_prefix(end);
+        if (ret.type != "%")
+            return ret;
+    }
+}
+
+// Compares the format specifiers, ignoring everything except the arguments they read.
+[[nodiscard]] static constexpr bool FormatSpecifiersMatch(std::string_view a, std::string_view b)
+{
+    while (true)
+    {
+        const FormatSpecifier spec_a = NextFormatSpecifier(a);
+        if (spec_a != NextFormatSpecifier(b))
+            return false;
+        if (spec_a.type.empty())
+            return true;
+    }
+}
+
+static_assert(FormatSpecifiersMatch("%d: %-5s%%", "%+d %s %%"));
+static_assert(FormatSpecifiersMatch("%*d", "%-*d"));
+static_assert(!FormatSpecifiersMatch("%d", "%*d"), "`*` reads an extra argument.");
+static_assert(!FormatSpecifiersMatch("%s", "%.*s"), "`*` reads an extra argument.");
+static_assert(!FormatSpecifiersMatch("%d", "%lld"));
+
+static_assert([]{
+    for (int i = 1; i < int(BuiltinLanguage::_count); i++)
+    {
+        for (int j = 0; j < int(StringId::_count); j++)
+        {
+            if (!FormatSpecifiersMatch(builtin_literals[0][j], builtin_literals[i][j]))
+                return false;
+        }
+    }
+    return true;
+}(), "The format specifiers of some built-in translation don't match the Russian ones.");
+
+StringTable BuiltinStrings(BuiltinLanguage language)
+{
+    switch (language)
+    {
+        case BuiltinLanguage::russian:   return StringTable(BuiltinStringData<BuiltinLanguage::russian>::strings.data());
+        case BuiltinLanguage::english:   return StringTable(BuiltinStringData<BuiltinLanguage::english>::strings.data());
+        case BuiltinLanguage::ukrainian: return StringTable(BuiltinStringData<BuiltinLanguage::ukrainian>::strings.data());
+        case BuiltinLanguage::_count:    break;
+    }
+    throw std::runtime_error("Invalid built-in language.");
+}
+
+BuiltinLanguage PreferredBuiltinLanguage()
+{
+    BuiltinLanguage ret = BuiltinLanguage::russian;
+
+    int count = 0;
+    SDL_Locale **locales = SDL_GetPreferredLocales(&count);
+    if (!locales)
+        return ret;
+
+    bool found = false;
+    for (int i = 0; i < count && !found; i++)
+    {
+        for (int j = 0; j < int(BuiltinLanguage::_count); j++)
+        {
+            if (std::string_view(locales[i]->language) == BuiltinStrings(BuiltinLanguage(j))[StringId::language_code])
+            {
+                ret = BuiltinLanguage(j);
+                found = true;
+                break;
+            }
+        }
+    }
+
+    SDL_free(locales);
+    return ret;
+}
+
+LanguagePack::LanguagePack(const std::string &path)
+    : file(path)
+{
+    const StringTable fallback = BuiltinStrings(BuiltinLanguage::english);
+    const StringTable reference = BuiltinStrings(BuiltinLanguage::russian);
+
+    strings.resize(std::size_t(StringId::_count));
+
+    BinaryReader reader(file.Data());
+    if (reader.Read<std::uint32_t>() != pack_magic)
+        throw std::runtime_error("`" + path + "` is not a language pack.");
+    if (reader.Read<std::uint32_t>() != pack_version)
+        throw std::runtime_error("Unsupported language pack version in `" + path + "`.");
+
+    while (!reader.AtEnd())
+    {
+        const std::span<const unsigned char> id_bytes = reader.ReadBytes(reader.ReadIndex(file.Data().size()));
+        const StringId id = FindStringId(std::string_view((const char *)id_bytes.data(), id_bytes.size()));
+
+        const std::span<const unsigned char> text = reader.ReadBytes(reader.ReadIndex(file.Data().size()) + 1);
+        if (text.back() != 0 || std::memchr(text.data(), 0, text.size() - 1))
+            throw std::runtime_error("Invalid string in the language pack `" + path + "`.");
+
+        // Ignore the strings we don't know, they could be from a newer version.
+        if (id == StringId::_count)
+            continue;
+
+        const char *str = (const char *)text.data();
+        if (!FormatSpecifiersMatch(reference[id], str))
+            throw std::runtime_error("The format specifiers of `" + std::string(StringIdName(id)) + "` in the language pack `" + path + "` don't match the built-in ones.");
+        strings[std::size_t(id)] = str;
+    }
+
+    if (!strings[std::size_t(StringId::language_code)])
+        throw std::runtime_error("The language pack `" + path + "` has no `language_code`.");
+
+    for (std::size_t i = 0; i < strings.size(); i++)
+    {
+        if (!strings[i])
+            strings[i] = fallback[StringId(i)];
+    }
+}
+
+void WriteLanguagePack(BinaryWriter &writer, std::span<const char *const> strings)
+{
+    writer.Write(pack_magic);
+    writer.Write(pack_version);
+    for (std::size_t i = 0; i < strings.size() && i < std::size_t(StringId::_count); i++)
+    {
+        if (!strings[i])
+            continue;
+        writer.WriteString(StringIdName(StringId(i)));
+        writer.WriteString(strings[i]);
+        writer.Write<unsigned char>(0);
+    }
+}
+
+StringId FindStringId(std::string_view name)
+{
+    for (std::size_t i = 0; i < std::size(string_id_names); i++)
+    {
+        if (string_id_names[i] == name)
+            return StringId(i);
+    }
+    return StringId::_count;
+}
+
+std::string_view StringIdName(StringId id)
+{
+    return string_id_names[std::size_t(id)];
+}
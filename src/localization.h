@@ -0,0 +1,237 @@
+#pragma once
+
+#include "mapped_file.h"
+#include "state.h"
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class BinaryWriter;
+
+// The UI strings in all built-in languages: `X(id, russian, english, ukrainian)`.
+// The format strings must have the same format specifiers in every language, the language packs are checked against the Russian ones.
+#define UI_STRINGS(X) \
+    X(language_code, "ru", "en", "uk") \
+    X(language_name, "Русский", "English", "Українська") \
+    \
+    X(button_cancel, "Отмена", "Cancel", "Скасувати") \
+    \
+    /* Sync with `Role`. */\
+    X(role_name_captain,    "Капитан",       "Captain",    "Капітан"      ) \
+    X(role_name_sheriff,    "Шериф",         "Sheriff",    "Шериф"        ) \
+    X(role_name_prostitute, "Красотка",      "Beauty",     "Красуня"      ) \
+    X(role_name_mafia_boss, "Дон мафии",     "Mafia boss", "Дон мафії"    ) \
+    X(role_name_mafia,      "Мафия",         "Mafia",      "Мафія"        ) \
+    X(role_name_yakuza,     "Якудза",        "Yakuza",     "Якудза"       ) \
+    X(role_name_killer,     "Маньяк",        "Maniac",     "Маніяк"       ) \
+    X(role_name_none,       "Мирный житель", "Civilian",   "Мирний житель") \
+    X(role_prompt_captain,    "Кого блокирует капитан?",   "Who does the captain block?",   "Кого блокує капітан?"    ) \
+    X(role_prompt_sheriff,    "Кого проверяет шериф?",     "Who does the sheriff check?",   "Кого перевіряє шериф?"   ) \
+    X(role_prompt_prostitute, "К кому приходит красотка?", "Who does the beauty visit?",    "До кого приходить красуня?") \
+    X(role_prompt_mafia_boss, "Кого проверяет дон?",       "Who does the boss check?",      "Кого перевіряє дон?"     ) \
+    X(role_prompt_mafia,      "Кого убивает мафия?",       "Who does the mafia kill?",      "Кого вбиває мафія?"      ) \
+    X(role_prompt_yakuza,     "Кого убивает якудза?",      "Who does the yakuza kill?",     "Кого вбиває якудза?"     ) \
+    X(role_prompt_killer,     "Кого убивает маньяк?",      "Who does the maniac kill?",     "Кого вбиває маніяк?"     ) \
+    X(role_prompt_none,       "Кого убивает город?",       "Who does the town execute?",    "Кого страчує місто?"     ) \
+    \
+    /* Sync with `Faction`. */\
+    X(faction_name_peaceful,    "Мирный", "Civilian", "Мирний") \
+    X(faction_name_mafia,       "Мафия",  "Mafia",    "Мафія" ) \
+    X(faction_name_yakuza,      "Якудза", "Yakuza",   "Якудза") \
+    X(faction_name_killer,      "Маньяк", "Maniac",   "Маніяк") \
+    X(faction_name_pl_peaceful, "Мирные",  "Civilians", "Мирні"  ) \
+    X(faction_name_pl_mafia,    "Мафия",   "Mafia",     "Мафія"  ) \
+    X(faction_name_pl_yakuza,   "Якудза",  "Yakuza",    "Якудза" ) \
+    X(faction_name_pl_killer,   "Маньяки", "Maniacs",   "Маніяки") \
+    \
+    X(menu_button,               "Меню",                   "Menu",                   "Меню"                  ) \
+    X(menu_window,               "Меню",                   "Menu",                   "Меню"                  ) \
+    X(menu_button_back,          "Назад",                  "Back",                   "Назад"                 ) \
+    X(menu_button_new_game,      "Новая игра",             "New game",               "Нова гра"              ) \
+    X(menu_button_undo,          "Отменить",               "Undo",                   "Скасувати"             ) \
+    X(menu_button_redo,          "Повторить",              "Redo",                   "Повторити"             ) \
+    X(menu_checkbox_frame_stats, "Время кадров",           "Frame times",            "Час кадрів"            ) \
+    X(menu_discussion_timer,     "Обсуждение днём",        "Day discussion",         "Обговорення вдень"     ) \
+    X(menu_timer_off,            "Выкл.",                  "Off",                    "Вимк."                 ) \
+    X(menu_timer_minutes,        "%d мин",                 "%d min",                 "%d хв"                 ) \
+    X(menu_button_save_trace,    "Сохранить трассировку",  "Save trace",             "Зберегти трасування"   ) \
+    X(menu_checkbox_broadcast,   "Трансляция для игроков", "Broadcast to players",   "Трансляція для гравців") \
+    X(menu_language,             "Язык",                   "Language",               "Мова"                  ) \
+    X(broadcast_address,         "Адрес: %s:%d, зрителей: %d", "Address: %s:%d, viewers: %d", "Адреса: %s:%d, глядачів: %d") \
+    X(broadcast_port,            "Порт: %d, зрителей: %d",     "Port: %d, viewers: %d",       "Порт: %d, глядачів: %d"     ) \
+    X(menu_button_stats,         "Статистика",             "Statistics",             "Статистика"            ) \
+    X(menu_button_simulation,    "Симуляция баланса",      "Balance simulation",     "Симуляція балансу"     ) \
+    X(menu_button_inference,     "Вероятности ролей",      "Role probabilities",     "Ймовірності ролей"     ) \
+    X(menu_button_tournament,    "Турнир",                 "Tournament",             "Турнір"                ) \
+    \
+    X(stats_window,      "Статистика",                            "Statistics",                              "Статистика"                           ) \
+    X(stats_loading,     "Считаем...",                            "Counting...",                             "Рахуємо..."                           ) \
+    X(stats_num_games,   "Игр: %lld, игроков: %lld",              "Games: %lld, players: %lld",              "Ігор: %lld, гравців: %lld"            ) \
+    X(stats_wins,        "Победы по числу игроков:",              "Wins by the number of players:",          "Перемоги за кількістю гравців:"       ) \
+    X(stats_num_players, "Игроков",                               "Players",                                 "Гравців"                              ) \
+    X(stats_games,       "Игр",                                   "Games",                                   "Ігор"                                 ) \
+    X(stats_no_winner,   "Нет",                                   "None",                                    "Немає"                                ) \
+    X(stats_sheriff,     "Проверок шерифа: %lld, верных: %.0f%%", "Sheriff checks: %lld, correct: %.0f%%",   "Перевірок шерифа: %lld, вірних: %.0f%%") \
+    X(stats_survival,    "Выживаемость по числу визитов:",        "Survival by the number of visits:",       "Виживання за кількістю візитів:"      ) \
+    X(stats_correlation, "Корр.",                                 "Corr.",                                   "Кор."                                 ) \
+    \
+    X(simulation_window,          "Симуляция баланса",                    "Balance simulation",                  "Симуляція балансу"                  ) \
+    X(simulation_setup,           "Игроков: %d, роли как в этой игре.",  "Players: %d, roles as in this game.", "Гравців: %d, ролі як у цій грі."     ) \
+    X(simulation_policy,          "Игроки",                               "Players",                             "Гравці"                             ) \
+    X(simulation_policy_random,   "Случайные",                            "Random",                              "Випадкові"                          ) \
+    X(simulation_policy_informed, "Разумные",                             "Informed",                            "Розумні"                            ) \
+    X(simulation_start,           "Запустить",                            "Run",                                 "Запустити"                          ) \
+    X(simulation_summary,         "Игр: %lld, в среднем %.1f дн.",        "Games: %lld, %.1f days on average",   "Ігор: %lld, в середньому %.1f дн."  ) \
+    X(simulation_winner,          "Победитель",                           "Winner",                              "Переможець"                         ) \
+    X(simulation_win_rate,        "Побед",                                "Wins",                                "Перемог"                            ) \
+    X(simulation_interval,        "Интервал",                             "Interval",                            "Інтервал"                           ) \
+    \
+    X(inference_window,       "Вероятности ролей",                          "Role probabilities",                             "Ймовірності ролей"                            ) \
+    X(inference_exact,        "Точный подсчет.",                            "Counted exactly.",                               "Точний підрахунок."                           ) \
+    X(inference_approximate,  "Приблизно, выборок: %lld.",                  "Approximate, samples: %lld.",                    "Приблизно, вибірок: %lld."                    ) \
+    X(inference_inconsistent, "Роли не сходятся с результатами проверок.", "The roles don't match the results of the checks.", "Ролі не збігаються з результатами перевірок.") \
+    X(inference_player,       "Игрок",                                      "Player",                                         "Гравець"                                      ) \
+    \
+    X(tournament_window,            "Турнир",                                          "Tournament",                                        "Турнір"                                          ) \
+    X(tournament_setup,             "Игроки этого стола (%d) будут рассажены по столам.", "The players of this table (%d) will be seated at the tables.", "Гравці цього столу (%d) будуть розсаджені за столами.") \
+    X(tournament_num_tables,        "Столов",                                          "Tables",                                            "Столів"                                          ) \
+    X(tournament_start,             "Начать турнир",                                   "Start the tournament",                              "Почати турнір"                                   ) \
+    X(tournament_status,            "Тур %d, столов: %d",                              "Round %d, tables: %d",                              "Тур %d, столів: %d"                              ) \
+    X(tournament_table,             "Стол %d",                                         "Table %d",                                          "Стіл %d"                                         ) \
+    X(tournament_table_row,         "Стол %d: игроков %d, день %d",                    "Table %d: %d players, day %d",                      "Стіл %d: гравців %d, день %d"                    ) \
+    X(tournament_next_round,        "Следующий тур",                                   "Next round",                                        "Наступний тур"                                   ) \
+    X(tournament_next_round_window, "Пересадить игроков и начать следующий тур?",      "Reseat the players and start the next round?",      "Пересадити гравців і почати наступний тур?"      ) \
+    X(tournament_end,               "Закончить турнир",                                "End the tournament",                                "Закінчити турнір"                                ) \
+    \
+    X(new_game_window,  "Начать новую игру?", "Start a new game?", "Почати нову гру?") \
+    X(new_game_confirm, "Новая игра",         "New game",          "Нова гра"        ) \
+    \
+    X(day,            "День",       "Day",      "День"      ) \
+    X(night,          "Ночь",       "Night",    "Ніч"       ) \
+    X(day_turn,       "Город",      "Town",     "Місто"     ) \
+    X(choosing_roles, "Перекличка", "Roll call","Перекличка") \
+    \
+    X(players, "Игроки:", "Players:", "Гравці:") \
+    X(turns,   "Ход:",    "Turn:",    "Хід:"   ) \
+    \
+    X(next_turn,         "Дальше",                 "Next",                    "Далі"                   ) \
+    X(restart_from_here, "Переиграть с этого дня", "Replay from this day",    "Переграти з цього дня"  ) \
+    \
+    X(night_killed,            "Убит",      "Killed",      "Вбитий"   ) \
+    X(night_executed,          "Казнён",    "Executed",    "Страчений") \
+    X(night_protected,         "Защищён",   "Protected",   "Захищений") \
+    X(night_blocked,           "блок",      "blocked",     "блок"     ) \
+    X(night_sheriff_found,     "Виновен",   "Guilty",      "Винний"   ) \
+    X(night_sheriff_not_found, "Невиновен", "Innocent",    "Невинний" ) \
+    X(night_boss_found,        "Шериф!",    "Sheriff!",    "Шериф!"   ) \
+    X(night_boss_not_found,    "Не шериф",  "Not sheriff", "Не шериф" ) \
+    \
+    X(add_player_button,    "+ игрок",         "+ player",   "+ гравець"      ) \
+    X(add_player_window,    "Добавить игрока", "Add player", "Додати гравця"  ) \
+    X(add_player_name_hint, "Имя",             "Name",       "Ім'я"           ) \
+    X(add_player_confirm,   "Добавить",        "Add",        "Додати"         ) \
+    \
+    X(remove_player_button,  "Удалить",        "Remove",        "Видалити"       ) \
+    X(remove_player_window,  "Удалить игрока", "Remove player", "Видалити гравця") \
+    X(remove_player_confirm, "Удалить",        "Remove",        "Видалити"       ) \
+    \
+    X(edit_role_button,  "Сменить роль", "Change role", "Змінити роль") \
+    X(edit_role_window,  "Сменить роль", "Change role", "Змінити роль") \
+    X(edit_role_confirm, "Сменить",      "Change",      "Змінити"     ) \
+    \
+    X(timer_speech,       "Речь (%d с)",            "Speech (%d s)",       "Промова (%d с)"       ) \
+    X(timer_final_speech, "Последнее слово (%d с)", "Final speech (%d s)", "Останнє слово (%d с)" ) \
+    X(timer_discussion,   "Обсуждение",             "Discussion",          "Обговорення"          ) \
+    \
+    X(mirror_connecting,   "Подключение к %s:%d...",        "Connecting to %s:%d...",          "Підключення до %s:%d..."           ) \
+    X(mirror_disconnected, "Нет связи, переподключение...", "Disconnected, reconnecting...",   "Немає зв'язку, перепідключення...")
+
+enum class StringId
+{
+    #define X(id_, ...) id_,
+    UI_STRINGS(X)
+    #undef X
+    _count [[maybe_unused]],
+};
+
+// The languages that are compiled in. The language packs can add more, or override those.
+enum class BuiltinLanguage
+{
+    russian,
+    english,
+    ukrainian,
+    _count [[maybe_unused]],
+};
+
+// The UI strings in one language. Cheap to copy, it only points to the strings, which are either built in or in a `LanguagePack`.
+class StringTable
+{
+    const char *const *strings = nullptr;
+
+  public:
+    // `strings` is indexed by `StringId`, and must outlive this table.
+    explicit StringTable(const char *const *strings) : strings(strings) {}
+
+    // The strings are null-terminated.
+    [[nodiscard]] const char *operator[](StringId id) const
+    {
+        return strings[std::size_t(id)];
+    }
+
+    [[nodiscard]] const char *RoleName(Role role) const
+    {
+        return (*this)[StringId(int(StringId::role_name_captain) + int(role))];
+    }
+
+    [[nodiscard]] const char *RolePrompt(Role role) const
+    {
+        return (*this)[StringId(int(StringId::role_prompt_captain) + int(role))];
+    }
+
+    [[nodiscard]] const char *FactionName(Faction faction) const
+    {
+        return (*this)[StringId(int(StringId::faction_name_peaceful) + int(faction))];
+    }
+
+    [[nodiscard]] const char *FactionNamePlural(Faction faction) const
+    {
+        return (*this)[StringId(int(StringId::faction_name_pl_peaceful) + int(faction))];
+    }
+};
+
+[[nodiscard]] StringTable BuiltinStrings(BuiltinLanguage language);
+
+// The built-in language that's closest to the system locale.
+[[nodiscard]] BuiltinLanguage PreferredBuiltinLanguage();
+
+// A language loaded from a file. The strings are used in place, from the mapped file.
+// The file is `[u32 magic][u32 version]`, then `[varint id length][id][varint text length][text][0]` for each string.
+// The ids are the names from `UI_STRINGS()`, so the packs don't break when strings are added. Missing strings are taken from English.
+class LanguagePack
+{
+    MappedFile file;
+    std::vector<const char *> strings;
+
+  public:
+    // Throws if the file is invalid, or if some format string doesn't match the built-in one.
+    explicit LanguagePack(const std::string &path);
+
+    LanguagePack(const LanguagePack &) = delete;
+    LanguagePack &operator=(const LanguagePack &) = delete;
+
+    [[nodiscard]] StringTable Strings() const
+    {
+        return StringTable(strings.data());
+    }
+};
+
+// Writes a language pack for `LanguagePack` to load. `strings` is indexed by `StringId`, the null ones are skipped.
+void WriteLanguagePack(BinaryWriter &writer, std::span<const char *const> strings);
+
+// Returns the id with this name, as in `UI_STRINGS()`, or `StringId::_count` if there's none.
+[[nodiscard]] StringId FindStringId(std::string_view name);
+
+[[nodiscard]] std::string_view StringIdName(StringId id);
@@ -1,9 +1,19 @@
-#include <functional>
 #include <iostream>
 #define SDL_MAIN_USE_CALLBACKS
 
+#include "alloc_counter.h"
+#include "draw_fingerprint.h"
+#include "fonts.h"
+#include "frame_stats.h"
 #include "game.h"
+#include "input_recording.h"
 #include "main.h"
+#include "mirror.h"
+#include "redraw.h"
+#include "replication.h"
+#include "startup.h"
+#include "touch_controller.h"
+#include "trace.h"
 
 #include <imgui.h>
 #include <imgui_internal.h>
@@ -13,9 +23,13 @@
 #include <SDL3/SDL_main.h>
 #include <SDL3/SDL_system.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <utility>
 
 #ifdef __EMSCRIPTEN__
@@ -26,325 +40,178 @@ SDL_Window* window;
 SDL_Renderer* renderer;
 
 static std::unique_ptr<BasicGame> game;
+// Creates the game on a worker thread, since restoring the session reads and replays the journal. Moved into `game` when done.
+static StartupStage<std::unique_ptr<BasicGame>> game_stage;
+
+// Set by `--record-input <file>`.
+static std::unique_ptr<InputRecorder> input_recorder;
 
 const int default_redraw_frames = 4;
 static int redraw_frames = default_redraw_frames;
 
 const ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
 
-struct TouchController
-{
-    // Public config: [
+// The fingerprint of the last presented frame. If the new frame has the same one, we don't render and present it.
+static std::uint64_t presented_fingerprint = 0;
+// Set when the window contents might have been lost, or the window changed in a way the fingerprint doesn't catch. Forces the next frame to be presented.
+static bool force_present = true;
+// When the last frame was presented or skipped.
+static std::uint64_t last_present_time_ns = 0;
 
-    // if true, accept even mouse input, noy only touch. Good for debugging.
-    bool accept_any_input_source = false;
+// We log how long the first frame took to appear, and complain if it's over this.
+// On the web this includes downloading the app, so the budget is larger.
+#ifdef __EMSCRIPTEN__
+const double time_to_first_frame_budget_ms = 3000;
+#else
+const double time_to_first_frame_budget_ms = 1000;
+#endif
+static bool first_frame_presented = false;
 
-    // How long to hold to imitate right click.
-    float hold_duration_to_right_click = 0.5f;
+static void ReportTimeToFirstFrame()
+{
+    #ifdef __EMSCRIPTEN__
+    // Since the page navigation started.
+    const double time_ms = emscripten_get_now();
+    // Remove the placeholder from `emscripten_shell.html`.
+    EM_ASM(document.getElementById('loading')?.remove());
+    #else
+    // Since the startup, when we first touched SDL.
+    const double time_ms = double(SDL_GetTicksNS()) / 1e6;
+    #endif
 
-    // By default, if the input device is a pen, hold-to-right-click is disabled,
-    //   since pens should usually have their own ways to right click.
-    // Setting this to true enables it.
-    bool allow_hold_to_right_click_on_pen = false;
+    if (time_ms > time_to_first_frame_budget_ms)
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Time to first frame: %.0f ms, over the budget of %.0f ms.", time_ms, time_to_first_frame_budget_ms);
+    else
+        SDL_Log("Time to first frame: %.0f ms.", time_ms);
+}
 
-    // How far you must move finger to trigger drag.
-    std::function<float()> drag_threshold_func = []{return ImGui::GetTextLineHeight();};
+// The gamepads aren't needed for the first frame, and on Android enumerating the input devices is slow, so they're initialized after it.
+// The ImGui backend picks them up from the `SDL_EVENT_GAMEPAD_ADDED` events that this sends.
+static void InitGamepads()
+{
+    const std::uint64_t start_ns = SDL_GetTicksNS();
+    if (!SDL_InitSubSystem(SDL_INIT_GAMEPAD))
+        SDL_Log("Unable to initialize the gamepads: %s", SDL_GetError());
+    LogStartupStage("initializing the gamepads", start_ns);
+}
 
-    // ]
+#ifndef __EMSCRIPTEN__
+// Without `SDL_RenderPresent()`, nothing waits for vsync. So we wait ourselves, to not spin the CPU while e.g. the mouse is held.
+static void WaitInsteadOfPresent()
+{
+    const SDL_DisplayMode *mode = SDL_GetCurrentDisplayMode(SDL_GetDisplayForWindow(window));
+    const float refresh_rate = mode && mode->refresh_rate > 0 ? mode->refresh_rate : 60;
+    const std::uint64_t next_present_time_ns = last_present_time_ns + std::uint64_t(1e9 / refresh_rate);
 
+    const std::uint64_t now = SDL_GetTicksNS();
+    if (now < next_present_time_ns)
+        SDL_DelayPrecise(next_present_time_ns - now);
+}
+#endif
 
-    // Here we initialize everything, to silence warnings on missing fields when using designated initialization.
+// Whether we're waiting for events between `SDL_AppIterate()` calls, rather than calling it continuously.
+static bool idle = false;
 
-    // We replace the event IDs with our own, since we're inserting new events, and can't otherwise maintain sequental IDs.
-    ImU32 event_counter = ImU32(-1);
+static void SetIdle(bool new_idle)
+{
+    if (idle == new_idle)
+        return;
+    idle = new_idle;
 
-    ImVec2 mouse_pos{};
-    ImGuiMouseSource mouse_source{};
-    ImVec2 mouse_pos_when_clicked{};
-    ImGuiID window_id = 0;
-    ImVec2 window_scroll_when_clicked{};
-    bool mouse_held = false;
-    bool fake_scroll = false;
-    bool once_restore_mouse_pos = false;
-    bool no_scroll_this_time = false;
+    #ifdef __EMSCRIPTEN__
+    if (idle)
+        emscripten_pause_main_loop();
+    else
+        emscripten_resume_main_loop();
+    #else
+    SDL_SetHint(SDL_HINT_MAIN_CALLBACK_RATE, idle ? "waitevent" : "0");
+    #endif
+}
 
+#ifdef __EMSCRIPTEN__
+// SDL doesn't pass the events to `SDL_AppEvent()` while the main loop is paused, so we resume it from an event watch.
+static bool SDLCALL WakeUpOnEvent(void *userdata, SDL_Event *event)
+{
+    (void)userdata;
+    (void)event;
+    SetIdle(false);
+    return true;
+}
+#endif
 
-    // If true, don't pause your rendering loop.
-    [[nodiscard]] bool ShouldRedraw() const
-    {
-        return mouse_held;
-    }
+// Requests a redraw when the text cursor blinks next.
+static void RequestCursorBlinkRedraw()
+{
+    if (!ImGui::GetIO().ConfigInputTextCursorBlink)
+        return;
+    const ImGuiInputTextState *state = ImGui::GetInputTextState(ImGui::GetActiveID());
+    if (!state)
+        return;
+
+    // This mirrors `ImGui::InputTextEx()`: the cursor is visible while `CursorAnim <= 0` or `fmod(CursorAnim, 1.2) <= 0.8`.
+    const float phase = state->CursorAnim <= 0 ? state->CursorAnim : std::fmod(state->CursorAnim, 1.2f);
+    RequestRedrawIn(phase < 0.8f ? 0.8f - phase : 1.2f - phase);
+}
 
-    void HandleEvents()
-    {
-        const float drag_threshold = drag_threshold_func();
-
-        ImGuiContext &ctx = *ImGui::GetCurrentContext();
-
-        // If true, we can't scroll.
-        const bool active_id_bad =
-            ctx.ActiveIdWindow &&
-            (
-                // If not dragging a window. This is needed despite `.ConfigWindowsMoveFromTitleBarOnly == true` above,
-                //   since holding a window background still sets an active ID even with this flag.
-                // The `ctx.MovingWindow` part is what excludes "dragging" the window background with no effect.
-                (ImGui::GetActiveID() == ctx.ActiveIdWindow->MoveId && ctx.MovingWindow) ||
-                // Not dragging either scrollbar.
-                (ImGui::GetActiveID() == ImGui::GetWindowScrollbarID(ctx.ActiveIdWindow, ImGuiAxis_X)) ||
-                (ImGui::GetActiveID() == ImGui::GetWindowScrollbarID(ctx.ActiveIdWindow, ImGuiAxis_Y)) ||
-                // Not resizing a window using its corners.
-                (ImGui::GetActiveID() == ImGui::GetWindowResizeCornerID(ctx.ActiveIdWindow, 0)) ||
-                (ImGui::GetActiveID() == ImGui::GetWindowResizeCornerID(ctx.ActiveIdWindow, 1)) ||
-                // Not resizing a window using a border.
-                ctx.ActiveIdWindow->ResizeBorderHeld != -1
-            );
-
-        // If true, we can scroll.
-        const bool active_id_good =
-            !active_id_bad &&
-            ctx.ActiveIdWindow &&
-            (
-                // Trying to move a window by its body, which does nothing when `.ConfigWindowsMoveFromTitleBarOnly == true`.
-                (ImGui::GetActiveID() == ctx.ActiveIdWindow->MoveId && !ctx.MovingWindow)
-            );
-
-        // If true, we scroll only if the vertical threshold is reached before horizontal.
-        const bool active_id_vert_only = !active_id_good && !active_id_bad && ImGui::GetActiveID();
-
-        auto CheckMouseSource = [&](ImGuiMouseSource new_source)
-        {
-            if (new_source == ImGuiMouseSource_TouchScreen || new_source == ImGuiMouseSource_Pen || accept_any_input_source)
-            {
-                mouse_source = new_source;
-                return true;
-            }
+#if COUNT_ALLOCATIONS
+// How many frames in a row had no input events. After a couple of those, the frames must not allocate.
+static int frames_without_input = 0;
+#endif
 
-            return false;
-        };
+TouchController touch_controller{
+    .accept_any_input_source = true
+};
 
-        ImGui::GetIO().ConfigWindowsMoveFromTitleBarOnly = true;
+SDL_AppResult SDLCALL SDL_AppInit(void **appstate, int argc, char *argv[])
+{
+    TRACE_THREAD_NAME("Main");
+    TRACE_ZONE("Init");
 
-        ImVector<ImGuiInputEvent> out_queue;
+    (void)appstate;
 
-        // Act on fake scroll.
-        if (fake_scroll)
-        {
-            if (ImGuiWindow *win = ImGui::FindWindowByID(window_id))
-            {
-                auto ApplyScroll = [&](this auto &self, ImGuiWindow &win, bool y, float value) -> void
-                {
-                    if (!(win.Flags & ImGuiWindowFlags_NoScrollWithMouse))
-                    {
-                        win.Scroll[y] = value;
-                        if (win.Scroll[y] < 0)
-                            win.Scroll[y] = 0;
-                        else if (win.Scroll[y] > win.ScrollMax[y])
-                            win.Scroll[y] = win.ScrollMax[y];
-                    }
-
-                    if (value != win.Scroll[y] && win.ParentWindow)
-                    {
-                        const float parent_scroll = win.ParentWindow->Scroll[y];
-                        self(*win.ParentWindow, y, win.ParentWindow->Scroll[y] + (value - win.Scroll[y]));
-                        window_scroll_when_clicked[y] += parent_scroll - win.ParentWindow->Scroll[y];
-                    }
-                };
-
-                for (bool y : {false, true})
-                    ApplyScroll(*win, y, mouse_pos_when_clicked[y] - mouse_pos[y] + window_scroll_when_clicked[y]);
-            }
-        }
+    std::uint64_t stage_start_ns = SDL_GetTicksNS();
 
-        // Restore mouse pos after a single frame delay, after stopping the scroll.
-        if (std::exchange(once_restore_mouse_pos, false))
-        {
-            // Return the mouse to its correct position.
-            out_queue.push_back({});
-            ImGuiInputEvent &mouse_reset_pos_event = out_queue.back();
-            mouse_reset_pos_event.EventId = event_counter++;
-            mouse_reset_pos_event.Source = ImGuiInputSource_Mouse;
-            mouse_reset_pos_event.Type = ImGuiInputEventType_MousePos;
-            mouse_reset_pos_event.MousePos.MouseSource = mouse_source;
-            mouse_reset_pos_event.MousePos.PosX = mouse_pos.x;
-            mouse_reset_pos_event.MousePos.PosY = mouse_pos.y;
-        }
+    std::string input_recording_path;
+    // Set by `--mirror host[:port]`. Then instead of the game we show what another device publishes.
+    std::string mirror_address;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string_view arg = argv[i];
+        if (arg == "--record-input" && i + 1 < argc)
+            input_recording_path = argv[++i];
+        else if (arg == "--mirror" && i + 1 < argc)
+            mirror_address = argv[++i];
+        else
+            SDL_Log("Unknown argument: `%s`.", argv[i]);
+    }
 
-        // Transform long tap to right click.
-        if (
-            mouse_held &&
-            !no_scroll_this_time &&
-            // Known bad IDs don't need our right click.
-            // Known good ones should be allowed, since the demo has e.g. right-clickable text labels, which we don't see and treat as dragging the window, which is good.
-            !active_id_bad &&
-            // Held long enough.
-            ImGui::GetIO().MouseDownDuration[ImGuiMouseButton_Left] > hold_duration_to_right_click &&
-            // Don't enable for pen, unless the user explicitly opts in.
-            (allow_hold_to_right_click_on_pen || mouse_source != ImGuiMouseSource_Pen)
-        )
-        {
-            mouse_held = false;
-
-            // Prevent mouse release from registering as a click.
-            ImGui::ClearActiveID();
-
-            // Release left button.
-            out_queue.push_back({});
-            ImGuiInputEvent &mouse_release_left_event = out_queue.back();
-            mouse_release_left_event.EventId = event_counter++;
-            mouse_release_left_event.Source = ImGuiInputSource_Mouse;
-            mouse_release_left_event.Type = ImGuiInputEventType_MouseButton;
-            mouse_release_left_event.MouseButton.MouseSource = mouse_source;
-            mouse_release_left_event.MouseButton.Button = ImGuiMouseButton_Left;
-            mouse_release_left_event.MouseButton.Down = false;
-
-            // Press right button.
-            out_queue.push_back({});
-            ImGuiInputEvent &mouse_press_right_event = out_queue.back();
-            mouse_press_right_event.EventId = event_counter++;
-            mouse_press_right_event.Source = ImGuiInputSource_Mouse;
-            mouse_press_right_event.Type = ImGuiInputEventType_MouseButton;
-            mouse_press_right_event.MouseButton.MouseSource = mouse_source;
-            mouse_press_right_event.MouseButton.Button = ImGuiMouseButton_Right;
-            mouse_press_right_event.MouseButton.Down = true;
-
-            // Release right button immediately, since we'll never get a release event for either the left button (because it's already considered released)
-            //   or the right button (since it's not actually held).
-            out_queue.push_back({});
-            ImGuiInputEvent &mouse_release_right_event = out_queue.back();
-            mouse_release_right_event.EventId = event_counter++;
-            mouse_release_right_event.Source = ImGuiInputSource_Mouse;
-            mouse_release_right_event.Type = ImGuiInputEventType_MouseButton;
-            mouse_release_right_event.MouseButton.MouseSource = mouse_source;
-            mouse_release_right_event.MouseButton.Button = ImGuiMouseButton_Right;
-            mouse_release_right_event.MouseButton.Down = false;
-        }
+    // Start the stages that don't need the window, to run while we create it.
+    StartLoadingFonts();
 
-        // Handle the events.
-        for (const ImGuiInputEvent &in_event : ctx.InputEventsQueue)
-        {
-            out_queue.push_back(in_event);
-            ImGuiInputEvent &out_event = out_queue.back();
-
-            if (event_counter == ImU32(-1))
-                event_counter = in_event.EventId + 1;
-            else
-                out_event.EventId = event_counter++;
-
-            if (in_event.Type == ImGuiInputEventType_MousePos)
-            {
-                if (CheckMouseSource(in_event.MousePos.MouseSource))
-                {
-                    mouse_pos = ImVec2(in_event.MousePos.PosX, in_event.MousePos.PosY);
-
-                    if (fake_scroll)
-                    {
-                        out_queue.pop_back();
-                        event_counter--;
-                        continue;
-                    }
-
-                    if (
-                        mouse_held &&
-                        ctx.HoveredWindow &&
-                        !no_scroll_this_time &&
-                        !active_id_bad &&
-                        (active_id_good || ImLengthSqr(ImVec2(mouse_pos.x - mouse_pos_when_clicked.x, mouse_pos.y - mouse_pos_when_clicked.y)) > drag_threshold * drag_threshold)
-                    )
-                    {
-                        // For certain active widgets, triggering the horizontal threshold first disables the scroll behaviors.
-                        if (active_id_vert_only && std::abs(mouse_pos.x - mouse_pos_when_clicked.x) > std::abs(mouse_pos.y - mouse_pos_when_clicked.y))
-                        {
-                            no_scroll_this_time = true;
-
-                            // Update mouse position, since we've been eating mouse events before.
-                            ImGuiInputEvent &mouse_restore_pos_event = out_event;
-                            mouse_restore_pos_event.Source = ImGuiInputSource_Mouse;
-                            mouse_restore_pos_event.Type = ImGuiInputEventType_MousePos;
-                            mouse_restore_pos_event.MousePos.MouseSource = mouse_source;
-                            mouse_restore_pos_event.MousePos.PosX = mouse_pos.x;
-                            mouse_restore_pos_event.MousePos.PosY = mouse_pos.y;
-                            continue;
-                        }
-
-                        ImGui::ClearActiveID();
-
-                        mouse_held = false;
-                        fake_scroll = true;
-                        window_id = ctx.HoveredWindow->ID;
-                        window_scroll_when_clicked = ctx.HoveredWindow->Scroll;
-
-                        // No reading the original event beyond this point.
-
-                        // Move mouse to a dummy position.
-                        ImGuiInputEvent &mouse_dummy_pos_event = out_event;
-                        mouse_dummy_pos_event.Source = ImGuiInputSource_Mouse;
-                        mouse_dummy_pos_event.Type = ImGuiInputEventType_MousePos;
-                        mouse_dummy_pos_event.MousePos.MouseSource = mouse_source;
-                        // Move the mouse to the window corner, so if someone sends e.g. a scroll event, this window will catch it. Not sure how useful this actually is.
-                        mouse_dummy_pos_event.MousePos.PosX = ctx.HoveredWindow->Pos.x;
-                        mouse_dummy_pos_event.MousePos.PosY = ctx.HoveredWindow->Pos.y;
-                        continue;
-                    }
-
-                    // Undecided if we should scroll yet, eat the mouse events for now.
-                    if (mouse_held && active_id_vert_only && !no_scroll_this_time)
-                    {
-                        out_queue.pop_back();
-                        event_counter--;
-                        continue;
-                    }
-                }
-
-                continue;
-            }
-
-            if (in_event.Type == ImGuiInputEventType_MouseButton)
-            {
-                if (CheckMouseSource(in_event.MouseButton.MouseSource) && in_event.MouseButton.Button == ImGuiMouseButton_Left)
-                {
-                    if (!in_event.MouseButton.Down)
-                    {
-                        mouse_held = false;
-
-                        if (fake_scroll)
-                        {
-                            fake_scroll = false;
-                            once_restore_mouse_pos = true;
-                        }
-
-                        continue;
-                    }
-
-                    if (!mouse_held)
-                    {
-                        mouse_pos_when_clicked = mouse_pos;
-                        no_scroll_this_time = false;
-                    }
-
-                    mouse_held = true;
-                }
-
-                continue;
-            }
-        }
+    GameOptions game_options;
+    // The replay starts from a new game, so the recording must too.
+    if (!input_recording_path.empty())
+        game_options.persist_session = false;
 
-        ctx.InputEventsQueue.swap(out_queue);
+    if (!mirror_address.empty())
+    {
+        // This only starts connecting in the background.
+        std::string host;
+        std::uint16_t port = 0;
+        ParseReplicationAddress(mirror_address, host, port);
+        game = MakeMirror(std::move(host), port);
+    }
+    else
+    {
+        game_stage = StartupStage<std::unique_ptr<BasicGame>>("loading the session", [game_options]{return MakeGame(game_options);});
     }
-};
-
-TouchController touch_controller{
-    .accept_any_input_source = true
-};
-
-SDL_AppResult SDLCALL SDL_AppInit(void **appstate, int argc, char *argv[])
-{
-    (void)appstate;
-    (void)argc;
-    (void)argv;
 
-    // Setup SDL
-    if (!SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMEPAD))
+    // Setup SDL. The gamepads are initialized after the first frame, see `InitGamepads()`.
+    if (!SDL_Init(SDL_INIT_VIDEO))
         throw std::runtime_error(std::string("`SDL_Init` failed: ") + SDL_GetError());
+    EnableMainLoopWakeUps();
+    LogStartupStage("initializing SDL", stage_start_ns);
+    stage_start_ns = SDL_GetTicksNS();
 
     // Create window with SDL_Renderer graphics context
     float main_scale = SDL_GetDisplayContentScale(SDL_GetPrimaryDisplay());
@@ -360,9 +227,14 @@ SDL_AppResult SDLCALL SDL_AppInit(void **appstate, int argc, char *argv[])
     if (!renderer)
         throw std::runtime_error(std::string("`SDL_CreateRenderer` failed: ") + SDL_GetError());
     SDL_SetRenderVSync(renderer, 1);
+    LogStartupStage("creating the window and the renderer", stage_start_ns);
+    stage_start_ns = SDL_GetTicksNS();
 
     // Setup Dear ImGui context
     IMGUI_CHECKVERSION();
+    #if COUNT_ALLOCATIONS
+    ImGui::SetAllocatorFunctions(CountingImGuiAlloc, CountingImGuiFree);
+    #endif
     ImGui::CreateContext();
     ImGuiIO& io = ImGui::GetIO();
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;     // Enable Keyboard Controls
@@ -385,22 +257,16 @@ SDL_AppResult SDLCALL SDL_AppInit(void **appstate, int argc, char *argv[])
     ImGui_ImplSDL3_InitForSDLRenderer(window, renderer);
     ImGui_ImplSDLRenderer3_Init(renderer);
 
-    ;
+    io.IniFilename = nullptr;
 
-    #if defined(__ANDROID__)
-    std::size_t font_size = 0;
-    // Can't free this data, ImGui needs it to stay alive.
-    static void *font = SDL_LoadFile("NotoSans.ttf", &font_size);
-    io.Fonts->AddFontFromMemoryTTF(font, (int)font_size);
-    #elif defined(__EMSCRIPTEN__)
-    io.Fonts->AddFontFromFileTTF("assets/NotoSans.ttf");
-    #else
-    io.Fonts->AddFontFromFileTTF((std::string(SDL_GetBasePath()) + "NotoSans.ttf").c_str());
-    #endif
+    if (!input_recording_path.empty())
+        input_recorder = std::make_unique<InputRecorder>(input_recording_path, main_scale, io.ConfigFlags);
 
-    io.IniFilename = nullptr;
+    LogStartupStage("setting up ImGui", stage_start_ns);
 
-    game = MakeGame();
+    #ifdef __EMSCRIPTEN__
+    SDL_AddEventWatch(WakeUpOnEvent, nullptr);
+    #endif
 
     redraw_frames = default_redraw_frames;
 
@@ -409,19 +275,39 @@ SDL_AppResult SDLCALL SDL_AppInit(void **appstate, int argc, char *argv[])
 
 SDL_AppResult SDLCALL SDL_AppIterate(void *appstate)
 {
-    touch_controller.HandleEvents();
+    TRACE_ZONE("Iterate");
+
+    // The first frame needs the font and the game. Until they're loaded there's nothing to draw, and we get woken up when each of them is ready.
+    // On Emscripten the font is downloaded asynchronously too.
+    if (!game && game_stage.IsReady())
+        game = game_stage.Get();
+    if (!FontsLoaded() || !game)
+    {
+        SetIdle(true);
+        return SDL_APP_CONTINUE;
+    }
+
+    frame_stats.BeginFrame();
+
+    {
+        TRACE_ZONE("Handle events");
+        touch_controller.HandleEvents();
+    }
+    frame_stats.EndPhase(FramePhase::handle_events);
 
     (void)appstate;
+    if (RedrawDeadlinePassed())
+        redraw_frames = std::max(redraw_frames, 1);
     if (SDL_GetWindowFlags(window) & SDL_WINDOW_MINIMIZED)
         redraw_frames = 0;
     if (SDL_GetMouseState(nullptr, nullptr))
         redraw_frames = default_redraw_frames; // Mouse held, needed for certain interactions.
     else if (touch_controller.ShouldRedraw())
-        redraw_frames = default_redraw_frames; // For the blinking cursor and such.
-    else if (ImGui::IsAnyItemActive())
-        redraw_frames = default_redraw_frames; // For the blinking cursor and such.
-    else if (ImGui::IsPopupOpen(nullptr, ImGuiPopupFlags_AnyPopup))
-        redraw_frames = default_redraw_frames; // For the popup animation.
+        redraw_frames = default_redraw_frames; // Same.
+    else if (ImGui::IsAnyItemActive() && !ImGui::GetIO().WantTextInput)
+        redraw_frames = default_redraw_frames; // Held with a keyboard or a gamepad. Text inputs are handled below, they only need to redraw when the cursor blinks.
+    else if (float dim = ImGui::GetCurrentContext()->DimBgRatio; dim > 0 && dim < 1)
+        redraw_frames = default_redraw_frames; // For the modal popup animation.
 
     if (redraw_frames > 0)
     {
@@ -429,35 +315,147 @@ SDL_AppResult SDLCALL SDL_AppIterate(void *appstate)
     }
     else
     {
+        // Nothing to draw, sleep until the next event or the next requested redraw.
+        frame_stats.SkipFrame();
+        if (input_recorder)
+            input_recorder->AddIteration({});
+        SetIdle(true);
         return SDL_APP_CONTINUE;
     }
 
-    // Start the Dear ImGui frame
-    ImGui_ImplSDLRenderer3_NewFrame();
-    ImGui_ImplSDL3_NewFrame();
-    ImGui::NewFrame();
+    BeginRedrawRequests();
+
+    #if COUNT_ALLOCATIONS
+    if (ImGui::GetCurrentContext()->InputEventsQueue.empty())
+        frames_without_input++;
+    else
+        frames_without_input = 0;
+    #endif
+
+    { // Start the Dear ImGui frame
+        TRACE_ZONE("New frame");
+        ImGui_ImplSDLRenderer3_NewFrame();
+        ImGui_ImplSDL3_NewFrame();
+        if (input_recorder)
+        {
+            const ImGuiIO &io = ImGui::GetIO();
+            input_recorder->AddIteration(RecordedFrame{.display_size = io.DisplaySize, .framebuffer_scale = io.DisplayFramebufferScale, .delta_time = io.DeltaTime});
+        }
+        ImGui::NewFrame();
+    }
+    // Keep drawing frames until the common glyphs are rasterized, even if nothing else happens.
+    if (WarmUpGlyphs())
+        RequestRedrawIn(0);
+    frame_stats.EndPhase(FramePhase::new_frame);
+
+    #if COUNT_ALLOCATIONS
+    const std::uint64_t allocations_before_tick = GetNumAllocations();
+    #endif
 
     game->Tick();
 
+    #if COUNT_ALLOCATIONS
+    // The first input-free frame can still react to the input from the previous frame (e.g. open a popup), so we skip it.
+    if (frames_without_input >= 2 && GetNumAllocations() != allocations_before_tick)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "A steady-state frame made %d heap allocations in `Tick()`.", int(GetNumAllocations() - allocations_before_tick));
+        SDL_assert_always(!"A steady-state frame shouldn't allocate.");
+    }
+    #endif
+
+    frame_stats.EndPhase(FramePhase::tick);
+
+    RequestCursorBlinkRedraw();
+
+    frame_stats.DrawOverlay();
+    frame_stats.SkipTime();
+
     // Rendering
-    ImGui::Render();
-    SDL_SetRenderScale(renderer, ImGui::GetIO().DisplayFramebufferScale.x, ImGui::GetIO().DisplayFramebufferScale.y);
-    SDL_SetRenderDrawColorFloat(renderer, clear_color.x, clear_color.y, clear_color.z, clear_color.w);
-    SDL_RenderClear(renderer);
-    ImGui_ImplSDLRenderer3_RenderDrawData(ImGui::GetDrawData(), renderer);
-    SDL_RenderPresent(renderer);
+    {
+        TRACE_ZONE("Render");
+        ImGui::Render();
+    }
+    frame_stats.EndPhase(FramePhase::render);
+
+    // Often the frame is the same as the previous one, e.g. the last few of `redraw_frames`. Then the screen already shows it.
+    ImDrawData *draw_data = ImGui::GetDrawData();
+    const std::uint64_t fingerprint = DrawDataFingerprint(*draw_data);
+    // The texture updates are done by the renderer, so we can't skip it while there are any.
+    if (std::exchange(force_present, false) || fingerprint != presented_fingerprint || HasPendingTextureUpdates(*draw_data))
+    {
+        presented_fingerprint = fingerprint;
+
+        SDL_SetRenderScale(renderer, ImGui::GetIO().DisplayFramebufferScale.x, ImGui::GetIO().DisplayFramebufferScale.y);
+        SDL_SetRenderDrawColorFloat(renderer, clear_color.x, clear_color.y, clear_color.z, clear_color.w);
+        {
+            TRACE_ZONE("Draw");
+            SDL_RenderClear(renderer);
+            ImGui_ImplSDLRenderer3_RenderDrawData(draw_data, renderer);
+        }
+        frame_stats.EndPhase(FramePhase::render_draw_data);
+        {
+            TRACE_ZONE("Present");
+            SDL_RenderPresent(renderer);
+        }
+        frame_stats.EndPhase(FramePhase::present);
+
+        if (!std::exchange(first_frame_presented, true))
+        {
+            ReportTimeToFirstFrame();
+            InitGamepads();
+        }
+    }
+    else
+    {
+        frame_stats.EndPhase(FramePhase::render_draw_data);
+        #ifndef __EMSCRIPTEN__ // There the browser calls us once per display frame anyway.
+        {
+            TRACE_ZONE("Wait instead of present");
+            WaitInsteadOfPresent();
+        }
+        #endif
+        frame_stats.EndPhase(FramePhase::present);
+    }
+    last_present_time_ns = SDL_GetTicksNS();
+
+    frame_stats.EndFrame();
+
+    EndRedrawRequests();
+    SetIdle(redraw_frames == 0);
 
     return SDL_APP_CONTINUE;
 }
 
 SDL_AppResult SDLCALL SDL_AppEvent(void *appstate, SDL_Event *event)
 {
+    TRACE_ZONE("Event");
     (void)appstate;
+    if (input_recorder)
+        input_recorder->AddEvent(*event);
     ImGui_ImplSDL3_ProcessEvent(event);
 
     if (event->type == SDL_EVENT_QUIT || (event->type == SDL_EVENT_WINDOW_CLOSE_REQUESTED && event->window.windowID == SDL_GetWindowID(window)))
         return SDL_APP_SUCCESS;
 
+    // On mobile the app can get killed without notice after this, so make sure the session is on disk.
+    if ((event->type == SDL_EVENT_WILL_ENTER_BACKGROUND || event->type == SDL_EVENT_TERMINATING) && game)
+        game->Persist();
+
+    // The window contents might be lost or stale, so we can't rely on the last presented frame still being on screen.
+    if (
+        event->type == SDL_EVENT_WINDOW_EXPOSED ||
+        event->type == SDL_EVENT_WINDOW_RESIZED ||
+        event->type == SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED ||
+        event->type == SDL_EVENT_WINDOW_RESTORED ||
+        event->type == SDL_EVENT_WILL_ENTER_FOREGROUND ||
+        event->type == SDL_EVENT_DID_ENTER_FOREGROUND ||
+        event->type == SDL_EVENT_RENDER_TARGETS_RESET ||
+        event->type == SDL_EVENT_RENDER_DEVICE_RESET
+    )
+    {
+        force_present = true;
+    }
+
     if (
         event->type == SDL_EVENT_MOUSE_BUTTON_DOWN ||
         event->type == SDL_EVENT_MOUSE_BUTTON_UP ||
@@ -465,6 +463,11 @@ SDL_AppResult SDLCALL SDL_AppEvent(void *appstate, SDL_Event *event)
         event->type == SDL_EVENT_MOUSE_WHEEL ||
         event->type == SDL_EVENT_KEY_DOWN ||
         event->type == SDL_EVENT_KEY_UP ||
+        event->type == SDL_EVENT_TEXT_INPUT || // On Android, the on-screen keyboard only sends those, without key events.
+        event->type == SDL_EVENT_TEXT_EDITING ||
+        event->type == SDL_EVENT_GAMEPAD_BUTTON_DOWN ||
+        event->type == SDL_EVENT_GAMEPAD_BUTTON_UP ||
+        event->type == SDL_EVENT_GAMEPAD_AXIS_MOTION ||
         event->type == SDL_EVENT_WINDOW_EXPOSED ||
         event->type == SDL_EVENT_WINDOW_RESIZED ||
         event->type == SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED ||
@@ -482,6 +485,11 @@ void SDLCALL SDL_AppQuit(void *appstate, SDL_AppResult result)
     (void)appstate;
     (void)result;
 
+    // This also writes the session to disk. If the session is still loading, this waits for it.
+    game_stage = {};
+    game = nullptr;
+    input_recorder = nullptr;
+
     ImGui_ImplSDLRenderer3_Shutdown();
     ImGui_ImplSDL3_Shutdown();
     ImGui::DestroyContext();
@@ -0,0 +1,82 @@
+#include "mapped_file.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string &path)
+{
+    #ifdef _WIN32
+    file_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_handle == INVALID_HANDLE_VALUE)
+    {
+        file_handle = nullptr;
+        throw std::runtime_error("Unable to open `" + path + "`.");
+    }
+
+    LARGE_INTEGER file_size{};
+    if (!GetFileSizeEx(file_handle, &file_size))
+    {
+        CloseHandle(file_handle);
+        throw std::runtime_error("Unable to get the size of `" + path + "`.");
+    }
+    size = std::size_t(file_size.QuadPart);
+
+    // Can't map empty files.
+    if (size == 0)
+        return;
+
+    mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_handle)
+        data = (const unsigned char *)MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+    if (!data)
+    {
+        if (mapping_handle)
+            CloseHandle(mapping_handle);
+        CloseHandle(file_handle);
+        throw std::runtime_error("Unable to map `" + path + "` into memory.");
+    }
+    #else
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        throw std::runtime_error("Unable to open `" + path + "`.");
+
+    struct stat info{};
+    if (fstat(fd, &info) != 0)
+    {
+        close(fd);
+        throw std::runtime_error("Unable to get the size of `" + path + "`.");
+    }
+    size = std::size_t(info.st_size);
+
+    // The mapping stays valid after closing the file.
+    void *ptr = size == 0 ? nullptr : mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED)
+        throw std::runtime_error("Unable to map `" + path + "` into memory.");
+    data = (const unsigned char *)ptr;
+    #endif
+}
+
+MappedFile::~MappedFile()
+{
+    #ifdef _WIN32
+    if (data)
+        UnmapViewOfFile(data);
+    if (mapping_handle)
+        CloseHandle(mapping_handle);
+    if (file_handle)
+        CloseHandle(file_handle);
+    #else
+    if (data)
+        munmap((void *)data, size);
+    #endif
+}
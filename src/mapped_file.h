@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <utility>
+
+// A file mapped into memory for reading.
+class MappedFile
+{
+    const unsigned char *data = nullptr;
+    std::size_t size = 0;
+
+    #ifdef _WIN32
+    void *file_handle = nullptr;
+    void *mapping_handle = nullptr;
+    #endif
+
+    void Swap(MappedFile &other) noexcept
+    {
+        std::swap(data, other.data);
+        std::swap(size, other.size);
+        #ifdef _WIN32
+        std::swap(file_handle, other.file_handle);
+        std::swap(mapping_handle, other.mapping_handle);
+        #endif
+    }
+
+  public:
+    MappedFile() {}
+
+    // Throws if the file can't be opened.
+    explicit MappedFile(const std::string &path);
+
+    MappedFile(MappedFile &&other) noexcept
+    {
+        Swap(other);
+    }
+    MappedFile &operator=(MappedFile other) noexcept
+    {
+        Swap(other);
+        return *this;
+    }
+    ~MappedFile();
+
+    [[nodiscard]] std::span<const unsigned char> Data() const
+    {
+        return {data, size};
+    }
+};
@@ -0,0 +1,96 @@
+#include "mirror.h"
+
+#include "localization.h"
+#include "replication.h"
+#include "startup.h"
+#include "trace.h"
+
+#include <imgui.h>
+
+#include <string>
+#include <utility>
+
+struct Mirror : BasicGame
+{
+    // The players' devices follow the system language.
+    StringTable strings = BuiltinStrings(PreferredBuiltinLanguage());
+
+    std::string host;
+    std::uint16_t port = 0;
+
+    ReplicationClient client;
+
+    PublicView view;
+    bool have_view = false;
+
+    Mirror(std::string new_host, std::uint16_t new_port)
+        : host(std::move(new_host)), port(new_port),
+        client(host, port, []{
+            // Wake up the main loop, it sleeps while there's no input. This starts before `SDL_Init()`, see `EnableMainLoopWakeUps()`.
+            WakeUpMainLoop();
+        })
+    {}
+
+    void Tick() override
+    {
+        TRACE_ZONE("Tick");
+
+        if (client.TakeView(view))
+            have_view = true;
+
+        ImGui::SetNextWindowPos(ImVec2{});
+        ImGui::SetNextWindowSize(ImGui::GetIO().DisplaySize);
+        ImGui::Begin("Mirror", nullptr, ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoTitleBar);
+
+        if (!have_view)
+        {
+            ImGui::TextDisabled(strings[StringId::mirror_connecting], host.c_str(), int(port));
+            ImGui::End();
+            return;
+        }
+
+        if (!client.IsConnected())
+            ImGui::TextDisabled("%s", strings[StringId::mirror_disconnected]);
+
+        { // Status.
+            if (view.phase == PublicPhase::roll_call)
+                ImGui::TextUnformatted(strings[StringId::choosing_roles]);
+            else
+                ImGui::Text("%s %i", view.phase == PublicPhase::day ? strings[StringId::day] : strings[StringId::night], view.day);
+
+            ImGui::Separator();
+        }
+
+        { // Faction summary.
+            for (std::size_t i = 0; i < view.faction_counts.size(); i++)
+            {
+                if (view.faction_counts[i] > 0)
+                    ImGui::Text("%s: %d", strings.FactionNamePlural(Faction(i)), view.faction_counts[i]);
+            }
+
+            ImGui::Separator();
+        }
+
+        { // Player list.
+            ImGui::TextDisabled("%s (%d)", strings[StringId::players], int(view.players.size()));
+            ImGui::BeginChild("player_list", ImGui::GetContentRegionAvail());
+
+            ImGuiListClipper clipper;
+            clipper.Begin(int(view.players.size()));
+            while (clipper.Step())
+            {
+                for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+                    ImGui::TextUnformatted(view.players[std::size_t(i)].c_str());
+            }
+
+            ImGui::EndChild();
+        }
+
+        ImGui::End();
+    }
+};
+
+std::unique_ptr<BasicGame> MakeMirror(std::string host, std::uint16_t port)
+{
+    return std::make_unique<Mirror>(std::move(host), port);
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "basic_game.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// A read-only display for the players: shows the public part of the game that the moderator's device publishes (see `replication.h`).
+// Reconnects automatically if the connection breaks.
+[[nodiscard]] std::unique_ptr<BasicGame> MakeMirror(std::string host, std::uint16_t port);
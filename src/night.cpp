@@ -0,0 +1,152 @@
+#include "night.h"
+
+#include "trace.h"
+
+const NightOutcome &NightResolver::Update(const Day &day, const Settings &settings)
+{
+    const PlayerTable &players = day.players;
+    const std::size_t num_players = players.Size();
+
+    bool changed = !have_outcome || role_order != settings.role_order;
+
+    const bool ids_changed = !have_outcome || !(ids == players.ids);
+    if (ids_changed)
+    {
+        TRACE_ZONE("Night: ids");
+        ids = players.ids;
+        indices_by_id.clear();
+        for (std::size_t i = 0; i < num_players; i++)
+            indices_by_id.emplace(ids[i], i);
+    }
+
+    if (ids_changed || !(roles == players.roles))
+    {
+        TRACE_ZONE("Night: roles");
+        roles = players.roles;
+        for (PlayerSet &set : players_by_role)
+            set.Reset(num_players);
+        for (std::size_t i = 0; i < num_players; i++)
+            players_by_role[std::size_t(roles[i])].Insert(i);
+
+        mafia_players = players_by_role[std::size_t(Role::mafia)];
+        mafia_players |= players_by_role[std::size_t(Role::mafia_boss)];
+        changed = true;
+    }
+
+    for (std::size_t i = 0; i < std::size_t(Role::_count); i++)
+    {
+        const std::vector<int> &day_targets = (*day.actions)[i].targets;
+        if (!ids_changed && day_targets == targets[i])
+            continue;
+
+        targets[i] = day_targets;
+        targets_by_role[i].Reset(num_players);
+        for (int id : day_targets)
+        {
+            auto it = indices_by_id.find(id);
+            if (it != indices_by_id.end())
+                targets_by_role[i].Insert(it->second);
+        }
+        changed = true;
+    }
+
+    if (changed)
+    {
+        role_order = settings.role_order;
+        have_outcome = true;
+        Resolve(num_players);
+    }
+
+    return outcome;
+}
+
+void NightResolver::Resolve(std::size_t num_players)
+{
+    TRACE_ZONE("Night: resolve");
+
+    outcome.blocked_roles = 0;
+    outcome.killed.Reset(num_players);
+    outcome.executed.Reset(num_players);
+    outcome.protected_players.Reset(num_players);
+    outcome.sheriff_checked.Reset(num_players);
+    outcome.sheriff_found.Reset(num_players);
+    outcome.boss_checked.Reset(num_players);
+    outcome.boss_found.Reset(num_players);
+    for (PlayerSet &set : outcome.effective_targets)
+        set.Reset(num_players);
+
+    std::array<int, int(Role::_count)> turns_by_role{};
+    for (std::size_t i = 0; i < role_order.size(); i++)
+        turns_by_role[std::size_t(role_order[i])] = int(i);
+
+    for (std::size_t turn = 0; turn < role_order.size(); turn++)
+    {
+        const Role role = role_order[turn];
+        const std::size_t r = std::size_t(role);
+
+        // The mafia kill is the combined ability of the mafia and the boss. The other roles only act if someone has them.
+        const bool can_act = role == Role::mafia ? !mafia_players.IsEmpty() : role == Role::none || !players_by_role[r].IsEmpty();
+        if (!can_act || outcome.blocked_roles & (1u << r))
+            continue;
+
+        const PlayerSet &role_targets = targets_by_role[r];
+        outcome.effective_targets[r] = role_targets;
+
+        switch (role)
+        {
+            case Role::captain:
+                {
+                    // Only the night abilities, and only of the roles that haven't acted yet.
+                    unsigned blocked = 0;
+                    for (std::size_t i = 0; i < std::size_t(Role::none); i++)
+                    {
+                        if (role_targets.Intersects(players_by_role[i]))
+                            blocked |= 1u << i;
+                    }
+                    if (role_targets.Intersects(mafia_players))
+                        blocked |= 1u << int(Role::mafia);
+
+                    for (std::size_t i = 0; i < std::size_t(Role::_count); i++)
+                    {
+                        if (blocked & (1u << i) && std::size_t(turns_by_role[i]) > turn)
+                            outcome.blocked_roles |= 1u << i;
+                    }
+                }
+                break;
+            case Role::sheriff:
+                outcome.sheriff_checked |= role_targets;
+                scratch = role_targets;
+                scratch &= mafia_players.IsEmpty() ? players_by_role[std::size_t(Role::killer)] : mafia_players;
+                outcome.sheriff_found |= scratch;
+                break;
+            case Role::prostitute:
+                outcome.protected_players |= role_targets;
+                break;
+            case Role::mafia_boss:
+                outcome.boss_checked |= role_targets;
+                scratch = role_targets;
+                scratch &= players_by_role[std::size_t(Role::sheriff)];
+                outcome.boss_found |= scratch;
+                break;
+            case Role::mafia:
+            case Role::yakuza:
+            case Role::killer:
+                outcome.killed |= role_targets;
+                break;
+            case Role::none:
+                scratch = role_targets;
+                scratch.Subtract(outcome.protected_players);
+                scratch.Subtract(outcome.killed);
+                outcome.executed |= scratch;
+                break;
+            case Role::_count:
+                break;
+        }
+    }
+}
+
+NightOutcome ResolveNight(const Day &day, const Settings &settings)
+{
+    NightResolver resolver;
+    return resolver.Update(day, settings);
+}
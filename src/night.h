@@ -0,0 +1,152 @@
+#pragma once
+
+#include "cow.h"
+#include "state.h"
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// A set of player indices (positions in a `PlayerTable`), as a bitset.
+class PlayerSet
+{
+    std::vector<std::uint64_t> words;
+
+  public:
+    // Empties the set, and makes it fit this many players. Keeps the memory.
+    void Reset(std::size_t num_players)
+    {
+        words.assign((num_players + 63) / 64, 0);
+    }
+
+    void Insert(std::size_t i)
+    {
+        words[i / 64] |= std::uint64_t(1) << (i % 64);
+    }
+
+    // The index can be out of range, then this returns false.
+    [[nodiscard]] bool Contains(std::size_t i) const
+    {
+        return i / 64 < words.size() && words[i / 64] & (std::uint64_t(1) << (i % 64));
+    }
+
+    [[nodiscard]] bool IsEmpty() const
+    {
+        for (std::uint64_t word : words)
+        {
+            if (word)
+                return false;
+        }
+        return true;
+    }
+
+    [[nodiscard]] bool Intersects(const PlayerSet &other) const
+    {
+        for (std::size_t i = 0; i < words.size() && i < other.words.size(); i++)
+        {
+            if (words[i] & other.words[i])
+                return true;
+        }
+        return false;
+    }
+
+    // Those expect the sets to be sized for the same number of players.
+    PlayerSet &operator|=(const PlayerSet &other)
+    {
+        for (std::size_t i = 0; i < words.size(); i++)
+            words[i] |= other.words[i];
+        return *this;
+    }
+    PlayerSet &operator&=(const PlayerSet &other)
+    {
+        for (std::size_t i = 0; i < words.size(); i++)
+            words[i] &= other.words[i];
+        return *this;
+    }
+    // Removes the players that are in `other`.
+    void Subtract(const PlayerSet &other)
+    {
+        for (std::size_t i = 0; i < words.size(); i++)
+            words[i] &= ~other.words[i];
+    }
+
+    // Calls `func(index)` for each player in the set, in order.
+    template <typename F>
+    void ForEach(F &&func) const
+    {
+        for (std::size_t i = 0; i < words.size(); i++)
+        {
+            for (std::uint64_t word = words[i]; word; word &= word - 1)
+                func(i * 64 + std::size_t(std::countr_zero(word)));
+        }
+    }
+};
+
+// What happened during one day, according to the role rules (see the comments on `Role`).
+// The actions are resolved in the turn order from `Settings::role_order`, and each action only affects the turns after it:
+//   a block only applies to the roles that act later, a protection only applies to a vote that comes later, and so on.
+// The deaths don't stop the victims from acting in the same day.
+struct NightOutcome
+{
+    // Bit N is `Role(N)`. A blocked role's action has no effect.
+    unsigned blocked_roles = 0;
+
+    PlayerSet killed; // At night, by the mafia, the yakuza or the killer.
+    PlayerSet executed; // By the town vote. Doesn't include the players who were already killed.
+    PlayerSet protected_players; // By the prostitute, from the town vote.
+
+    PlayerSet sheriff_checked;
+    PlayerSet sheriff_found; // The checked players who turned out to be mafia (or the killer, if there's no mafia).
+    PlayerSet boss_checked;
+    PlayerSet boss_found; // The checked players who turned out to be the sheriff.
+
+    // The targets of each role's action, if it wasn't blocked. Those go to the `times_targeted_by_...` counters.
+    std::array<PlayerSet, int(Role::_count)> effective_targets;
+};
+
+// Resolves the actions of a day, and keeps the outcome up to date as they change.
+// Call `Update()` every frame: it only redoes the parts whose inputs have changed, and if nothing changed, it costs about as much as
+//   comparing the shared chunks of two columns. When a single action changes, only that role's targets are re-read,
+//   and the rest is a few bitwise operations per role over the player bitsets.
+class NightResolver
+{
+    // The inputs of the last update. The columns are copied cheaply, and compared cheaply while they're still shared with the day.
+    CowColumn<int> ids;
+    CowColumn<Role> roles;
+    std::array<std::vector<int>, int(Role::_count)> targets;
+    std::array<Role, int(Role::_count)> role_order{};
+    bool have_outcome = false;
+
+    // Computed from the inputs above.
+    std::unordered_map<int, std::size_t> indices_by_id;
+    std::array<PlayerSet, int(Role::_count)> players_by_role;
+    std::array<PlayerSet, int(Role::_count)> targets_by_role;
+    PlayerSet mafia_players; // The mafia faction, including the boss.
+    PlayerSet scratch;
+
+    NightOutcome outcome;
+
+    // Recomputes `outcome` from the sets above.
+    void Resolve(std::size_t num_players);
+
+  public:
+    // The targets are player ids (`Player::id`), the ones that aren't in the day are ignored.
+    const NightOutcome &Update(const Day &day, const Settings &settings);
+
+    [[nodiscard]] const NightOutcome &Outcome() const
+    {
+        return outcome;
+    }
+
+    // All targets of the role's action as of the last update, including the blocked ones.
+    [[nodiscard]] const PlayerSet &Targets(Role role) const
+    {
+        return targets_by_role[std::size_t(role)];
+    }
+};
+
+// Resolves a day once, without keeping any state.
+[[nodiscard]] NightOutcome ResolveNight(const Day &day, const Settings &settings);
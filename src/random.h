@@ -0,0 +1,47 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+
+// A fast random generator for the simulations, xoshiro256**. Much faster than `std::mt19937_64`, and its state is 4 words.
+class Rng
+{
+    std::array<std::uint64_t, 4> s{};
+
+    static std::uint64_t SplitMix64(std::uint64_t &state)
+    {
+        std::uint64_t z = (state += 0x9e3779b97f4a7c15);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        return z ^ (z >> 31);
+    }
+
+  public:
+    // The generators with different `stream_index`es (and the same seed) are independent, for use on different threads or chunks of work.
+    Rng(std::uint64_t seed, std::uint64_t stream_index)
+    {
+        std::uint64_t state = seed ^ (stream_index * 0xd1342543de82ef95);
+        for (std::uint64_t &x : s)
+            x = SplitMix64(state);
+    }
+
+    std::uint64_t Next()
+    {
+        const std::uint64_t ret = std::rotl(s[1] * 5, 7) * 9;
+        const std::uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = std::rotl(s[3], 45);
+        return ret;
+    }
+
+    // Returns a number in `[0, n)`. The bias of the multiply-shift method is negligible for small `n`.
+    std::uint32_t Below(std::uint32_t n)
+    {
+        return std::uint32_t(((Next() >> 32) * n) >> 32);
+    }
+};
@@ -0,0 +1,336 @@
+#include "rating.h"
+
+#include "trace.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <barrier>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+// Rate the games in parallel only if the waves are at least this large on average. Otherwise syncing the threads costs more than rating the games.
+static constexpr std::size_t min_average_wave_size = 256;
+
+// Updates the ratings of the players of one game.
+// Only touches the ratings of those players, so games with no players in common can be rated in parallel.
+static void RateGame(std::span<const Ratings::Row> rows, int winner, std::span<double> ratings, std::span<int> num_games)
+{
+    if (winner < 0 || winner >= int(Faction::_count))
+        return;
+
+    std::array<double, int(Faction::_count)> faction_averages{};
+    std::array<int, int(Faction::_count)> faction_sizes{};
+    for (const Ratings::Row &row : rows)
+    {
+        faction_averages[std::size_t(row.faction)] += ratings[std::size_t(row.player)];
+        faction_sizes[std::size_t(row.faction)]++;
+    }
+
+    int num_factions = 0;
+    double max_average = -std::numeric_limits<double>::infinity();
+    for (std::size_t i = 0; i < std::size_t(Faction::_count); i++)
+    {
+        if (faction_sizes[i] == 0)
+            continue;
+        num_factions++;
+        faction_averages[i] /= faction_sizes[i];
+        max_average = std::max(max_average, faction_averages[i]);
+    }
+    if (num_factions < 2)
+        return;
+
+    // The expected scores of the factions add up to 1. With two factions, this is the usual Elo formula.
+    // Relative to the strongest faction, to avoid overflowing.
+    std::array<double, int(Faction::_count)> strengths{};
+    double total_strength = 0;
+    for (std::size_t i = 0; i < std::size_t(Faction::_count); i++)
+    {
+        if (faction_sizes[i] == 0)
+            continue;
+        strengths[i] = std::pow(10.0, (faction_averages[i] - max_average) / 400);
+        total_strength += strengths[i];
+    }
+
+    // The change of a faction is split between its members, so that the total of all changes is zero, and the large peaceful faction doesn't inflate the ratings.
+    // It's scaled so that in a game of equal factions each player moves by up to `k_factor`.
+    std::array<double, int(Faction::_count)> deltas{};
+    const double average_faction_size = double(rows.size()) / num_factions;
+    for (std::size_t i = 0; i < std::size_t(Faction::_count); i++)
+    {
+        if (faction_sizes[i] == 0)
+            continue;
+        const double expected_score = strengths[i] / total_strength;
+        deltas[i] = Ratings::k_factor * ((int(i) == winner ? 1 : 0) - expected_score) * average_faction_size / faction_sizes[i];
+    }
+
+    for (const Ratings::Row &row : rows)
+    {
+        ratings[std::size_t(row.player)] += deltas[std::size_t(row.faction)];
+        num_games[std::size_t(row.player)]++;
+    }
+}
+
+NameId Ratings::AddPlayer(std::string_view name)
+{
+    const NameId ret = players.Intern(name);
+    if (std::size_t(ret) == ratings.size())
+    {
+        ratings.push_back(initial_rating);
+        num_games.push_back(0);
+    }
+    return ret;
+}
+
+void Ratings::AddGame(const ArchivedGame &game)
+{
+    if (game.winner < 0 || game.winner >= int(Faction::_count))
+        return;
+
+    rows_scratch.clear();
+    for (const ArchivedPlayer &pl : game.players)
+        rows_scratch.push_back({.player = AddPlayer(pl.name), .faction = RoleToFaction(pl.role)});
+
+    AddGame(rows_scratch, game.winner);
+}
+
+void Ratings::AddGame(std::span<const Row> rows, int winner)
+{
+    RateGame(rows, winner, ratings, num_games);
+}
+
+// The games of one archive block, with only the columns that the ratings need.
+struct RatedBlock
+{
+    struct Row
+    {
+        std::uint32_t name = 0; // An index into `names`.
+        Faction faction{};
+    };
+
+    std::vector<std::string> names;
+    std::vector<Row> rows;
+    // Per game. `Faction::_count` for games that don't match the query or have no winner.
+    std::vector<int> winners;
+    std::vector<std::uint32_t> num_rows;
+};
+
+// The decoded columns of a block, reused between blocks.
+struct RatedBlockColumns
+{
+    std::vector<std::int64_t> times;
+    std::vector<std::int64_t> num_players;
+    std::vector<std::int64_t> winners;
+    std::vector<std::int64_t> num_rows;
+    std::vector<std::int64_t> names;
+    std::vector<std::int64_t> roles;
+};
+
+static void DecodeRatedBlock(const Archive::Block &block, const ArchiveQuery &query, RatedBlockColumns &columns, RatedBlock &out)
+{
+    auto Column = [&](ArchiveColumn column){return block.columns[std::size_t(column)];};
+
+    DecodeArchiveInts(Column(ArchiveColumn::game_time), block.num_games, columns.times);
+    DecodeArchiveInts(Column(ArchiveColumn::game_num_players), block.num_games, columns.num_players);
+    DecodeArchiveInts(Column(ArchiveColumn::game_winner), block.num_games, columns.winners);
+    DecodeArchiveInts(Column(ArchiveColumn::game_num_rows), block.num_games, columns.num_rows);
+    DecodeArchiveStrings(Column(ArchiveColumn::player_name), block.num_rows, out.names, columns.names);
+    DecodeArchiveInts(Column(ArchiveColumn::player_role), block.num_rows, columns.roles);
+
+    std::uint64_t total_rows = 0;
+    out.winners.resize(block.num_games);
+    out.num_rows.resize(block.num_games);
+    for (std::size_t i = 0; i < block.num_games; i++)
+    {
+        if (columns.num_rows[i] < 0 || std::uint64_t(columns.num_rows[i]) > block.num_rows)
+            throw std::runtime_error("Invalid row count in the archive.");
+        if (columns.winners[i] < 0 || columns.winners[i] > int(Faction::_count))
+            throw std::runtime_error("Invalid winner in the archive.");
+
+        total_rows += std::uint64_t(columns.num_rows[i]);
+        out.num_rows[i] = std::uint32_t(columns.num_rows[i]);
+
+        const bool matches =
+            columns.num_players[i] >= query.min_players && columns.num_players[i] <= query.max_players &&
+            columns.times[i] >= query.min_time && columns.times[i] <= query.max_time;
+        out.winners[i] = matches ? int(columns.winners[i]) : int(Faction::_count);
+    }
+    if (total_rows != block.num_rows)
+        throw std::runtime_error("Mismatched row counts in the archive.");
+
+    out.rows.resize(block.num_rows);
+    for (std::size_t i = 0; i < block.num_rows; i++)
+    {
+        if (columns.roles[i] < 0 || columns.roles[i] >= int(Role::_count))
+            throw std::runtime_error("Invalid role in the archive.");
+        out.rows[i] = {.name = std::uint32_t(columns.names[i]), .faction = RoleToFaction(Role(columns.roles[i]))};
+    }
+}
+
+Ratings Ratings::Compute(const Archive &archive, const ArchiveQuery &query, int num_threads)
+{
+    TRACE_ZONE("Ratings::Compute");
+
+    const std::vector<Archive::Block> &blocks = archive.Blocks();
+
+    if (num_threads <= 0)
+        num_threads = int(std::max(1u, std::thread::hardware_concurrency()));
+    num_threads = std::max(1, num_threads);
+    const std::size_t thread_count = std::size_t(num_threads);
+
+    auto RunThreads = [&](auto &&func)
+    {
+        if (thread_count == 1)
+        {
+            func(0zu);
+            return;
+        }
+
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0; i < thread_count; i++)
+            threads.emplace_back(func, i);
+        for (std::thread &thread : threads)
+            thread.join();
+    };
+
+    // Decode the blocks in parallel.
+    std::vector<RatedBlock> rated_blocks(blocks.size());
+    {
+        TRACE_ZONE("Decode");
+
+        std::vector<std::exception_ptr> errors(thread_count);
+        std::atomic<std::size_t> next_block = 0;
+
+        RunThreads([&](std::size_t thread_index)
+        {
+            try
+            {
+                RatedBlockColumns columns;
+                std::size_t i;
+                while ((i = next_block.fetch_add(1, std::memory_order_relaxed)) < blocks.size())
+                    DecodeRatedBlock(blocks[i], query, columns, rated_blocks[i]);
+            }
+            catch (...)
+            {
+                errors[thread_index] = std::current_exception();
+            }
+        });
+
+        for (const std::exception_ptr &error : errors)
+        {
+            if (error)
+                std::rethrow_exception(error);
+        }
+    }
+
+    Ratings ret;
+
+    // The games with a winner, in the archive order.
+    std::vector<Row> rows;
+    std::vector<std::size_t> game_row_begins;
+    std::vector<int> game_winners;
+    // Each game goes to the wave after the last wave of any of its players.
+    // So the games in one wave have no players in common, and each player's games stay in order.
+    std::vector<int> game_waves;
+    std::vector<int> last_wave_of_player;
+    int num_waves = 0;
+
+    {
+        TRACE_ZONE("Schedule");
+
+        // Add the players in the same order as `AddGame()` would, so that the `NameId`s match too.
+        std::vector<NameId> players_by_block_name;
+        for (RatedBlock &block : rated_blocks)
+        {
+            players_by_block_name.assign(block.names.size(), NameId(-1));
+
+            std::size_t row_begin = 0;
+            for (std::size_t i = 0; i < block.winners.size(); i++)
+            {
+                const std::size_t row_end = row_begin + block.num_rows[i];
+                if (block.winners[i] == int(Faction::_count))
+                {
+                    row_begin = row_end;
+                    continue;
+                }
+
+                game_row_begins.push_back(rows.size());
+                game_winners.push_back(block.winners[i]);
+
+                int wave = 0;
+                for (std::size_t j = row_begin; j < row_end; j++)
+                {
+                    NameId &player = players_by_block_name[block.rows[j].name];
+                    if (player == NameId(-1))
+                    {
+                        player = ret.AddPlayer(block.names[block.rows[j].name]);
+                        last_wave_of_player.resize(ret.NumPlayers(), -1);
+                    }
+
+                    rows.push_back({.player = player, .faction = block.rows[j].faction});
+                    wave = std::max(wave, last_wave_of_player[std::size_t(player)] + 1);
+                }
+                for (std::size_t j = game_row_begins.back(); j < rows.size(); j++)
+                    last_wave_of_player[std::size_t(rows[j].player)] = wave;
+
+                game_waves.push_back(wave);
+                num_waves = std::max(num_waves, wave + 1);
+
+                row_begin = row_end;
+            }
+
+            // Free the memory as we go.
+            block = {};
+        }
+        game_row_begins.push_back(rows.size());
+    }
+
+    const std::size_t num_games = game_winners.size();
+    auto RateGameAt = [&](std::size_t i)
+    {
+        RateGame(std::span(rows).subspan(game_row_begins[i], game_row_begins[i + 1] - game_row_begins[i]), game_winners[i], ret.ratings, ret.num_games);
+    };
+
+    TRACE_ZONE("Rate");
+
+    if (thread_count == 1 || num_games < std::size_t(num_waves) * min_average_wave_size)
+    {
+        for (std::size_t i = 0; i < num_games; i++)
+            RateGameAt(i);
+        return ret;
+    }
+
+    // Sort the games by wave.
+    std::vector<std::size_t> wave_begins(std::size_t(num_waves) + 1);
+    for (int wave : game_waves)
+        wave_begins[std::size_t(wave) + 1]++;
+    for (std::size_t i = 1; i < wave_begins.size(); i++)
+        wave_begins[i] += wave_begins[i - 1];
+    std::vector<std::size_t> games_by_wave(num_games);
+    {
+        std::vector<std::size_t> wave_ends(wave_begins.begin(), wave_begins.end() - 1);
+        for (std::size_t i = 0; i < num_games; i++)
+            games_by_wave[wave_ends[std::size_t(game_waves[i])]++] = i;
+    }
+
+    // Each thread rates its share of every wave, then waits for the others before the next wave.
+    std::barrier wave_barrier(num_threads);
+    RunThreads([&](std::size_t thread_index)
+    {
+        for (std::size_t wave = 0; wave < std::size_t(num_waves); wave++)
+        {
+            const std::size_t size = wave_begins[wave + 1] - wave_begins[wave];
+            const std::size_t begin = wave_begins[wave] + size * thread_index / thread_count;
+            const std::size_t end = wave_begins[wave] + size * (thread_index + 1) / thread_count;
+            for (std::size_t i = begin; i < end; i++)
+                RateGameAt(games_by_wave[i]);
+            wave_barrier.arrive_and_wait();
+        }
+    });
+
+    return ret;
+}
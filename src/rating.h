@@ -0,0 +1,83 @@
+#pragma once
+
+#include "archive.h"
+#include "state.h"
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Elo-style ratings of the club's players, computed from the archived games (see `archive.h`).
+//
+// A player is identified by their name, since that's what carries over between sessions (`Player::id` is only unique within a session).
+// Each faction plays as a team, with the average rating of its members. The factions' expected scores add up to 1,
+//   and each faction's change is split evenly between its members, so the total of all ratings stays the same.
+// Games without a winner, or with only one faction, don't change the ratings.
+class Ratings
+{
+  public:
+    static constexpr double initial_rating = 1500;
+    // The maximum change per game, for a player in a game of equally sized factions.
+    static constexpr double k_factor = 32;
+
+    // One player of a game, as the ratings see it.
+    struct Row
+    {
+        NameId player{};
+        Faction faction{};
+    };
+
+  private:
+    // The player identities. The `NameId`s from here index the columns below.
+    NamePool players;
+    std::vector<double> ratings;
+    std::vector<int> num_games;
+
+    // Reused between games, to avoid heap allocations.
+    std::vector<Row> rows_scratch;
+
+  public:
+    // Recomputes the ratings from scratch from the archived games that match the query, in the order they were archived.
+    // Decodes the archive on `num_threads` threads (all cores if 0). Games with no players in common are then rated in parallel,
+    //   in waves, so the result is exactly the same as adding the games one by one. Throws on invalid data.
+    [[nodiscard]] static Ratings Compute(const Archive &archive, const ArchiveQuery &query, int num_threads = 0);
+
+    // Returns the player, adding them with the initial rating if needed.
+    NameId AddPlayer(std::string_view name);
+
+    // Updates the ratings of the players of this game. O(number of players).
+    void AddGame(const ArchivedGame &game);
+
+    // Same, but with the players already added. `winner` is a `Faction`, or `Faction::_count` if there's none.
+    void AddGame(std::span<const Row> rows, int winner);
+
+    // Returns null if the player is unknown.
+    [[nodiscard]] std::optional<NameId> Find(std::string_view name) const
+    {
+        return players.Find(name);
+    }
+
+    [[nodiscard]] std::size_t NumPlayers() const
+    {
+        return ratings.size();
+    }
+
+    [[nodiscard]] const std::string &Name(NameId player) const
+    {
+        return players[player];
+    }
+
+    [[nodiscard]] double Rating(NameId player) const
+    {
+        return ratings[std::size_t(player)];
+    }
+
+    // The number of rated games that the player took part in.
+    [[nodiscard]] int NumGames(NameId player) const
+    {
+        return num_games[std::size_t(player)];
+    }
+};
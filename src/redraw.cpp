@@ -0,0 +1,77 @@
+#include "redraw.h"
+
+#include <SDL3/SDL_events.h>
+#include <SDL3/SDL_timer.h>
+
+#include <algorithm>
+#include <limits>
+
+static constexpr std::uint64_t no_request = std::numeric_limits<std::uint64_t>::max();
+
+// The earliest request made during the current frame.
+static std::uint64_t requested_time = no_request;
+// The time the timer is scheduled for.
+static std::uint64_t scheduled_time = no_request;
+static SDL_TimerID timer = 0;
+
+// The timer only needs to wake up the event loop, so any event will do.
+static Uint64 SDLCALL TimerCallback(void *userdata, SDL_TimerID timer_id, Uint64 interval)
+{
+    (void)userdata;
+    (void)timer_id;
+    (void)interval;
+
+    SDL_Event event{};
+    event.type = SDL_EVENT_USER;
+    SDL_PushEvent(&event);
+    return 0; // Don't repeat.
+}
+
+void RequestRedrawAt(std::uint64_t time_ns)
+{
+    requested_time = std::min(requested_time, time_ns);
+}
+
+void RequestRedrawIn(double seconds)
+{
+    RequestRedrawAt(SDL_GetTicksNS() + std::uint64_t(std::max(0.0, seconds) * 1e9));
+}
+
+void BeginRedrawRequests()
+{
+    requested_time = no_request;
+}
+
+void EndRedrawRequests()
+{
+    // Usually the same deadline is requested for many frames in a row, don't reschedule the timer every time.
+    if (requested_time == scheduled_time)
+        return;
+
+    if (timer)
+    {
+        SDL_RemoveTimer(timer);
+        timer = 0;
+    }
+
+    scheduled_time = requested_time;
+    if (scheduled_time == no_request)
+        return;
+
+    const std::uint64_t now = SDL_GetTicksNS();
+    timer = SDL_AddTimerNS(scheduled_time > now ? scheduled_time - now : 1, TimerCallback, nullptr);
+}
+
+bool RedrawDeadlinePassed()
+{
+    // Some tolerance, in case the timer wakes us up a bit early. Since it doesn't repeat, we'd otherwise sleep until the next input.
+    const std::uint64_t tolerance_ns = 2'000'000;
+    if (scheduled_time == no_request || SDL_GetTicksNS() + tolerance_ns < scheduled_time)
+        return false;
+
+    // The timer has already fired or is about to, and removing it is harmless either way.
+    SDL_RemoveTimer(timer);
+    timer = 0;
+    scheduled_time = no_request;
+    return true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+// When nothing changes on the screen, the app sleeps until an input event arrives. Use those to wake it up at a specific time
+//   (for animations, blinking cursors, timers, and so on).
+// A request only lasts until the next frame, so keep requesting every frame while you need it.
+
+// Requests a frame to be drawn at `time_ns` or soon after, on the `SDL_GetTicksNS()` clock.
+void RequestRedrawAt(std::uint64_t time_ns);
+// Same, but relative to the current time.
+void RequestRedrawIn(double seconds);
+
+// Those are for `main.cpp`: [
+
+// Call this at the beginning of each frame. Forgets the requests made during the previous frame.
+void BeginRedrawRequests();
+// Call this at the end of each frame. Schedules a wakeup for the earliest request made during this frame.
+void EndRedrawRequests();
+// Returns true if the time of the scheduled wakeup has come. Then the wakeup is cancelled, and a frame must be drawn.
+[[nodiscard]] bool RedrawDeadlinePassed();
+
+// ]
@@ -0,0 +1,455 @@
+#include "replication.h"
+
+#include "trace.h"
+
+#include <SDL3/SDL_log.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+enum class MessageKind
+{
+    keyframe,
+    delta,
+    _count [[maybe_unused]],
+};
+
+// The bits of the field mask at the beginning of a delta.
+enum class DeltaField
+{
+    day,
+    phase,
+    faction_counts,
+    players,
+};
+
+static constexpr std::size_t message_header_size = sizeof(std::uint32_t);
+
+// Reject larger messages as corrupted.
+static constexpr std::uint32_t max_message_size = 16 << 20;
+
+// A subscriber that falls this far behind is disconnected. It will reconnect and resync from a keyframe.
+static constexpr std::size_t max_subscriber_backlog = 1 << 20;
+
+// How often the server thread wakes up to accept new subscribers, or to continue sending when the subscribers are slow.
+static constexpr std::chrono::milliseconds idle_poll_interval{200};
+static constexpr std::chrono::milliseconds busy_poll_interval{5};
+
+// How often the client thread checks if it should stop, while waiting for the data.
+static constexpr int client_poll_interval_ms = 100;
+static constexpr std::chrono::milliseconds reconnect_delay{1000};
+
+void WritePublicViewKeyframe(BinaryWriter &writer, const PublicView &view)
+{
+    writer.WriteSignedVarint(view.day);
+    writer.WriteVarint(std::uint64_t(view.phase));
+    for (int count : view.faction_counts)
+        writer.WriteSignedVarint(count);
+    writer.WriteVarint(view.players.size());
+    for (const std::string &name : view.players)
+        writer.WriteString(name);
+}
+
+void WritePublicViewDelta(BinaryWriter &writer, const PublicView &from, const PublicView &to)
+{
+    unsigned fields = 0;
+    if (from.day != to.day)
+        fields |= 1u << int(DeltaField::day);
+    if (from.phase != to.phase)
+        fields |= 1u << int(DeltaField::phase);
+    if (from.faction_counts != to.faction_counts)
+        fields |= 1u << int(DeltaField::faction_counts);
+    if (from.players != to.players)
+        fields |= 1u << int(DeltaField::players);
+    writer.WriteVarint(fields);
+
+    if (fields & (1u << int(DeltaField::day)))
+        writer.WriteSignedVarint(std::int64_t(to.day) - from.day);
+
+    if (fields & (1u << int(DeltaField::phase)))
+        writer.WriteVarint(std::uint64_t(to.phase));
+
+    if (fields & (1u << int(DeltaField::faction_counts)))
+    {
+        unsigned changed = 0;
+        for (std::size_t i = 0; i < to.faction_counts.size(); i++)
+        {
+            if (from.faction_counts[i] != to.faction_counts[i])
+                changed |= 1u << i;
+        }
+        writer.WriteVarint(changed);
+        for (std::size_t i = 0; i < to.faction_counts.size(); i++)
+        {
+            if (changed & (1u << i))
+                writer.WriteSignedVarint(to.faction_counts[i]);
+        }
+    }
+
+    if (fields & (1u << int(DeltaField::players)))
+    {
+        // Find the range that changed, and send it as a replacement for the old range.
+        const std::size_t min_size = std::min(from.players.size(), to.players.size());
+        std::size_t prefix = 0;
+        while (prefix < min_size && from.players[prefix] == to.players[prefix])
+            prefix++;
+        std::size_t suffix = 0;
+        while (prefix + suffix < min_size && from.players[from.players.size() - 1 - suffix] == to.players[to.players.size() - 1 - suffix])
+            suffix++;
+
+        writer.WriteVarint(prefix);
+        writer.WriteVarint(from.players.size() - prefix - suffix);
+        writer.WriteVarint(to.players.size() - prefix - suffix);
+        for (std::size_t i = prefix; i < to.players.size() - suffix; i++)
+            writer.WriteString(to.players[i]);
+    }
+}
+
+void ReadPublicViewKeyframe(BinaryReader &reader, PublicView &view)
+{
+    view.day = int(reader.ReadSignedVarint());
+    view.phase = PublicPhase(reader.ReadIndex(std::size_t(PublicPhase::_count)));
+    for (int &count : view.faction_counts)
+        count = int(reader.ReadSignedVarint());
+    // Not resizing upfront, so that a corrupted size can't make us allocate too much.
+    view.players.clear();
+    const std::size_t num_players = reader.ReadIndex(max_message_size);
+    for (std::size_t i = 0; i < num_players; i++)
+        view.players.push_back(reader.ReadString());
+}
+
+void ApplyPublicViewDelta(BinaryReader &reader, PublicView &view)
+{
+    const std::uint64_t fields = reader.ReadVarint();
+
+    if (fields & (1u << int(DeltaField::day)))
+        view.day = int(view.day + reader.ReadSignedVarint());
+
+    if (fields & (1u << int(DeltaField::phase)))
+        view.phase = PublicPhase(reader.ReadIndex(std::size_t(PublicPhase::_count)));
+
+    if (fields & (1u << int(DeltaField::faction_counts)))
+    {
+        const std::uint64_t changed = reader.ReadVarint();
+        for (std::size_t i = 0; i < view.faction_counts.size(); i++)
+        {
+            if (changed & (1u << i))
+                view.faction_counts[i] = int(reader.ReadSignedVarint());
+        }
+    }
+
+    if (fields & (1u << int(DeltaField::players)))
+    {
+        const std::size_t prefix = reader.ReadIndex(view.players.size() + 1);
+        const std::size_t num_removed = reader.ReadIndex(view.players.size() - prefix + 1);
+        const std::size_t num_inserted = reader.ReadIndex(max_message_size);
+        std::vector<std::string> inserted;
+        for (std::size_t i = 0; i < num_inserted; i++)
+            inserted.push_back(reader.ReadString());
+
+        const auto pos = view.players.erase(view.players.begin() + std::ptrdiff_t(prefix), view.players.begin() + std::ptrdiff_t(prefix + num_removed));
+        view.players.insert(pos, std::make_move_iterator(inserted.begin()), std::make_move_iterator(inserted.end()));
+    }
+}
+
+ReplicationServer::ReplicationServer(std::uint16_t port)
+    : listener(Socket::Listen(port))
+{
+    thread = std::thread([this]{ThreadFunc();});
+}
+
+ReplicationServer::~ReplicationServer()
+{
+    {
+        std::lock_guard lock(mutex);
+        stop = true;
+    }
+    cond.notify_one();
+    thread.join();
+}
+
+void ReplicationServer::Publish(const PublicView &view)
+{
+    if (next_sequence > 0 && view == published_view)
+        return;
+
+    TRACE_ZONE("Publish");
+
+    const MessageKind kind = next_sequence % keyframe_interval == 0 ? MessageKind::keyframe : MessageKind::delta;
+
+    writer.Clear();
+    writer.Write<std::uint32_t>(0); // The size, filled below.
+    writer.WriteVarint(std::uint64_t(kind));
+    writer.WriteVarint(next_sequence);
+    if (kind == MessageKind::keyframe)
+        WritePublicViewKeyframe(writer, view);
+    else
+        WritePublicViewDelta(writer, published_view, view);
+
+    const std::uint32_t size = std::uint32_t(writer.Data().size() - message_header_size);
+    std::memcpy(writer.Data().data(), &size, sizeof size);
+
+    next_sequence++;
+    published_view = view;
+    bytes_published.fetch_add(writer.Data().size(), std::memory_order_relaxed);
+
+    {
+        std::lock_guard lock(mutex);
+        pending_messages.insert(pending_messages.end(), writer.Data().begin(), writer.Data().end());
+    }
+    cond.notify_one();
+}
+
+void ReplicationServer::ThreadFunc()
+{
+    TRACE_THREAD_NAME("Replication server");
+
+    struct Subscriber
+    {
+        Socket socket;
+        // The data to send. Everything before `sent` was already sent.
+        std::vector<unsigned char> queue;
+        std::size_t sent = 0;
+    };
+
+    std::vector<Subscriber> subscribers;
+    std::vector<unsigned char> messages;
+    // The latest keyframe and the deltas after it. This is what the new subscribers get first.
+    std::vector<unsigned char> history;
+
+    std::unique_lock lock(mutex);
+
+    while (true)
+    {
+        const bool have_unsent = std::ranges::any_of(subscribers, [](const Subscriber &sub){return sub.sent < sub.queue.size();});
+        cond.wait_for(lock, have_unsent ? busy_poll_interval : idle_poll_interval, [&]{return stop || !pending_messages.empty();});
+        if (stop)
+            break;
+
+        messages.clear();
+        messages.swap(pending_messages);
+
+        lock.unlock();
+
+        // Update the history. A keyframe makes everything before it unnecessary.
+        for (std::size_t pos = 0; pos < messages.size();)
+        {
+            std::uint32_t size = 0;
+            std::memcpy(&size, messages.data() + pos, sizeof size);
+            const std::size_t end = pos + message_header_size + size;
+            // The kind is a varint, but it's always a single byte.
+            if (MessageKind(messages[pos + message_header_size]) == MessageKind::keyframe)
+                history.clear();
+            history.insert(history.end(), messages.begin() + std::ptrdiff_t(pos), messages.begin() + std::ptrdiff_t(end));
+            pos = end;
+        }
+
+        for (Subscriber &sub : subscribers)
+            sub.queue.insert(sub.queue.end(), messages.begin(), messages.end());
+
+        // Accept the new subscribers. They start from the latest keyframe.
+        while (true)
+        {
+            Socket socket = listener.Accept();
+            if (!socket.IsValid())
+                break;
+            subscribers.push_back({.socket = std::move(socket), .queue = history});
+        }
+
+        // Send what we can, and drop the subscribers that disconnected or can't keep up.
+        std::erase_if(subscribers, [&](Subscriber &sub)
+        {
+            // The subscribers never send anything, so this only tells us if the connection was closed.
+            unsigned char discarded[64];
+            if (sub.socket.Receive(discarded) < 0)
+                return true;
+
+            if (sub.sent == sub.queue.size())
+                return false;
+
+            const std::ptrdiff_t result = sub.socket.Send(std::span(sub.queue).subspan(sub.sent));
+            if (result < 0)
+                return true;
+            sub.sent += std::size_t(result);
+            bytes_sent.fetch_add(std::size_t(result), std::memory_order_relaxed);
+
+            if (sub.sent == sub.queue.size())
+            {
+                sub.queue.clear();
+                sub.sent = 0;
+            }
+            else if (sub.queue.size() - sub.sent > max_subscriber_backlog)
+            {
+                SDL_Log("A replication subscriber can't keep up, disconnecting it.");
+                return true;
+            }
+            else if (sub.sent >= sub.queue.size() / 2)
+            {
+                sub.queue.erase(sub.queue.begin(), sub.queue.begin() + std::ptrdiff_t(sub.sent));
+                sub.sent = 0;
+            }
+            return false;
+        });
+
+        num_subscribers.store(int(subscribers.size()), std::memory_order_relaxed);
+
+        lock.lock();
+    }
+}
+
+ReplicationClient::ReplicationClient(std::string host, std::uint16_t port, std::function<void()> on_change)
+    : host(std::move(host)), port(port), on_change(std::move(on_change))
+{
+    thread = std::thread([this]{ThreadFunc();});
+}
+
+ReplicationClient::~ReplicationClient()
+{
+    {
+        std::lock_guard lock(mutex);
+        stop = true;
+    }
+    stop_cond.notify_one();
+    thread.join();
+}
+
+bool ReplicationClient::TakeView(PublicView &view)
+{
+    std::lock_guard lock(mutex);
+    if (!view_changed)
+        return false;
+    view_changed = false;
+    view = latest_view;
+    return true;
+}
+
+void ReplicationClient::RunConnection(const Socket &socket)
+{
+    PublicView view;
+    bool have_keyframe = false;
+    std::uint64_t expected_sequence = 0;
+
+    std::vector<unsigned char> buffer(1 << 16);
+    std::size_t buffer_used = 0;
+
+    while (!stop)
+    {
+        if (!socket.Wait(false, client_poll_interval_ms))
+            continue;
+
+        if (buffer.size() - buffer_used < buffer.size() / 4)
+            buffer.resize(buffer.size() * 2);
+
+        const std::ptrdiff_t result = socket.Receive(std::span(buffer).subspan(buffer_used));
+        if (result < 0)
+            return; // Disconnected.
+        buffer_used += std::size_t(result);
+
+        // Apply all the complete messages.
+        bool changed = false;
+        std::size_t pos = 0;
+        while (buffer_used - pos >= message_header_size)
+        {
+            std::uint32_t size = 0;
+            std::memcpy(&size, buffer.data() + pos, sizeof size);
+            if (size > max_message_size)
+                throw std::runtime_error("Invalid replication message size.");
+            if (buffer_used - pos - message_header_size < size)
+                break;
+
+            BinaryReader reader({buffer.data() + pos + message_header_size, size});
+            const MessageKind kind = MessageKind(reader.ReadIndex(std::size_t(MessageKind::_count)));
+            const std::uint64_t sequence = reader.ReadVarint();
+
+            if (kind == MessageKind::keyframe)
+            {
+                ReadPublicViewKeyframe(reader, view);
+                have_keyframe = true;
+            }
+            else
+            {
+                // If we missed something, reconnect to start from a keyframe again.
+                if (!have_keyframe || sequence != expected_sequence)
+                    throw std::runtime_error("Missed a replication message.");
+                ApplyPublicViewDelta(reader, view);
+            }
+
+            if (!reader.AtEnd())
+                throw std::runtime_error("Junk at the end of a replication message.");
+
+            expected_sequence = sequence + 1;
+            changed = true;
+            pos += message_header_size + size;
+        }
+
+        // Keep the incomplete message for later.
+        std::memmove(buffer.data(), buffer.data() + pos, buffer_used - pos);
+        buffer_used -= pos;
+
+        if (changed)
+        {
+            {
+                std::lock_guard lock(mutex);
+                latest_view = view;
+                view_changed = true;
+            }
+            if (on_change)
+                on_change();
+        }
+    }
+}
+
+void ReplicationClient::ThreadFunc()
+{
+    TRACE_THREAD_NAME("Replication client");
+
+    while (!stop)
+    {
+        try
+        {
+            Socket socket = Socket::Connect(host, port);
+
+            bool ready = false;
+            while (!stop && !(ready = socket.Wait(true, client_poll_interval_ms)))
+            {}
+
+            if (ready && !socket.ConnectionFailed())
+            {
+                connected = true;
+                RunConnection(socket);
+            }
+        }
+        catch (std::exception &e)
+        {
+            SDL_Log("Replication: %s", e.what());
+        }
+
+        connected = false;
+
+        std::unique_lock lock(mutex);
+        stop_cond.wait_for(lock, reconnect_delay, [&]{return stop.load();});
+    }
+}
+
+void ParseReplicationAddress(std::string_view address, std::string &host, std::uint16_t &port)
+{
+    port = default_replication_port;
+
+    const std::size_t colon = address.rfind(':');
+    if (colon != std::string_view::npos)
+    {
+        const std::string_view port_str = address.substr(colon + 1);
+        const auto [ptr, ec] = std::from_chars(port_str.data(), port_str.data() + port_str.size(), port);
+        if (ec != std::errc{} || ptr != port_str.data() + port_str.size() || port == 0)
+            throw std::runtime_error("Invalid port in `" + std::string(address) + "`.");
+        address = address.substr(0, colon);
+    }
+
+    if (address.empty())
+        throw std::runtime_error("Expected `host[:port]`.");
+    host = address;
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "binary_io.h"
+#include "socket.h"
+#include "state.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Streams the public part of the game state from the moderator's device to any number of read-only displays (see `MakeMirror()`), over TCP.
+//
+// The stream is a sequence of messages, each one is a keyframe (the whole view) or a delta (the changes since the previous message).
+// Each message is `[u32 size][varint kind][varint sequence number][body]`, the sequence numbers go up by one.
+// A delta only mentions the fields that changed, and the player list is sent as a replaced range, so the traffic is proportional to the change.
+// A keyframe is sent every `keyframe_interval` messages. A subscriber that connects later gets the latest keyframe plus the deltas after it.
+
+inline constexpr std::uint16_t default_replication_port = 47293;
+
+enum class PublicPhase
+{
+    roll_call,
+    night,
+    day,
+    _count [[maybe_unused]],
+};
+
+// What the players are allowed to see.
+struct PublicView
+{
+    int day = 0;
+    PublicPhase phase = PublicPhase::roll_call;
+    // The names of the players still in the game, in the table order.
+    std::vector<std::string> players;
+    std::array<int, int(Faction::_count)> faction_counts{};
+
+    [[nodiscard]] bool operator==(const PublicView &) const = default;
+};
+
+// The encoding of the messages. The readers throw on invalid data.
+void WritePublicViewKeyframe(BinaryWriter &writer, const PublicView &view);
+void WritePublicViewDelta(BinaryWriter &writer, const PublicView &from, const PublicView &to);
+void ReadPublicViewKeyframe(BinaryReader &reader, PublicView &view);
+void ApplyPublicViewDelta(BinaryReader &reader, PublicView &view);
+
+class ReplicationServer
+{
+  public:
+    static constexpr std::uint64_t keyframe_interval = 64;
+
+  private:
+    Socket listener;
+
+    // Only used by `Publish()`.
+    PublicView published_view;
+    std::uint64_t next_sequence = 0;
+    BinaryWriter writer;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+
+    // Those are protected by the mutex: [
+    // Encoded messages that weren't handed to the subscribers yet.
+    std::vector<unsigned char> pending_messages;
+    bool stop = false;
+    // ]
+
+    std::atomic<int> num_subscribers = 0;
+    std::atomic<std::uint64_t> bytes_sent = 0;
+    std::atomic<std::uint64_t> bytes_published = 0;
+
+    std::thread thread;
+
+    void ThreadFunc();
+
+  public:
+    // Starts listening. If `port` is 0, picks any free port. Throws on failure.
+    ReplicationServer(std::uint16_t port = default_replication_port);
+    ReplicationServer(const ReplicationServer &) = delete;
+    ReplicationServer &operator=(const ReplicationServer &) = delete;
+    // Disconnects everyone.
+    ~ReplicationServer();
+
+    [[nodiscard]] std::uint16_t Port() const
+    {
+        return listener.LocalPort();
+    }
+
+    [[nodiscard]] int NumSubscribers() const
+    {
+        return num_subscribers.load(std::memory_order_relaxed);
+    }
+
+    // The total traffic to all subscribers so far.
+    [[nodiscard]] std::uint64_t BytesSent() const
+    {
+        return bytes_sent.load(std::memory_order_relaxed);
+    }
+
+    // The total size of the published messages, as if there was only one subscriber that never reconnects.
+    [[nodiscard]] std::uint64_t BytesPublished() const
+    {
+        return bytes_published.load(std::memory_order_relaxed);
+    }
+
+    // Sends `view` to the subscribers, as a delta from the previously published view. Does nothing if it didn't change.
+    // The sending happens on a background thread, this doesn't block.
+    void Publish(const PublicView &view);
+};
+
+class ReplicationClient
+{
+    std::string host;
+    std::uint16_t port = 0;
+
+    // Called from the background thread when the view changes.
+    std::function<void()> on_change;
+
+    std::mutex mutex;
+    // Wakes up the thread when stopping, if it waits to reconnect.
+    std::condition_variable stop_cond;
+
+    // Those are protected by the mutex: [
+    PublicView latest_view;
+    bool view_changed = false;
+    // ]
+
+    std::atomic<bool> stop = false;
+    std::atomic<bool> connected = false;
+
+    std::thread thread;
+
+    void ThreadFunc();
+    // Runs one connection until it breaks. Throws on protocol errors.
+    void RunConnection(const Socket &socket);
+
+  public:
+    // Starts connecting in the background, and keeps reconnecting when the connection breaks.
+    ReplicationClient(std::string host, std::uint16_t port, std::function<void()> on_change = nullptr);
+    ReplicationClient(const ReplicationClient &) = delete;
+    ReplicationClient &operator=(const ReplicationClient &) = delete;
+    ~ReplicationClient();
+
+    [[nodiscard]] bool IsConnected() const
+    {
+        return connected.load(std::memory_order_relaxed);
+    }
+
+    // If the view changed since the last call, copies it to `view` and returns true.
+    [[nodiscard]] bool TakeView(PublicView &view);
+};
+
+// Parses `host[:port]`. Throws on failure.
+void ParseReplicationAddress(std::string_view address, std::string &host, std::uint16_t &port);
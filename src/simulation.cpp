@@ -0,0 +1,332 @@
+#include "simulation.h"
+
+#include "random.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+// The threads take this many games at a time. Small enough to balance the load, large enough that the shared counter isn't contended.
+static constexpr std::uint64_t games_per_chunk = 4096;
+
+// Returns the index of a random set bit. The mask must not be empty.
+[[nodiscard]] static int PickRandom(std::uint64_t mask, Rng &rng)
+{
+    for (std::uint32_t i = rng.Below(std::uint32_t(std::popcount(mask))); i > 0; i--)
+        mask &= mask - 1;
+    return std::countr_zero(mask);
+}
+
+// The dealt roles, bit-packed. Bit N is the N-th player.
+struct SimulatedTable
+{
+    std::uint64_t all_players = 0;
+    std::array<std::uint64_t, int(Role::_count)> players_by_role{};
+    std::array<std::uint64_t, int(Faction::_count)> players_by_faction{};
+    std::array<int, int(Role::_count)> turns_by_role{};
+};
+
+// Returns the number of factions with living players. If there's one, `winner` is set to it.
+[[nodiscard]] static int CountFactionsLeft(const SimulatedTable &table, std::uint64_t alive, std::size_t &winner)
+{
+    int ret = 0;
+    for (std::size_t i = 0; i < std::size_t(Faction::_count); i++)
+    {
+        if (alive & table.players_by_faction[i])
+        {
+            ret++;
+            winner = i;
+        }
+    }
+    return ret;
+}
+
+// Plays one game. Returns the winner (an index into `SimulationResult::wins`), and adds the number of days to `num_days`.
+[[nodiscard]] static std::size_t PlayGame(const SimulatedTable &table, const SimulationConfig &config, Rng &rng, std::uint64_t &num_days)
+{
+    const std::array<Role, int(Role::_count)> &role_order = config.settings.role_order;
+    const bool informed = config.policy == SimulationPolicy::informed;
+    const std::uint64_t mafia_players = table.players_by_faction[std::size_t(Faction::mafia)];
+
+    std::uint64_t alive = table.all_players;
+
+    // What the sheriff and the boss have found out so far.
+    std::uint64_t sheriff_checked = 0;
+    std::uint64_t sheriff_found = 0;
+    std::uint64_t boss_checked = 0;
+    std::uint64_t sheriff_known_to_boss = 0;
+
+    for (int day = 0;; day++)
+    {
+        std::size_t winner = std::size_t(Faction::_count);
+        const int num_factions_left = CountFactionsLeft(table, alive, winner);
+        if (num_factions_left <= 1 || day == SimulationConfig::max_days)
+        {
+            num_days += std::uint64_t(day);
+            return num_factions_left == 1 ? winner : std::size_t(Faction::_count);
+        }
+
+        unsigned blocked_roles = 0;
+        std::uint64_t protected_players = 0;
+        std::uint64_t deaths = 0; // Both at night and by the vote.
+
+        for (std::size_t turn = 0; turn < role_order.size(); turn++)
+        {
+            const Role role = role_order[turn];
+            const std::size_t r = std::size_t(role);
+            if (blocked_roles & (1u << r))
+                continue;
+
+            // The town votes after the night's victims are found, and only if the game isn't decided by then.
+            std::size_t unused_winner;
+            if (role == Role::none && CountFactionsLeft(table, alive & ~deaths, unused_winner) <= 1)
+                continue;
+
+            // The mafia kill is the combined ability of the mafia and the boss. Everyone alive votes.
+            const std::uint64_t actors = role == Role::mafia ? alive & mafia_players : role == Role::none ? alive & ~deaths : alive & table.players_by_role[r];
+            if (!actors)
+                continue;
+
+            // Nobody targets themselves or their own team, except that anyone alive can be voted for.
+            std::uint64_t candidates = role == Role::none ? actors : alive & ~actors;
+            if (informed)
+            {
+                std::uint64_t preferred = candidates;
+                switch (role)
+                {
+                    case Role::sheriff:
+                        preferred &= ~sheriff_checked;
+                        break;
+                    case Role::mafia_boss:
+                        preferred &= ~boss_checked & ~mafia_players;
+                        break;
+                    case Role::mafia:
+                        preferred &= sheriff_known_to_boss ? sheriff_known_to_boss : ~std::uint64_t(0);
+                        break;
+                    case Role::none:
+                        // The sheriff reveals the findings, as long as they're alive.
+                        if (alive & table.players_by_role[std::size_t(Role::sheriff)])
+                            preferred &= alive & sheriff_found ? sheriff_found : ~(sheriff_checked & ~sheriff_found);
+                        break;
+                    default:
+                        break;
+                }
+                if (preferred)
+                    candidates = preferred;
+            }
+            if (!candidates)
+                continue;
+
+            const std::uint64_t target = std::uint64_t(1) << PickRandom(candidates, rng);
+
+            switch (role)
+            {
+                case Role::captain:
+                    // Only the night abilities, and only of the roles that haven't acted yet.
+                    for (std::size_t i = 0; i < std::size_t(Role::none); i++)
+                    {
+                        const bool hits = table.players_by_role[i] & target || (i == std::size_t(Role::mafia) && mafia_players & target);
+                        if (hits && std::size_t(table.turns_by_role[i]) > turn)
+                            blocked_roles |= 1u << i;
+                    }
+                    break;
+                case Role::sheriff:
+                    sheriff_checked |= target;
+                    if (target & (alive & mafia_players ? mafia_players : table.players_by_role[std::size_t(Role::killer)]))
+                        sheriff_found |= target;
+                    break;
+                case Role::prostitute:
+                    protected_players |= target;
+                    break;
+                case Role::mafia_boss:
+                    boss_checked |= target;
+                    sheriff_known_to_boss |= target & table.players_by_role[std::size_t(Role::sheriff)];
+                    break;
+                case Role::mafia:
+                case Role::yakuza:
+                case Role::killer:
+                    deaths |= target;
+                    break;
+                case Role::none:
+                    if (!(target & (protected_players | deaths)))
+                        deaths |= target;
+                    break;
+                case Role::_count:
+                    break;
+            }
+        }
+
+        alive &= ~deaths;
+    }
+}
+
+std::pair<double, double> SimulationResult::WinRateInterval(std::size_t winner) const
+{
+    if (num_games == 0)
+        return {0, 1};
+
+    constexpr double z = 1.96;
+    const double n = double(num_games);
+    const double p = WinRate(winner);
+    const double denominator = 1 + z * z / n;
+    const double center = (p + z * z / (2 * n)) / denominator;
+    const double half_width = z * std::sqrt(p * (1 - p) / n + z * z / (4 * n * n)) / denominator;
+    return {std::max(0.0, center - half_width), std::min(1.0, center + half_width)};
+}
+
+std::vector<Role> DealSimulationRoles(const SimulationConfig &config)
+{
+    if (config.num_players < 2 || config.num_players > SimulationConfig::max_players)
+        throw std::runtime_error("The number of players must be from 2 to " + std::to_string(SimulationConfig::max_players) + ".");
+
+    auto Enabled = [&](Role role){return config.enabled_roles[std::size_t(role)];};
+
+    std::vector<Role> ret;
+    for (Role role : {Role::captain, Role::sheriff, Role::prostitute, Role::killer})
+    {
+        if (Enabled(role))
+            ret.push_back(role);
+    }
+
+    if (Enabled(Role::mafia) || Enabled(Role::mafia_boss))
+    {
+        int num_mafia = config.num_mafia > 0 ? config.num_mafia : std::max(1, config.num_players / 4);
+        if (!Enabled(Role::mafia))
+            num_mafia = 1;
+        if (Enabled(Role::mafia_boss))
+        {
+            ret.push_back(Role::mafia_boss);
+            num_mafia--;
+        }
+        ret.insert(ret.end(), std::size_t(std::max(0, num_mafia)), Role::mafia);
+    }
+
+    if (Enabled(Role::yakuza))
+        ret.insert(ret.end(), std::size_t(config.num_yakuza > 0 ? config.num_yakuza : std::max(1, config.num_players / 6)), Role::yakuza);
+
+    if (int(ret.size()) > config.num_players)
+        throw std::runtime_error("The enabled roles need " + std::to_string(ret.size()) + " players, but there are only " + std::to_string(config.num_players) + ".");
+    ret.resize(std::size_t(config.num_players), Role::none);
+    return ret;
+}
+
+SimulationResult RunSimulation(const SimulationConfig &config, SimulationProgress *progress)
+{
+    TRACE_ZONE("RunSimulation");
+
+    SimulatedTable table;
+    const std::vector<Role> roles = DealSimulationRoles(config);
+    for (std::size_t i = 0; i < roles.size(); i++)
+    {
+        const std::uint64_t bit = std::uint64_t(1) << i;
+        table.all_players |= bit;
+        table.players_by_role[std::size_t(roles[i])] |= bit;
+        table.players_by_faction[std::size_t(RoleToFaction(roles[i]))] |= bit;
+    }
+    for (std::size_t i = 0; i < config.settings.role_order.size(); i++)
+        table.turns_by_role[std::size_t(config.settings.role_order[i])] = int(i);
+
+    int num_threads = config.num_threads;
+    if (num_threads <= 0)
+        num_threads = int(std::max(1u, std::thread::hardware_concurrency()));
+    const std::size_t thread_count = std::size_t(num_threads);
+
+    const std::uint64_t num_chunks = (config.num_games + games_per_chunk - 1) / games_per_chunk;
+    std::atomic<std::uint64_t> next_chunk = 0;
+
+    std::vector<SimulationResult> thread_results(thread_count);
+    std::vector<std::exception_ptr> errors(thread_count);
+
+    auto ThreadFunc = [&](std::size_t thread_index)
+    {
+        try
+        {
+            // Accumulate locally, the neighboring results would share cache lines.
+            SimulationResult result;
+            std::uint64_t chunk;
+            while ((chunk = next_chunk.fetch_add(1, std::memory_order_relaxed)) < num_chunks)
+            {
+                if (progress && progress->cancel.load(std::memory_order_relaxed))
+                    break;
+
+                Rng rng(config.seed, chunk);
+                const std::uint64_t begin = chunk * games_per_chunk;
+                const std::uint64_t end = std::min(begin + games_per_chunk, config.num_games);
+                for (std::uint64_t i = begin; i < end; i++)
+                    result.wins[PlayGame(table, config, rng, result.total_days)]++;
+                result.num_games += end - begin;
+
+                if (progress)
+                    progress->games_done.fetch_add(end - begin, std::memory_order_relaxed);
+            }
+            thread_results[thread_index] = result;
+        }
+        catch (...)
+        {
+            errors[thread_index] = std::current_exception();
+        }
+    };
+
+    if (thread_count == 1)
+    {
+        ThreadFunc(0);
+    }
+    else
+    {
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0; i < thread_count; i++)
+            threads.emplace_back(ThreadFunc, i);
+        for (std::thread &thread : threads)
+            thread.join();
+    }
+
+    for (const std::exception_ptr &error : errors)
+    {
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    SimulationResult ret;
+    for (const SimulationResult &result : thread_results)
+    {
+        ret.num_games += result.num_games;
+        ret.total_days += result.total_days;
+        for (std::size_t i = 0; i < ret.wins.size(); i++)
+            ret.wins[i] += result.wins[i];
+    }
+    return ret;
+}
+
+BackgroundSimulation::BackgroundSimulation(const SimulationConfig &config)
+    : num_games(config.num_games)
+{
+    future = std::async(std::launch::async, [this, config]{return RunSimulation(config, &progress);});
+}
+
+BackgroundSimulation::~BackgroundSimulation()
+{
+    Cancel();
+    if (future.valid())
+        future.wait();
+}
+
+bool BackgroundSimulation::IsDone() const
+{
+    return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+void BackgroundSimulation::Cancel()
+{
+    progress.cancel.store(true, std::memory_order_relaxed);
+}
+
+SimulationResult BackgroundSimulation::Result()
+{
+    return future.get();
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "state.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <utility>
+#include <vector>
+
+// Plays out random games with simple player policies, to compare role configurations (`Round::enabled_roles`) for a table size.
+// The actions are resolved with the same rules as `NightResolver`, in the turn order from the settings. A game ends when only one faction is left.
+// The players' positions don't matter to the policies, so the roles are dealt once per configuration rather than shuffled per game.
+
+enum class SimulationPolicy
+{
+    // Everyone picks their targets and votes uniformly at random among the other living players.
+    random,
+    // The teams don't target their own members, the sheriff and the boss don't check the same player twice, the mafia kills the sheriff
+    //   once the boss finds them, and the town votes for the players the sheriff has found (which the sheriff reveals), if any.
+    informed,
+    _count [[maybe_unused]],
+};
+
+struct SimulationConfig
+{
+    // At most `max_players`, since the game state is bit-packed into 64-bit masks.
+    static constexpr int max_players = 64;
+    // Stop the games that take longer than this many days, and count them as having no winner.
+    static constexpr int max_days = 64;
+
+    int num_players = 10;
+    // Same as `Round::enabled_roles`. The roles other than `mafia`, `yakuza` and `none` get one player each.
+    std::array<bool, int(Role::_count)> enabled_roles{};
+    // The sizes of the mafia (including the boss) and the yakuza teams, if those are enabled. 0 picks a size from the number of players.
+    int num_mafia = 0;
+    int num_yakuza = 0;
+
+    SimulationPolicy policy = SimulationPolicy::informed;
+    Settings settings;
+
+    std::uint64_t num_games = 1'000'000;
+    // The results only depend on the seed, not on the number of threads.
+    std::uint64_t seed = 1;
+    // 0 = all cores.
+    int num_threads = 0;
+
+    SimulationConfig()
+    {
+        enabled_roles[std::size_t(Role::none)] = true;
+        enabled_roles[std::size_t(Role::mafia)] = true;
+        settings.SetDefault();
+    }
+};
+
+struct SimulationResult
+{
+    // Fewer than requested, if the simulation was cancelled.
+    std::uint64_t num_games = 0;
+    // Indexed by `Faction`. The last one counts the games without a winner (everyone died, or `SimulationConfig::max_days` passed).
+    std::array<std::uint64_t, int(Faction::_count) + 1> wins{};
+    std::uint64_t total_days = 0;
+
+    // The 95% confidence interval of the win rate, with the Wilson score method. `winner` is an index into `wins`.
+    [[nodiscard]] std::pair<double, double> WinRateInterval(std::size_t winner) const;
+
+    [[nodiscard]] double WinRate(std::size_t winner) const
+    {
+        return num_games > 0 ? double(wins[winner]) / double(num_games) : 0;
+    }
+
+    [[nodiscard]] double AverageDays() const
+    {
+        return num_games > 0 ? double(total_days) / double(num_games) : 0;
+    }
+};
+
+// Lets another thread watch and cancel a running simulation.
+struct SimulationProgress
+{
+    std::atomic<std::uint64_t> games_done = 0;
+    std::atomic<bool> cancel = false;
+};
+
+// The roles of the players, in the order they're dealt. Throws if the configuration doesn't fit the table.
+[[nodiscard]] std::vector<Role> DealSimulationRoles(const SimulationConfig &config);
+
+// Plays the games on `config.num_threads` threads. The threads take the games in small chunks from a shared counter,
+//   so the fast threads take over the work of the slow ones. Each chunk has its own random stream, derived from the seed and the chunk index.
+// Throws if the configuration is invalid.
+[[nodiscard]] SimulationResult RunSimulation(const SimulationConfig &config, SimulationProgress *progress = nullptr);
+
+// Runs a simulation on a background thread (which runs the simulation threads). Cancels it and waits for it when destroyed.
+class BackgroundSimulation
+{
+    std::uint64_t num_games = 0;
+    SimulationProgress progress;
+    std::future<SimulationResult> future;
+
+  public:
+    explicit BackgroundSimulation(const SimulationConfig &config);
+    ~BackgroundSimulation();
+
+    BackgroundSimulation(const BackgroundSimulation &) = delete;
+    BackgroundSimulation &operator=(const BackgroundSimulation &) = delete;
+
+    // From 0 to 1.
+    [[nodiscard]] float Progress() const
+    {
+        return num_games > 0 ? float(double(progress.games_done.load(std::memory_order_relaxed)) / double(num_games)) : 1;
+    }
+
+    [[nodiscard]] bool IsDone() const;
+
+    // Stops early. The result then only includes the games played so far.
+    void Cancel();
+
+    // Call this once, after `IsDone()` returns true. Rethrows the exception if the simulation failed.
+    [[nodiscard]] SimulationResult Result();
+};
@@ -0,0 +1,251 @@
+#include "socket.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#ifdef _WIN32
+using NativeSocket = SOCKET;
+static constexpr NativeSocket invalid_native_socket = INVALID_SOCKET;
+
+static void InitSockets()
+{
+    static const bool ok = []{
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    if (!ok)
+        throw std::runtime_error("Unable to initialize Winsock.");
+}
+
+static void CloseNative(NativeSocket s)
+{
+    closesocket(s);
+}
+
+[[nodiscard]] static bool WouldBlock()
+{
+    const int error = WSAGetLastError();
+    return error == WSAEWOULDBLOCK || error == WSAEINPROGRESS;
+}
+
+static void SetNonBlocking(NativeSocket s)
+{
+    u_long value = 1;
+    ioctlsocket(s, FIONBIO, &value);
+}
+
+static int PollNative(pollfd *fd, int timeout_ms)
+{
+    return WSAPoll(fd, 1, timeout_ms);
+}
+#else
+using NativeSocket = int;
+static constexpr NativeSocket invalid_native_socket = -1;
+
+static void InitSockets() {}
+
+static void CloseNative(NativeSocket s)
+{
+    close(s);
+}
+
+[[nodiscard]] static bool WouldBlock()
+{
+    return errno == EWOULDBLOCK || errno == EAGAIN || errno == EINPROGRESS || errno == EINTR;
+}
+
+static void SetNonBlocking(NativeSocket s)
+{
+    fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+}
+
+static int PollNative(pollfd *fd, int timeout_ms)
+{
+    return poll(fd, 1, timeout_ms);
+}
+#endif
+
+// Don't kill the process with `SIGPIPE` when writing to a closed connection.
+#ifdef MSG_NOSIGNAL
+static constexpr int send_flags = MSG_NOSIGNAL;
+#else
+static constexpr int send_flags = 0;
+#endif
+
+[[nodiscard]] static NativeSocket ToNative(std::intptr_t handle)
+{
+    return handle == -1 ? invalid_native_socket : NativeSocket(handle);
+}
+
+// Prepares a new socket for our use.
+static void Configure(NativeSocket s)
+{
+    SetNonBlocking(s);
+
+    // We send small messages and want them delivered right away.
+    int one = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char *)&one, sizeof one);
+    #ifdef SO_NOSIGPIPE
+    setsockopt(s, SOL_SOCKET, SO_NOSIGPIPE, (const char *)&one, sizeof one);
+    #endif
+}
+
+Socket::~Socket()
+{
+    if (IsValid())
+        CloseNative(ToNative(handle));
+}
+
+Socket Socket::Listen(std::uint16_t port)
+{
+    InitSockets();
+
+    NativeSocket s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == invalid_native_socket)
+        throw std::runtime_error("Unable to create a socket.");
+    Socket ret{std::intptr_t(s)};
+
+    // Allow restarting the server right away, without waiting for the old connections to time out.
+    int one = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char *)&one, sizeof one);
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(s, (const sockaddr *)&addr, sizeof addr) != 0)
+        throw std::runtime_error("Unable to listen on port " + std::to_string(port) + ", it's probably taken.");
+    if (listen(s, SOMAXCONN) != 0)
+        throw std::runtime_error("Unable to listen on port " + std::to_string(port) + ".");
+
+    SetNonBlocking(s);
+    return ret;
+}
+
+Socket Socket::Connect(const std::string &host, std::uint16_t port)
+{
+    InitSockets();
+
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *info = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &info) != 0 || !info)
+        throw std::runtime_error("Unable to resolve `" + host + "`.");
+
+    NativeSocket s = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+    if (s == invalid_native_socket)
+    {
+        freeaddrinfo(info);
+        throw std::runtime_error("Unable to create a socket.");
+    }
+    Socket ret{std::intptr_t(s)};
+
+    Configure(s);
+    const int result = connect(s, info->ai_addr, int(info->ai_addrlen));
+    freeaddrinfo(info);
+    if (result != 0 && !WouldBlock())
+        throw std::runtime_error("Unable to connect to `" + host + "`.");
+
+    return ret;
+}
+
+std::uint16_t Socket::LocalPort() const
+{
+    sockaddr_in addr{};
+    socklen_t size = sizeof addr;
+    if (getsockname(ToNative(handle), (sockaddr *)&addr, &size) != 0)
+        return 0;
+    return ntohs(addr.sin_port);
+}
+
+Socket Socket::Accept() const
+{
+    NativeSocket s = accept(ToNative(handle), nullptr, nullptr);
+    if (s == invalid_native_socket)
+        return {};
+    Configure(s);
+    return Socket(std::intptr_t(s));
+}
+
+bool Socket::ConnectionFailed() const
+{
+    int error = 0;
+    socklen_t size = sizeof error;
+    return getsockopt(ToNative(handle), SOL_SOCKET, SO_ERROR, (char *)&error, &size) != 0 || error != 0;
+}
+
+std::ptrdiff_t Socket::Send(std::span<const unsigned char> data) const
+{
+    const auto result = send(ToNative(handle), (const char *)data.data(), int(data.size()), send_flags);
+    if (result >= 0)
+        return std::ptrdiff_t(result);
+    return WouldBlock() ? 0 : -1;
+}
+
+std::ptrdiff_t Socket::Receive(std::span<unsigned char> data) const
+{
+    const auto result = recv(ToNative(handle), (char *)data.data(), int(data.size()), 0);
+    if (result > 0)
+        return std::ptrdiff_t(result);
+    if (result == 0)
+        return -1; // Closed by the other side.
+    return WouldBlock() ? 0 : -1;
+}
+
+bool Socket::Wait(bool write, int timeout_ms) const
+{
+    pollfd fd{};
+    fd.fd = ToNative(handle);
+    fd.events = write ? POLLOUT : POLLIN;
+    return PollNative(&fd, timeout_ms) > 0;
+}
+
+std::string Socket::GuessLocalAddress()
+{
+    try
+    {
+        InitSockets();
+    }
+    catch (...)
+    {
+        return {};
+    }
+
+    // Connecting a UDP socket sends nothing, but picks the interface that would be used to reach that address.
+    NativeSocket s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s == invalid_native_socket)
+        return {};
+    Socket guard{std::intptr_t(s)};
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(9);
+    inet_pton(AF_INET, "192.168.0.1", &addr.sin_addr);
+    if (connect(s, (const sockaddr *)&addr, sizeof addr) != 0)
+        return {};
+
+    sockaddr_in local{};
+    socklen_t size = sizeof local;
+    if (getsockname(s, (sockaddr *)&local, &size) != 0)
+        return {};
+
+    char buffer[INET_ADDRSTRLEN] = {};
+    if (!inet_ntop(AF_INET, &local.sin_addr, buffer, sizeof buffer))
+        return {};
+    return buffer;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <utility>
+
+// A thin wrapper over TCP sockets: BSD sockets, or Winsock on Windows.
+// All sockets are non-blocking. Use `Wait()` to sleep until one is ready.
+class Socket
+{
+    // `SOCKET` on Windows, a file descriptor elsewhere.
+    std::intptr_t handle = -1;
+
+    explicit Socket(std::intptr_t handle) : handle(handle) {}
+
+  public:
+    Socket() {}
+    Socket(Socket &&other) noexcept : handle(other.handle) {other.handle = -1;}
+    Socket &operator=(Socket other) noexcept
+    {
+        std::swap(handle, other.handle);
+        return *this;
+    }
+    ~Socket();
+
+    [[nodiscard]] bool IsValid() const
+    {
+        return handle != -1;
+    }
+
+    // Listens on all interfaces. If `port` is 0, picks any free port, see `LocalPort()`. Throws on failure.
+    [[nodiscard]] static Socket Listen(std::uint16_t port);
+
+    // Starts connecting, without waiting for the connection to be established. Throws if the host can't be resolved.
+    // Wait for the socket to become writable, then check `ConnectionFailed()`.
+    [[nodiscard]] static Socket Connect(const std::string &host, std::uint16_t port);
+
+    [[nodiscard]] std::uint16_t LocalPort() const;
+
+    // Returns an invalid socket if there are no pending connections.
+    [[nodiscard]] Socket Accept() const;
+
+    // After `Connect()`, returns true if connecting has failed.
+    [[nodiscard]] bool ConnectionFailed() const;
+
+    // Those return the number of bytes transferred, 0 if the socket isn't ready, or -1 if the connection is closed or broken.
+    [[nodiscard]] std::ptrdiff_t Send(std::span<const unsigned char> data) const;
+    [[nodiscard]] std::ptrdiff_t Receive(std::span<unsigned char> data) const;
+
+    // Waits until the socket is readable (or writable, if `write` is true), or until the timeout. Returns false on timeout.
+    // An error also counts as ready, then the next `Send()` or `Receive()` reports it.
+    [[nodiscard]] bool Wait(bool write, int timeout_ms) const;
+
+    // A best guess for the address of this device on the local network, for others to connect to. Empty if unknown.
+    [[nodiscard]] static std::string GuessLocalAddress();
+};
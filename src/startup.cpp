@@ -0,0 +1,36 @@
+#include "startup.h"
+
+#include <SDL3/SDL_events.h>
+#include <SDL3/SDL_log.h>
+
+#include <mutex>
+
+static std::mutex wake_up_mutex;
+// Those are protected by the mutex: [
+static bool can_wake_up = false;
+// ]
+
+void LogStartupStage(const char *name, std::uint64_t start_ns)
+{
+    const std::uint64_t end_ns = SDL_GetTicksNS();
+    SDL_Log("Startup: %s took %.1f ms, done at %.1f ms.", name, double(end_ns - start_ns) / 1e6, double(end_ns) / 1e6);
+}
+
+void EnableMainLoopWakeUps()
+{
+    // If a stage finished before this, taking the lock makes sure that the main loop sees its result.
+    std::lock_guard lock(wake_up_mutex);
+    can_wake_up = true;
+}
+
+void WakeUpMainLoop()
+{
+    std::lock_guard lock(wake_up_mutex);
+    if (!can_wake_up)
+        return;
+
+    // Any event will do.
+    SDL_Event event{};
+    event.type = SDL_EVENT_USER;
+    SDL_PushEvent(&event);
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <SDL3/SDL_timer.h>
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+// The startup is a small dependency graph. The independent slow stages (reading the font, loading the session) run on worker threads
+//   while the main thread initializes SDL and creates the window and the renderer. The first frame is drawn as soon as the font and the game are ready,
+//   and the rest (e.g. the gamepads) is initialized after it.
+
+// Logs how long a startup stage took, from `start_ns` until now, on the `SDL_GetTicksNS()` clock. Thread-safe.
+void LogStartupStage(const char *name, std::uint64_t start_ns);
+
+// Call this after `SDL_Init()`. Until then `WakeUpMainLoop()` does nothing, since the event queue might not exist yet (the stages start before it),
+//   but the main loop checks the stages before it waits for the first time anyway.
+void EnableMainLoopWakeUps();
+
+// Wakes up the main loop if it's waiting for events. Thread-safe.
+void WakeUpMainLoop();
+
+// A startup stage that runs on a worker thread, and wakes up the main loop when it's done. It also logs how long it took.
+// There are no threads in our web build, so there it runs immediately in the constructor.
+template <typename T>
+class StartupStage
+{
+    std::future<T> future;
+    std::thread thread;
+
+  public:
+    StartupStage() {}
+
+    template <typename F>
+    StartupStage(const char *name, F &&func)
+    {
+        std::promise<T> promise;
+        future = promise.get_future();
+
+        auto body = [name, promise = std::move(promise), func = std::forward<F>(func)]() mutable
+        {
+            const std::uint64_t start_ns = SDL_GetTicksNS();
+            try
+            {
+                if constexpr (std::is_void_v<T>)
+                {
+                    func();
+                    promise.set_value();
+                }
+                else
+                {
+                    promise.set_value(func());
+                }
+            }
+            catch (...)
+            {
+                promise.set_exception(std::current_exception());
+            }
+            LogStartupStage(name, start_ns);
+            // Only after the result is set, otherwise the main loop could check it too early and go back to sleep.
+            WakeUpMainLoop();
+        };
+
+        #ifdef __EMSCRIPTEN__
+        body();
+        #else
+        thread = std::thread(std::move(body));
+        #endif
+    }
+
+    StartupStage(StartupStage &&) = default;
+    StartupStage &operator=(StartupStage &&other) noexcept
+    {
+        Wait();
+        future = std::move(other.future);
+        thread = std::move(other.thread);
+        return *this;
+    }
+
+    // Waits for the worker thread, if any.
+    ~StartupStage()
+    {
+        Wait();
+    }
+
+    // False if default-constructed, or after `Get()`.
+    [[nodiscard]] bool IsPending() const
+    {
+        return future.valid();
+    }
+
+    [[nodiscard]] bool IsReady() const
+    {
+        return future.valid() && future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
+    // Waits for the stage to finish, and returns its result. Rethrows its exception, if any.
+    [[nodiscard]] T Get()
+    {
+        Wait();
+        return future.get();
+    }
+
+    void Wait()
+    {
+        if (thread.joinable())
+            thread.join();
+    }
+};
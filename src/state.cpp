@@ -0,0 +1,167 @@
+#include "state.h"
+
+#include "binary_io.h"
+
+#include <stdexcept>
+
+static void WritePlayerTable(BinaryWriter &writer, const PlayerTable &players)
+{
+    writer.WriteVarint(players.Size());
+    for (std::size_t i = 0; i < players.Size(); i++)
+    {
+        const Player pl = players.Get(i);
+        writer.WriteSignedVarint(pl.id);
+        writer.WriteVarint(std::uint64_t(pl.name));
+        writer.WriteVarint(std::uint64_t(pl.role));
+        writer.WriteVarint(std::uint64_t(pl.times_targeted_by_captain));
+        writer.WriteVarint(std::uint64_t(pl.times_targeted_by_sheriff));
+        writer.WriteVarint(std::uint64_t(pl.times_targeted_by_prostitute));
+        writer.WriteVarint(std::uint64_t(pl.times_targeted_by_mafia_boss));
+    }
+}
+
+[[nodiscard]] static PlayerTable ReadPlayerTable(BinaryReader &reader, const NamePool &names)
+{
+    PlayerTable ret;
+    const std::size_t num_players = std::size_t(reader.ReadVarint());
+    for (std::size_t i = 0; i < num_players; i++)
+    {
+        Player pl;
+        pl.id = int(reader.ReadSignedVarint());
+        pl.name = NameId(reader.ReadIndex(names.Size()));
+        pl.role = Role(reader.ReadIndex(std::size_t(Role::_count)));
+        pl.times_targeted_by_captain = int(reader.ReadVarint());
+        pl.times_targeted_by_sheriff = int(reader.ReadVarint());
+        pl.times_targeted_by_prostitute = int(reader.ReadVarint());
+        pl.times_targeted_by_mafia_boss = int(reader.ReadVarint());
+        ret.Add(pl);
+    }
+    return ret;
+}
+
+void WriteState(BinaryWriter &writer, const State &state)
+{
+    writer.WriteVarint(state.names.Size());
+    for (std::size_t i = 0; i < state.names.Size(); i++)
+        writer.WriteString(state.names[NameId(i)]);
+
+    writer.WriteVarint(state.days.size());
+    for (std::size_t i = 0; i < state.days.size(); i++)
+    {
+        const Day &day = state.days[i];
+
+        // Most days have the same players as the previous one, don't repeat them.
+        // When reading, such days share the players with the previous day again.
+        const bool same_players = i > 0 && day.players == state.days[i - 1].players;
+        writer.Write<std::uint8_t>(same_players);
+        if (!same_players)
+            WritePlayerTable(writer, day.players);
+
+        for (const Action &action : *day.actions)
+        {
+            writer.WriteVarint(action.targets.size());
+            for (int target : action.targets)
+                writer.WriteSignedVarint(target);
+        }
+    }
+}
+
+State ReadState(BinaryReader &reader)
+{
+    State ret;
+
+    const std::size_t num_names = std::size_t(reader.ReadVarint());
+    for (std::size_t i = 0; i < num_names; i++)
+    {
+        if (ret.names.Intern(reader.ReadString()) != NameId(i))
+            throw std::runtime_error("Duplicate player names in the saved state.");
+    }
+
+    const std::size_t num_days = std::size_t(reader.ReadVarint());
+    for (std::size_t i = 0; i < num_days; i++)
+    {
+        Day day;
+
+        if (reader.Read<std::uint8_t>() != 0)
+        {
+            if (ret.days.empty())
+                throw std::runtime_error("The first day in the saved state refers to the previous day.");
+            day.players = ret.days.back().players;
+        }
+        else
+        {
+            day.players = ReadPlayerTable(reader, ret.names);
+        }
+
+        std::array<Action, int(Role::_count)> actions;
+        bool have_actions = false;
+        for (Action &action : actions)
+        {
+            // Each target takes at least one byte, so a corrupted count can't make us allocate more than the data size.
+            action.targets.resize(reader.ReadIndex(reader.RemainingBytes() + 1));
+            for (int &target : action.targets)
+                target = int(reader.ReadSignedVarint());
+            have_actions = have_actions || !action.targets.empty();
+        }
+        if (have_actions)
+            day.actions = std::move(actions);
+
+        ret.days.push_back(std::move(day));
+    }
+
+    return ret;
+}
+
+void WriteSettings(BinaryWriter &writer, const Settings &settings)
+{
+    for (Role role : settings.role_order)
+        writer.WriteVarint(std::uint64_t(role));
+}
+
+Settings ReadSettings(BinaryReader &reader)
+{
+    Settings ret;
+    unsigned seen_roles = 0;
+    for (Role &role : ret.role_order)
+    {
+        role = Role(reader.ReadIndex(std::size_t(Role::_count)));
+        if (seen_roles & (1u << int(role)))
+            throw std::runtime_error("Duplicate roles in the saved role order.");
+        seen_roles |= 1u << int(role);
+    }
+    return ret;
+}
+
+void WriteRound(BinaryWriter &writer, const Round &round)
+{
+    WriteState(writer, round.state);
+    writer.WriteSignedVarint(round.active_day_index);
+    writer.WriteSignedVarint(round.active_role_index);
+
+    unsigned enabled_roles_mask = 0;
+    for (int i = 0; i < int(Role::_count); i++)
+    {
+        if (round.enabled_roles[std::size_t(i)])
+            enabled_roles_mask |= 1u << i;
+    }
+    writer.WriteVarint(enabled_roles_mask);
+}
+
+Round ReadRound(BinaryReader &reader)
+{
+    Round ret;
+    ret.state = ReadState(reader);
+    if (ret.state.days.empty())
+        throw std::runtime_error("The saved state has no days.");
+
+    ret.active_day_index = int(reader.ReadIndex(ret.state.days.size()));
+    ret.active_role_index = int(reader.ReadSignedVarint());
+    if (ret.active_role_index < 0 || ret.active_role_index >= int(Role::_count))
+        throw std::runtime_error("Invalid active role in the saved state.");
+
+    const std::uint64_t enabled_roles_mask = reader.ReadVarint();
+    for (int i = 0; i < int(Role::_count); i++)
+        ret.enabled_roles[std::size_t(i)] = enabled_roles_mask & (1u << i);
+
+    return ret;
+}
@@ -0,0 +1,301 @@
+#pragma once
+
+#include "cow.h"
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class BinaryReader;
+class BinaryWriter;
+
+enum class Role
+{
+    // Those are ordered by their default turn order. Sync order with the `role_...` strings in `localization.h`.
+    captain, // Blocks night-time ability of any player. Targeting mafia (possibly boss) blocks their combined ability.
+    sheriff, // Detects mafia, or killer if no mafia.
+    prostitute, // Protects from death by vote on the next day.
+    mafia_boss, // Same as normal mafia, but detects sheriff.
+    mafia, // Mafia.
+    yakuza, // Second kind of mafia, "yakuza".
+    killer, // Its own faction, kills at night like mafia, but completely independent.
+    none, // This must be last.
+    _count [[maybe_unused]],
+};
+
+enum class Faction
+{
+    // Sync with the `faction_...` strings in `localization.h`.
+    peaceful,
+    mafia,
+    yakuza,
+    killer,
+    _count [[maybe_unused]],
+};
+
+[[nodiscard]] inline Faction RoleToFaction(Role role)
+{
+    switch (role)
+    {
+        case Role::captain:    return Faction::peaceful;
+        case Role::sheriff:    return Faction::peaceful;
+        case Role::prostitute: return Faction::peaceful;
+        case Role::mafia_boss: return Faction::mafia;
+        case Role::mafia:      return Faction::mafia;
+        case Role::yakuza:     return Faction::yakuza;
+        case Role::killer:     return Faction::killer;
+        case Role::none:       return Faction::peaceful;
+    }
+}
+
+enum class NameId : int {};
+
+// Interned player names, so that each name is stored once no matter how many days the player appears in.
+class NamePool
+{
+    std::vector<std::string> names;
+    std::unordered_multimap<std::size_t, NameId> ids_by_hash;
+
+  public:
+    [[nodiscard]] NameId Intern(std::string_view name)
+    {
+        if (std::optional<NameId> id = Find(name))
+            return *id;
+
+        NameId ret = NameId(names.size());
+        names.emplace_back(name);
+        ids_by_hash.emplace(std::hash<std::string_view>{}(name), ret);
+        return ret;
+    }
+
+    // Returns null if there's no such name.
+    [[nodiscard]] std::optional<NameId> Find(std::string_view name) const
+    {
+        auto [begin, end] = ids_by_hash.equal_range(std::hash<std::string_view>{}(name));
+        for (auto it = begin; it != end; ++it)
+        {
+            if (names[std::size_t(it->second)] == name)
+                return it->second;
+        }
+        return std::nullopt;
+    }
+
+    [[nodiscard]] const std::string &operator[](NameId id) const
+    {
+        return names[std::size_t(id)];
+    }
+
+    [[nodiscard]] std::size_t Size() const
+    {
+        return names.size();
+    }
+};
+
+struct Player
+{
+    int id = 0;
+    NameId name{};
+    Role role;
+
+    int times_targeted_by_captain = 0;
+    int times_targeted_by_sheriff = 0;
+    int times_targeted_by_prostitute = 0;
+    int times_targeted_by_mafia_boss = 0;
+};
+
+// The players of a single day, stored column-wise.
+// The columns are shared with the neighboring days until modified, so a new day only pays for the columns (and chunks of them) that changed.
+struct PlayerTable
+{
+    CowColumn<int> ids;
+    CowColumn<NameId> names;
+    CowColumn<Role> roles;
+
+    CowColumn<int> times_targeted_by_captain;
+    CowColumn<int> times_targeted_by_sheriff;
+    CowColumn<int> times_targeted_by_prostitute;
+    CowColumn<int> times_targeted_by_mafia_boss;
+
+    // Those are updated by `Add()`, `Insert()`, `Remove()` and `SetRole()`. Don't modify the columns directly.
+    std::array<int, int(Role::_count)> role_counts{};
+    std::array<int, int(Faction::_count)> faction_counts{};
+    // Bit N is set if `role_counts[N] > 0`.
+    unsigned role_mask = 0;
+
+    [[nodiscard]] std::size_t Size() const
+    {
+        return ids.Size();
+    }
+
+    [[nodiscard]] bool IsEmpty() const
+    {
+        return ids.IsEmpty();
+    }
+
+    [[nodiscard]] Player Get(std::size_t i) const
+    {
+        return {
+            .id = ids[i],
+            .name = names[i],
+            .role = roles[i],
+            .times_targeted_by_captain = times_targeted_by_captain[i],
+            .times_targeted_by_sheriff = times_targeted_by_sheriff[i],
+            .times_targeted_by_prostitute = times_targeted_by_prostitute[i],
+            .times_targeted_by_mafia_boss = times_targeted_by_mafia_boss[i],
+        };
+    }
+
+    void Add(const Player &pl)
+    {
+        CountRole(pl.role, 1);
+
+        ids.PushBack(pl.id);
+        names.PushBack(pl.name);
+        roles.PushBack(pl.role);
+        times_targeted_by_captain.PushBack(pl.times_targeted_by_captain);
+        times_targeted_by_sheriff.PushBack(pl.times_targeted_by_sheriff);
+        times_targeted_by_prostitute.PushBack(pl.times_targeted_by_prostitute);
+        times_targeted_by_mafia_boss.PushBack(pl.times_targeted_by_mafia_boss);
+    }
+
+    // Inserts a player before the `i`-th one.
+    void Insert(std::size_t i, const Player &pl)
+    {
+        CountRole(pl.role, 1);
+
+        ids.Insert(i, pl.id);
+        names.Insert(i, pl.name);
+        roles.Insert(i, pl.role);
+        times_targeted_by_captain.Insert(i, pl.times_targeted_by_captain);
+        times_targeted_by_sheriff.Insert(i, pl.times_targeted_by_sheriff);
+        times_targeted_by_prostitute.Insert(i, pl.times_targeted_by_prostitute);
+        times_targeted_by_mafia_boss.Insert(i, pl.times_targeted_by_mafia_boss);
+    }
+
+    void Remove(std::size_t i)
+    {
+        CountRole(roles[i], -1);
+
+        ids.Erase(i);
+        names.Erase(i);
+        roles.Erase(i);
+        times_targeted_by_captain.Erase(i);
+        times_targeted_by_sheriff.Erase(i);
+        times_targeted_by_prostitute.Erase(i);
+        times_targeted_by_mafia_boss.Erase(i);
+    }
+
+    // Compares the players. The counts are not compared, since they're computed from the players.
+    [[nodiscard]] bool operator==(const PlayerTable &other) const
+    {
+        return
+            ids == other.ids &&
+            names == other.names &&
+            roles == other.roles &&
+            times_targeted_by_captain == other.times_targeted_by_captain &&
+            times_targeted_by_sheriff == other.times_targeted_by_sheriff &&
+            times_targeted_by_prostitute == other.times_targeted_by_prostitute &&
+            times_targeted_by_mafia_boss == other.times_targeted_by_mafia_boss;
+    }
+
+    void SetRole(std::size_t i, Role role)
+    {
+        if (roles[i] == role)
+            return;
+
+        CountRole(roles[i], -1);
+        CountRole(role, 1);
+        roles.Set(i, role);
+    }
+
+  private:
+    void CountRole(Role role, int delta)
+    {
+        int &count = role_counts[std::size_t(role)];
+        count += delta;
+        faction_counts[std::size_t(RoleToFaction(role))] += delta;
+
+        if (count > 0)
+            role_mask |= 1u << int(role);
+        else
+            role_mask &= ~(1u << int(role));
+    }
+};
+
+struct Action
+{
+    std::vector<int> targets;
+};
+
+struct Day
+{
+    PlayerTable players;
+
+    // The indices here are `Role`s.
+    Cow<std::array<Action, int(Role::_count)>> actions;
+
+    [[nodiscard]] bool HavePlayersWithRole(Role role) const
+    {
+        return players.role_mask & (1u << int(role));
+    }
+};
+
+struct State
+{
+    // Copying a day is cheap, it shares all its data with the original until modified.
+    std::vector<Day> days;
+
+    NamePool names;
+};
+
+struct Settings
+{
+    std::array<Role, int(Role::_count)> role_order;
+
+    void SetDefault()
+    {
+        for (int i = 0; i < int(Role::_count); i++)
+            role_order[std::size_t(i)] = Role(i);
+    }
+
+    // Converts a mask of roles (bit N is `Role(N)`) to a mask of turns (bit N is `role_order[N]`).
+    [[nodiscard]] unsigned RoleMaskToTurnMask(unsigned role_mask) const
+    {
+        unsigned ret = 0;
+        for (int i = 0; i < int(Role::_count); i++)
+        {
+            if (role_mask & (1u << int(role_order[std::size_t(i)])))
+                ret |= 1u << i;
+        }
+        return ret;
+    }
+};
+
+struct Round
+{
+    State state;
+
+    int active_day_index = 0;
+    int active_role_index = 0; // This is an index into `Settings::role_order`.
+
+    std::array<bool, int(Role::_count)> enabled_roles{};
+
+    Round()
+    {
+        enabled_roles[std::size_t(Role::none)] = true;
+        enabled_roles[std::size_t(Role::mafia)] = true;
+    }
+};
+
+// Binary serialization, for the session journal. The readers throw on invalid data.
+void WriteState(BinaryWriter &writer, const State &state);
+[[nodiscard]] State ReadState(BinaryReader &reader);
+void WriteSettings(BinaryWriter &writer, const Settings &settings);
+[[nodiscard]] Settings ReadSettings(BinaryReader &reader);
+void WriteRound(BinaryWriter &writer, const Round &round);
+[[nodiscard]] Round ReadRound(BinaryReader &reader);
@@ -0,0 +1,286 @@
+#include "touch_controller.h"
+
+#include <cmath>
+#include <utility>
+
+void TouchController::HandleEvents()
+{
+    const float drag_threshold = drag_threshold_func();
+
+    ImGuiContext &ctx = *ImGui::GetCurrentContext();
+
+    // If true, we can't scroll.
+    const bool active_id_bad =
+        ctx.ActiveIdWindow &&
+        (
+            // If not dragging a window. This is needed despite `.ConfigWindowsMoveFromTitleBarOnly == true` above,
+            //   since holding a window background still sets an active ID even with this flag.
+            // The `ctx.MovingWindow` part is what excludes "dragging" the window background with no effect.
+            (ImGui::GetActiveID() == ctx.ActiveIdWindow->MoveId && ctx.MovingWindow) ||
+            // Not dragging either scrollbar.
+            (ImGui::GetActiveID() == ImGui::GetWindowScrollbarID(ctx.ActiveIdWindow, ImGuiAxis_X)) ||
+            (ImGui::GetActiveID() == ImGui::GetWindowScrollbarID(ctx.ActiveIdWindow, ImGuiAxis_Y)) ||
+            // Not resizing a window using its corners.
+            (ImGui::GetActiveID() == ImGui::GetWindowResizeCornerID(ctx.ActiveIdWindow, 0)) ||
+            (ImGui::GetActiveID() == ImGui::GetWindowResizeCornerID(ctx.ActiveIdWindow, 1)) ||
+            // Not resizing a window using a border.
+            ctx.ActiveIdWindow->ResizeBorderHeld != -1
+        );
+
+    // If true, we can scroll.
+    const bool active_id_good =
+        !active_id_bad &&
+        ctx.ActiveIdWindow &&
+        (
+            // Trying to move a window by its body, which does nothing when `.ConfigWindowsMoveFromTitleBarOnly == true`.
+            (ImGui::GetActiveID() == ctx.ActiveIdWindow->MoveId && !ctx.MovingWindow)
+        );
+
+    // If true, we scroll only if the vertical threshold is reached before horizontal.
+    const bool active_id_vert_only = !active_id_good && !active_id_bad && ImGui::GetActiveID();
+
+    auto CheckMouseSource = [&](ImGuiMouseSource new_source)
+    {
+        if (new_source == ImGuiMouseSource_TouchScreen || new_source == ImGuiMouseSource_Pen || accept_any_input_source)
+        {
+            mouse_source = new_source;
+            return true;
+        }
+
+        return false;
+    };
+
+    ImGui::GetIO().ConfigWindowsMoveFromTitleBarOnly = true;
+
+    out_queue.resize(0);
+
+    // If the last two events are mouse moves from the same source, merges them into one.
+    // ImGui only cares about the final position anyway, and high-rate touchscreens and pens can send dozens of those per frame.
+    // Button events are never merged, so the relative order of moves and clicks stays the same.
+    auto CoalesceLastMousePos = [&]
+    {
+        if (out_queue.Size < 2)
+            return;
+
+        ImGuiInputEvent &prev_event = out_queue[out_queue.Size - 2];
+        const ImGuiInputEvent &last_event = out_queue.back();
+        if (
+            prev_event.Type != ImGuiInputEventType_MousePos ||
+            last_event.Type != ImGuiInputEventType_MousePos ||
+            prev_event.MousePos.MouseSource != last_event.MousePos.MouseSource
+        )
+            return;
+
+        // Keep the event ID of the earlier one, so the IDs stay sequential.
+        prev_event.MousePos = last_event.MousePos;
+        out_queue.pop_back();
+        event_counter--;
+    };
+
+    // Act on fake scroll.
+    if (fake_scroll)
+    {
+        if (ImGuiWindow *win = ImGui::FindWindowByID(window_id))
+        {
+            auto ApplyScroll = [&](this auto &self, ImGuiWindow &win, bool y, float value) -> void
+            {
+                if (!(win.Flags & ImGuiWindowFlags_NoScrollWithMouse))
+                {
+                    win.Scroll[y] = value;
+                    if (win.Scroll[y] < 0)
+                        win.Scroll[y] = 0;
+                    else if (win.Scroll[y] > win.ScrollMax[y])
+                        win.Scroll[y] = win.ScrollMax[y];
+                }
+
+                if (value != win.Scroll[y] && win.ParentWindow)
+                {
+                    const float parent_scroll = win.ParentWindow->Scroll[y];
+                    self(*win.ParentWindow, y, win.ParentWindow->Scroll[y] + (value - win.Scroll[y]));
+                    window_scroll_when_clicked[y] += parent_scroll - win.ParentWindow->Scroll[y];
+                }
+            };
+
+            for (bool y : {false, true})
+                ApplyScroll(*win, y, mouse_pos_when_clicked[y] - mouse_pos[y] + window_scroll_when_clicked[y]);
+        }
+    }
+
+    // Restore mouse pos after a single frame delay, after stopping the scroll.
+    if (std::exchange(once_restore_mouse_pos, false))
+    {
+        // Return the mouse to its correct position.
+        out_queue.push_back({});
+        ImGuiInputEvent &mouse_reset_pos_event = out_queue.back();
+        mouse_reset_pos_event.EventId = event_counter++;
+        mouse_reset_pos_event.Source = ImGuiInputSource_Mouse;
+        mouse_reset_pos_event.Type = ImGuiInputEventType_MousePos;
+        mouse_reset_pos_event.MousePos.MouseSource = mouse_source;
+        mouse_reset_pos_event.MousePos.PosX = mouse_pos.x;
+        mouse_reset_pos_event.MousePos.PosY = mouse_pos.y;
+    }
+
+    // Transform long tap to right click.
+    if (
+        mouse_held &&
+        !no_scroll_this_time &&
+        // Known bad IDs don't need our right click.
+        // Known good ones should be allowed, since the demo has e.g. right-clickable text labels, which we don't see and treat as dragging the window, which is good.
+        !active_id_bad &&
+        // Held long enough.
+        ImGui::GetIO().MouseDownDuration[ImGuiMouseButton_Left] > hold_duration_to_right_click &&
+        // Don't enable for pen, unless the user explicitly opts in.
+        (allow_hold_to_right_click_on_pen || mouse_source != ImGuiMouseSource_Pen)
+    )
+    {
+        mouse_held = false;
+
+        // Prevent mouse release from registering as a click.
+        ImGui::ClearActiveID();
+
+        // Release left button.
+        out_queue.push_back({});
+        ImGuiInputEvent &mouse_release_left_event = out_queue.back();
+        mouse_release_left_event.EventId = event_counter++;
+        mouse_release_left_event.Source = ImGuiInputSource_Mouse;
+        mouse_release_left_event.Type = ImGuiInputEventType_MouseButton;
+        mouse_release_left_event.MouseButton.MouseSource = mouse_source;
+        mouse_release_left_event.MouseButton.Button = ImGuiMouseButton_Left;
+        mouse_release_left_event.MouseButton.Down = false;
+
+        // Press right button.
+        out_queue.push_back({});
+        ImGuiInputEvent &mouse_press_right_event = out_queue.back();
+        mouse_press_right_event.EventId = event_counter++;
+        mouse_press_right_event.Source = ImGuiInputSource_Mouse;
+        mouse_press_right_event.Type = ImGuiInputEventType_MouseButton;
+        mouse_press_right_event.MouseButton.MouseSource = mouse_source;
+        mouse_press_right_event.MouseButton.Button = ImGuiMouseButton_Right;
+        mouse_press_right_event.MouseButton.Down = true;
+
+        // Release right button immediately, since we'll never get a release event for either the left button (because it's already considered released)
+        //   or the right button (since it's not actually held).
+        out_queue.push_back({});
+        ImGuiInputEvent &mouse_release_right_event = out_queue.back();
+        mouse_release_right_event.EventId = event_counter++;
+        mouse_release_right_event.Source = ImGuiInputSource_Mouse;
+        mouse_release_right_event.Type = ImGuiInputEventType_MouseButton;
+        mouse_release_right_event.MouseButton.MouseSource = mouse_source;
+        mouse_release_right_event.MouseButton.Button = ImGuiMouseButton_Right;
+        mouse_release_right_event.MouseButton.Down = false;
+    }
+
+    // Handle the events.
+    for (const ImGuiInputEvent &in_event : ctx.InputEventsQueue)
+    {
+        out_queue.push_back(in_event);
+        ImGuiInputEvent &out_event = out_queue.back();
+
+        if (event_counter == ImU32(-1))
+            event_counter = in_event.EventId + 1;
+        else
+            out_event.EventId = event_counter++;
+
+        if (in_event.Type == ImGuiInputEventType_MousePos)
+        {
+            if (CheckMouseSource(in_event.MousePos.MouseSource))
+            {
+                mouse_pos = ImVec2(in_event.MousePos.PosX, in_event.MousePos.PosY);
+
+                if (fake_scroll)
+                {
+                    out_queue.pop_back();
+                    event_counter--;
+                    continue;
+                }
+
+                if (
+                    mouse_held &&
+                    ctx.HoveredWindow &&
+                    !no_scroll_this_time &&
+                    !active_id_bad &&
+                    (active_id_good || ImLengthSqr(ImVec2(mouse_pos.x - mouse_pos_when_clicked.x, mouse_pos.y - mouse_pos_when_clicked.y)) > drag_threshold * drag_threshold)
+                )
+                {
+                    // For certain active widgets, triggering the horizontal threshold first disables the scroll behaviors.
+                    if (active_id_vert_only && std::abs(mouse_pos.x - mouse_pos_when_clicked.x) > std::abs(mouse_pos.y - mouse_pos_when_clicked.y))
+                    {
+                        no_scroll_this_time = true;
+
+                        // Update mouse position, since we've been eating mouse events before.
+                        ImGuiInputEvent &mouse_restore_pos_event = out_event;
+                        mouse_restore_pos_event.Source = ImGuiInputSource_Mouse;
+                        mouse_restore_pos_event.Type = ImGuiInputEventType_MousePos;
+                        mouse_restore_pos_event.MousePos.MouseSource = mouse_source;
+                        mouse_restore_pos_event.MousePos.PosX = mouse_pos.x;
+                        mouse_restore_pos_event.MousePos.PosY = mouse_pos.y;
+                        CoalesceLastMousePos();
+                        continue;
+                    }
+
+                    ImGui::ClearActiveID();
+
+                    mouse_held = false;
+                    fake_scroll = true;
+                    window_id = ctx.HoveredWindow->ID;
+                    window_scroll_when_clicked = ctx.HoveredWindow->Scroll;
+
+                    // No reading the original event beyond this point.
+
+                    // Move mouse to a dummy position.
+                    ImGuiInputEvent &mouse_dummy_pos_event = out_event;
+                    mouse_dummy_pos_event.Source = ImGuiInputSource_Mouse;
+                    mouse_dummy_pos_event.Type = ImGuiInputEventType_MousePos;
+                    mouse_dummy_pos_event.MousePos.MouseSource = mouse_source;
+                    // Move the mouse to the window corner, so if someone sends e.g. a scroll event, this window will catch it. Not sure how useful this actually is.
+                    mouse_dummy_pos_event.MousePos.PosX = ctx.HoveredWindow->Pos.x;
+                    mouse_dummy_pos_event.MousePos.PosY = ctx.HoveredWindow->Pos.y;
+                    CoalesceLastMousePos();
+                    continue;
+                }
+
+                // Undecided if we should scroll yet, eat the mouse events for now.
+                if (mouse_held && active_id_vert_only && !no_scroll_this_time)
+                {
+                    out_queue.pop_back();
+                    event_counter--;
+                    continue;
+                }
+            }
+
+            CoalesceLastMousePos();
+            continue;
+        }
+
+        if (in_event.Type == ImGuiInputEventType_MouseButton)
+        {
+            if (CheckMouseSource(in_event.MouseButton.MouseSource) && in_event.MouseButton.Button == ImGuiMouseButton_Left)
+            {
+                if (!in_event.MouseButton.Down)
+                {
+                    mouse_held = false;
+
+                    if (fake_scroll)
+                    {
+                        fake_scroll = false;
+                        once_restore_mouse_pos = true;
+                    }
+
+                    continue;
+                }
+
+                if (!mouse_held)
+                {
+                    mouse_pos_when_clicked = mouse_pos;
+                    no_scroll_this_time = false;
+                }
+
+                mouse_held = true;
+            }
+
+            continue;
+        }
+    }
+
+    ctx.InputEventsQueue.swap(out_queue);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <imgui.h>
+#include <imgui_internal.h>
+
+#include <functional>
+
+// Rewrites the ImGui input events to make touchscreens usable: dragging anywhere scrolls the window under the finger, and holding imitates a right click.
+struct TouchController
+{
+    // Public config: [
+
+    // if true, accept even mouse input, noy only touch. Good for debugging.
+    bool accept_any_input_source = false;
+
+    // How long to hold to imitate right click.
+    float hold_duration_to_right_click = 0.5f;
+
+    // By default, if the input device is a pen, hold-to-right-click is disabled,
+    //   since pens should usually have their own ways to right click.
+    // Setting this to true enables it.
+    bool allow_hold_to_right_click_on_pen = false;
+
+    // How far you must move finger to trigger drag.
+    std::function<float()> drag_threshold_func = []{return ImGui::GetTextLineHeight();};
+
+    // ]
+
+
+    // Here we initialize everything, to silence warnings on missing fields when using designated initialization.
+
+    // We replace the event IDs with our own, since we're inserting new events, and can't otherwise maintain sequental IDs.
+    ImU32 event_counter = ImU32(-1);
+
+    ImVec2 mouse_pos{};
+    ImGuiMouseSource mouse_source{};
+    ImVec2 mouse_pos_when_clicked{};
+    ImGuiID window_id = 0;
+    ImVec2 window_scroll_when_clicked{};
+    bool mouse_held = false;
+    bool fake_scroll = false;
+    bool once_restore_mouse_pos = false;
+    bool no_scroll_this_time = false;
+
+    // The rewritten events. Persistent to reuse the memory, it swaps storage with `InputEventsQueue` every frame.
+    ImVector<ImGuiInputEvent> out_queue{};
+
+
+    // If true, don't pause your rendering loop.
+    [[nodiscard]] bool ShouldRedraw() const
+    {
+        return mouse_held;
+    }
+
+    // Call this before `ImGui::NewFrame()`, after all the events were passed to the backend.
+    // Rewrites `ImGuiContext::InputEventsQueue` to implement touch scrolling and hold-to-right-click.
+    void HandleEvents();
+};
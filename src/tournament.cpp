@@ -0,0 +1,144 @@
+#include "tournament.h"
+
+#include "binary_io.h"
+#include "random.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+std::vector<std::size_t> Tournament::PlayersAtTable(std::size_t table) const
+{
+    std::vector<std::size_t> ret;
+    if (seatings.empty())
+        return ret;
+
+    const std::vector<std::uint16_t> &seating = seatings.back();
+    for (std::size_t i = 0; i < seating.size(); i++)
+    {
+        if (seating[i] == table)
+            ret.push_back(i);
+    }
+    return ret;
+}
+
+std::vector<std::uint16_t> Tournament::ScheduleNextRound() const
+{
+    const std::size_t num_players = players.size();
+    if (num_tables == 0 || num_tables > max_tables || num_tables > num_players)
+        throw std::runtime_error("Invalid number of tables.");
+
+    // The players at each table in each past round, sorted by table: table T of round R is `past_players[R][past_begins[R][T]..past_begins[R][T+1]]`.
+    std::vector<std::vector<std::uint32_t>> past_players(seatings.size());
+    std::vector<std::vector<std::uint32_t>> past_begins(seatings.size());
+    for (std::size_t r = 0; r < seatings.size(); r++)
+    {
+        const std::vector<std::uint16_t> &seating = seatings[r];
+        std::uint16_t max_table = 0;
+        for (std::uint16_t table : seating)
+            max_table = std::max(max_table, table);
+
+        std::vector<std::uint32_t> &begins = past_begins[r];
+        begins.assign(std::size_t(max_table) + 2, 0);
+        for (std::uint16_t table : seating)
+            begins[std::size_t(table) + 1]++;
+        std::partial_sum(begins.begin(), begins.end(), begins.begin());
+
+        std::vector<std::uint32_t> ends(begins.begin(), begins.end() - 1);
+        past_players[r].resize(seating.size());
+        for (std::size_t i = 0; i < seating.size(); i++)
+            past_players[r][ends[seating[i]]++] = std::uint32_t(i);
+    }
+
+    constexpr std::uint16_t unseated = std::numeric_limits<std::uint16_t>::max();
+    std::vector<std::uint16_t> ret(num_players, unseated);
+    std::vector<std::size_t> table_sizes(num_tables);
+
+    std::vector<std::uint32_t> order(num_players);
+    std::iota(order.begin(), order.end(), 0);
+    Rng rng(0, seatings.size());
+    for (std::size_t i = num_players; i > 1; i--)
+        std::swap(order[i - 1], order[rng.Below(std::uint32_t(i))]);
+
+    // Per table, how many of the players already seated there the current player has met. Only the touched entries are reset.
+    std::vector<int> meetings(num_tables);
+    std::vector<std::uint16_t> touched_tables;
+
+    for (std::uint32_t player : order)
+    {
+        for (std::size_t r = 0; r < seatings.size(); r++)
+        {
+            const std::size_t past_table = seatings[r][player];
+            for (std::uint32_t i = past_begins[r][past_table]; i < past_begins[r][past_table + 1]; i++)
+            {
+                const std::uint16_t table = ret[past_players[r][i]];
+                if (table != unseated && meetings[table]++ == 0)
+                    touched_tables.push_back(table);
+            }
+        }
+
+        // The first `num_players % num_tables` tables get one extra player.
+        std::size_t best_table = 0;
+        bool found = false;
+        for (std::size_t table = 0; table < num_tables; table++)
+        {
+            const std::size_t capacity = num_players / num_tables + (table < num_players % num_tables);
+            if (table_sizes[table] >= capacity)
+                continue;
+
+            if (!found || meetings[table] < meetings[best_table] || (meetings[table] == meetings[best_table] && table_sizes[table] < table_sizes[best_table]))
+            {
+                best_table = table;
+                found = true;
+            }
+        }
+
+        ret[player] = std::uint16_t(best_table);
+        table_sizes[best_table]++;
+
+        for (std::uint16_t table : touched_tables)
+            meetings[table] = 0;
+        touched_tables.clear();
+    }
+
+    return ret;
+}
+
+void WriteTournament(BinaryWriter &writer, const Tournament &tournament)
+{
+    writer.WriteVarint(tournament.players.size());
+    for (const std::string &player : tournament.players)
+        writer.WriteString(player);
+    writer.WriteVarint(tournament.num_tables);
+
+    writer.WriteVarint(tournament.seatings.size());
+    for (const std::vector<std::uint16_t> &seating : tournament.seatings)
+    {
+        writer.WriteVarint(seating.size());
+        for (std::uint16_t table : seating)
+            writer.WriteVarint(table);
+    }
+}
+
+Tournament ReadTournament(BinaryReader &reader)
+{
+    Tournament ret;
+
+    ret.players.resize(std::size_t(reader.ReadVarint()));
+    for (std::string &player : ret.players)
+        player = reader.ReadString();
+    ret.num_tables = reader.ReadIndex(Tournament::max_tables + 1);
+
+    ret.seatings.resize(std::size_t(reader.ReadVarint()));
+    for (std::vector<std::uint16_t> &seating : ret.seatings)
+    {
+        if (reader.ReadVarint() != ret.players.size())
+            throw std::runtime_error("The saved tournament doesn't seat all its players.");
+        seating.resize(ret.players.size());
+        for (std::uint16_t &table : seating)
+            table = std::uint16_t(reader.ReadIndex(ret.num_tables));
+    }
+
+    return ret;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class BinaryReader;
+class BinaryWriter;
+
+// A tournament: a pool of players who play at several tables at once, reseated between the rounds so that they meet new opponents.
+// The tables themselves are `Round`s, owned by the game. This only remembers who sat where.
+struct Tournament
+{
+    // At most this many tables, so that a table index fits in `std::uint16_t`.
+    static constexpr std::size_t max_tables = 0xffff;
+
+    // The names of the players. The pool is fixed when the tournament starts.
+    std::vector<std::string> players;
+    std::size_t num_tables = 0;
+    // Per round, the table of each player. The last one is the current seating. Empty if there's no tournament.
+    std::vector<std::vector<std::uint16_t>> seatings;
+
+    [[nodiscard]] bool IsActive() const
+    {
+        return !seatings.empty();
+    }
+
+    // Returns the players at a table in the current round, as indices into `players`.
+    [[nodiscard]] std::vector<std::size_t> PlayersAtTable(std::size_t table) const;
+
+    // Seats the players for the next round, and returns the new seating. The table sizes differ by at most one.
+    // Each player in turn takes the table where they've already met the fewest of the players seated there so far.
+    // The order of the players is shuffled each round (deterministically), so that the same players don't always pick first.
+    // O(players * (rounds * players per table + tables)), without a players-by-players matrix, so it's fine for thousands of players.
+    [[nodiscard]] std::vector<std::uint16_t> ScheduleNextRound() const;
+};
+
+// Binary serialization, for the session journal. The reader throws on invalid data.
+void WriteTournament(BinaryWriter &writer, const Tournament &tournament);
+[[nodiscard]] Tournament ReadTournament(BinaryReader &reader);
@@ -0,0 +1,152 @@
+#include "trace.h"
+
+#if ENABLE_TRACING
+#include <SDL3/SDL_iostream.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Trace
+{
+    // `Save()` can read an event while its thread overwrites it, so the fields are atomic, and `seq` tells if the event changed while we read it (a seqlock).
+    // Relaxed atomics compile to plain loads and stores on the platforms we care about.
+    struct Event
+    {
+        // The event index plus one, or 0 while the event is being written.
+        std::atomic<std::uint64_t> seq = 0;
+        std::atomic<const char *> name = nullptr;
+        std::atomic<long long> begin_ns = 0;
+        std::atomic<long long> end_ns = 0;
+    };
+
+    // Only the owning thread writes to the buffer, and publishes the events by incrementing `num_events`.
+    // When the buffer is full, the oldest events are overwritten.
+    struct ThreadBuffer
+    {
+        static constexpr std::size_t capacity = 1 << 16;
+
+        std::array<Event, capacity> events;
+        std::atomic<std::uint64_t> num_events = 0;
+        std::atomic<const char *> name = nullptr;
+        int thread_index = 0;
+    };
+
+    static std::mutex buffers_mutex;
+    // Those are protected by the mutex: [
+    static std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    // The buffers of the threads that have exited. We start many short-lived threads (`std::async` and such), so those are reused rather than leaked.
+    // A reused buffer keeps the events of its previous thread, under the same thread index, which is fine since the threads didn't overlap.
+    static std::vector<ThreadBuffer *> free_buffers;
+    // ]
+
+    // Returns the buffer to `free_buffers` when its thread exits.
+    struct ThreadBufferOwner
+    {
+        ThreadBuffer *buffer = nullptr;
+
+        ~ThreadBufferOwner()
+        {
+            buffer->name.store(nullptr, std::memory_order_relaxed);
+            std::lock_guard lock(buffers_mutex);
+            free_buffers.push_back(buffer);
+        }
+    };
+
+    [[nodiscard]] static ThreadBuffer &GetThreadBuffer()
+    {
+        // Locking only happens once per thread.
+        static thread_local ThreadBufferOwner owner{[]{
+            std::lock_guard lock(buffers_mutex);
+            if (!free_buffers.empty())
+            {
+                ThreadBuffer *ret = free_buffers.back();
+                free_buffers.pop_back();
+                return ret;
+            }
+            ThreadBuffer &ret = *buffers.emplace_back(std::make_unique<ThreadBuffer>());
+            ret.thread_index = int(buffers.size());
+            return &ret;
+        }()};
+        return *owner.buffer;
+    }
+
+    [[nodiscard]] static long long NowNs()
+    {
+        static const auto start = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    Zone::Zone(const char *name) : name(name), begin_ns(NowNs()) {}
+
+    Zone::~Zone()
+    {
+        ThreadBuffer &buffer = GetThreadBuffer();
+        const std::uint64_t index = buffer.num_events.load(std::memory_order_relaxed);
+        Event &event = buffer.events[index % ThreadBuffer::capacity];
+        event.seq.store(0, std::memory_order_relaxed);
+        // If `Save()` sees any of the stores below, this makes sure it also sees the 0 above when it rechecks `seq`.
+        std::atomic_thread_fence(std::memory_order_release);
+        event.name.store(name, std::memory_order_relaxed);
+        event.begin_ns.store(begin_ns, std::memory_order_relaxed);
+        event.end_ns.store(NowNs(), std::memory_order_relaxed);
+        event.seq.store(index + 1, std::memory_order_release);
+        buffer.num_events.store(index + 1, std::memory_order_release);
+    }
+
+    void SetThreadName(const char *name)
+    {
+        GetThreadBuffer().name.store(name, std::memory_order_relaxed);
+    }
+
+    bool Save(const std::string &path)
+    {
+        std::string json = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+        bool first = true;
+        char line[512];
+
+        std::lock_guard lock(buffers_mutex);
+        for (const std::unique_ptr<ThreadBuffer> &buffer : buffers)
+        {
+            if (const char *name = buffer->name.load(std::memory_order_relaxed))
+            {
+                std::snprintf(line, sizeof line, "%s{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n", buffer->thread_index, name);
+                json += line;
+                first = false;
+            }
+
+            // The owning thread can keep writing while we read. If it wraps around the buffer during that, the oldest events get overwritten,
+            //   and we skip the ones that changed while we were reading them.
+            const std::uint64_t end = buffer->num_events.load(std::memory_order_acquire);
+            const std::uint64_t begin = end > ThreadBuffer::capacity ? end - ThreadBuffer::capacity : 0;
+            for (std::uint64_t i = begin; i < end; i++)
+            {
+                const Event &event = buffer->events[i % ThreadBuffer::capacity];
+                if (event.seq.load(std::memory_order_acquire) != i + 1)
+                    continue;
+                const char *name = event.name.load(std::memory_order_relaxed);
+                const long long begin_ns = event.begin_ns.load(std::memory_order_relaxed);
+                const long long end_ns = event.end_ns.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (event.seq.load(std::memory_order_relaxed) != i + 1)
+                    continue;
+
+                // Complete events, with the timestamps in microseconds.
+                std::snprintf(line, sizeof line, "%s{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"name\":\"%s\",\"ts\":%.3f,\"dur\":%.3f}",
+                    first ? "" : ",\n", buffer->thread_index, name, double(begin_ns) / 1000, double(end_ns - begin_ns) / 1000
+                );
+                json += line;
+                first = false;
+            }
+        }
+
+        json += "\n]}\n";
+        return SDL_SaveFile(path.c_str(), json.data(), json.size());
+    }
+}
+#endif
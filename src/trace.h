@@ -0,0 +1,42 @@
+#pragma once
+
+// Scoped instrumentation zones, which can be saved as a Chrome trace (loadable in `chrome://tracing` and Perfetto).
+// Enabled in the `profile` build mode. When disabled, `TRACE_ZONE()` expands to nothing.
+#ifndef ENABLE_TRACING
+#define ENABLE_TRACING 0
+#endif
+
+#if ENABLE_TRACING
+#include <string>
+
+namespace Trace
+{
+    // Records the time from construction to destruction. The name must be a string literal, or otherwise must outlive the trace.
+    class Zone
+    {
+        const char *name;
+        long long begin_ns;
+
+      public:
+        Zone(const char *name);
+        Zone(const Zone &) = delete;
+        Zone &operator=(const Zone &) = delete;
+        ~Zone();
+    };
+
+    // Names the current thread in the trace. The name must outlive the trace.
+    void SetThreadName(const char *name);
+
+    // Writes the zones recorded so far (up to a limit per thread, the older ones get overwritten) to a file.
+    // Returns false on failure, then `SDL_GetError()` has the details.
+    [[nodiscard]] bool Save(const std::string &path);
+}
+
+#define TRACE_CAT_(x, y) x##y
+#define TRACE_CAT(x, y) TRACE_CAT_(x, y)
+#define TRACE_ZONE(name) ::Trace::Zone TRACE_CAT(trace_zone_, __LINE__)(name)
+#define TRACE_THREAD_NAME(name) ::Trace::SetThreadName(name)
+#else
+#define TRACE_ZONE(name) (void)0
+#define TRACE_THREAD_NAME(name) (void)0
+#endif
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "commands.h"
+
+#include <cstddef>
+#include <deque>
+#include <optional>
+#include <utility>
+
+// The undo and redo stacks. Each entry is the inverse of a command that was executed, so undoing it is just executing the entry.
+// When the total memory usage exceeds the limit, the oldest entries are dropped.
+class UndoHistory
+{
+    std::deque<Command> undo_stack;
+    std::deque<Command> redo_stack;
+
+    // The total `CommandMemoryUsage()` of both stacks.
+    std::size_t memory_usage = 0;
+    std::size_t memory_limit = 0;
+
+    void Trim()
+    {
+        // Drop the oldest undo entries first, then the farthest redo entries.
+        while (memory_usage > memory_limit && !undo_stack.empty())
+        {
+            memory_usage -= CommandMemoryUsage(undo_stack.front());
+            undo_stack.pop_front();
+        }
+        while (memory_usage > memory_limit && !redo_stack.empty())
+        {
+            memory_usage -= CommandMemoryUsage(redo_stack.front());
+            redo_stack.pop_front();
+        }
+    }
+
+    [[nodiscard]] std::optional<Command> Pop(std::deque<Command> &stack)
+    {
+        if (stack.empty())
+            return {};
+        Command ret = std::move(stack.back());
+        stack.pop_back();
+        memory_usage -= CommandMemoryUsage(ret);
+        return ret;
+    }
+
+    void Push(std::deque<Command> &stack, Command command)
+    {
+        memory_usage += CommandMemoryUsage(command);
+        stack.push_back(std::move(command));
+        Trim();
+    }
+
+  public:
+    UndoHistory(std::size_t memory_limit = 1 << 20) : memory_limit(memory_limit) {}
+
+    [[nodiscard]] std::size_t MemoryLimit() const
+    {
+        return memory_limit;
+    }
+
+    void SetMemoryLimit(std::size_t new_limit)
+    {
+        memory_limit = new_limit;
+        Trim();
+    }
+
+    [[nodiscard]] bool CanUndo() const
+    {
+        return !undo_stack.empty();
+    }
+
+    [[nodiscard]] bool CanRedo() const
+    {
+        return !redo_stack.empty();
+    }
+
+    void Clear()
+    {
+        undo_stack.clear();
+        redo_stack.clear();
+        memory_usage = 0;
+    }
+
+    void ClearRedo()
+    {
+        while (!redo_stack.empty())
+            (void)Pop(redo_stack);
+    }
+
+    // Call this after executing a new command. This clears the redo stack.
+    void AddUndo(Command inverse)
+    {
+        ClearRedo();
+        Push(undo_stack, std::move(inverse));
+    }
+
+    // Returns the command to execute to undo the last change, if any.
+    [[nodiscard]] std::optional<Command> TakeUndo()
+    {
+        return Pop(undo_stack);
+    }
+
+    // Call this with the inverse of the command returned by `TakeUndo()`.
+    void AddRedo(Command inverse)
+    {
+        Push(redo_stack, std::move(inverse));
+    }
+
+    // Returns the command to execute to redo the last undone change, if any.
+    [[nodiscard]] std::optional<Command> TakeRedo()
+    {
+        return Pop(redo_stack);
+    }
+
+    // Call this with the inverse of the command returned by `TakeRedo()`. Unlike `AddUndo()`, this keeps the redo stack.
+    void AddUndoFromRedo(Command inverse)
+    {
+        Push(undo_stack, std::move(inverse));
+    }
+};
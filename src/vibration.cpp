@@ -0,0 +1,65 @@
+#include "vibration.h"
+
+#include <SDL3/SDL_gamepad.h>
+#include <SDL3/SDL_haptic.h>
+#include <SDL3/SDL_init.h>
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_stdinc.h>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten/html5.h>
+#endif
+
+#ifndef __EMSCRIPTEN__
+// Opens the first haptic device that can rumble. On Android this is usually the phone's own vibrator.
+// The haptic subsystem is only initialized here, on the first alert, since most sessions never need it.
+[[nodiscard]] static SDL_Haptic *OpenHaptic()
+{
+    if (!SDL_InitSubSystem(SDL_INIT_HAPTIC))
+    {
+        SDL_Log("Unable to initialize the haptic subsystem: %s", SDL_GetError());
+        return nullptr;
+    }
+
+    SDL_Haptic *ret = nullptr;
+    int num_haptics = 0;
+    if (SDL_HapticID *ids = SDL_GetHaptics(&num_haptics))
+    {
+        for (int i = 0; i < num_haptics && !ret; i++)
+        {
+            SDL_Haptic *haptic = SDL_OpenHaptic(ids[i]);
+            if (!haptic)
+                continue;
+            if (SDL_InitHapticRumble(haptic))
+                ret = haptic;
+            else
+                SDL_CloseHaptic(haptic);
+        }
+        SDL_free(ids);
+    }
+    return ret;
+}
+#endif
+
+void Vibrate(std::uint32_t duration_ms)
+{
+    #ifdef __EMSCRIPTEN__
+    emscripten_vibrate(int(duration_ms));
+    #else
+    static SDL_Haptic *const haptic = OpenHaptic();
+    if (haptic)
+        SDL_PlayHapticRumble(haptic, 1, duration_ms);
+
+    // The ImGui backend opens the gamepads, we only borrow them.
+    int num_gamepads = 0;
+    if (SDL_JoystickID *ids = SDL_GetGamepads(&num_gamepads))
+    {
+        for (int i = 0; i < num_gamepads; i++)
+        {
+            if (SDL_Gamepad *gamepad = SDL_GetGamepadFromID(ids[i]))
+                SDL_RumbleGamepad(gamepad, 0xffff, 0xffff, duration_ms);
+        }
+        SDL_free(ids);
+    }
+    #endif
+}
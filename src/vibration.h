@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstdint>
+
+// Vibrates the phone (on Android and in the mobile browsers) and rumbles the connected gamepads, to alert the moderator.
+// Does nothing where that's not supported. Doesn't wait for the vibration to finish.
+void Vibrate(std::uint32_t duration_ms);
@@ -0,0 +1,238 @@
+// Queries the game archive (see `archive.h`) from the command line, with the same code as the statistics in the app.
+// Prints the results as one JSON object.
+// The app keeps its archive in its preferences directory, as `archive`.
+// Usage: `archive_query <archive> [--min-players N] [--max-players N] [--since UNIX_TIME] [--until UNIX_TIME] [--threads N] [--runs N] [--ratings N]`.
+//   `--runs N` repeats the query and reports the fastest run.
+//   `--ratings N` computes the player ratings instead (see `rating.h`), and prints the top N players.
+// Or: `archive_query <archive> --generate N [--seed N]` appends N random games, to benchmark on.
+
+#include "archive.h"
+#include "binary_io.h"
+#include "rating.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct QueryOptions
+{
+    std::string archive_path;
+    ArchiveQuery query;
+    int num_threads = 0;
+    int num_runs = 1;
+    // If not negative, compute the ratings and print this many top players.
+    int num_top_rated = -1;
+
+    int num_games_to_generate = 0;
+    unsigned seed = 1;
+};
+
+static const char *const faction_names[] = {"peaceful", "mafia", "yakuza", "killer", "none"};
+static const char *const targeting_names[] = {"captain", "sheriff", "prostitute", "mafia_boss"};
+
+// Appends random games that look roughly like real ones.
+static void Generate(const QueryOptions &options)
+{
+    std::mt19937 rng(options.seed);
+    auto Random = [&](int min, int max){return std::uniform_int_distribution<int>(min, max)(rng);};
+
+    std::FILE *file = std::fopen(options.archive_path.c_str(), "ab");
+    if (!file)
+        throw std::runtime_error("Unable to open `" + options.archive_path + "` for writing.");
+
+    const std::int64_t start_time = 1'700'000'000;
+
+    std::vector<ArchivedGame> games;
+    BinaryWriter writer;
+    for (int i = 0; i < options.num_games_to_generate; i++)
+    {
+        ArchivedGame &game = games.emplace_back();
+        game.time = start_time + i * 600;
+        game.num_players = Random(6, 20);
+        game.num_days = Random(2, 8);
+
+        for (int j = 0; j < game.num_players; j++)
+        {
+            ArchivedPlayer &pl = game.players.emplace_back();
+            pl.name = "Игрок " + std::to_string(Random(1, 200));
+            pl.role = j < 4 ? Role(Random(0, int(Role::_count) - 1)) : j % 4 == 0 ? Role::mafia : Role::none;
+            pl.last_day = Random(0, game.num_days - 1);
+            pl.survived = pl.last_day == game.num_days - 1;
+            for (int &times : pl.times_targeted)
+                times = std::max(0, Random(-4, 3));
+        }
+
+        std::array<int, int(Faction::_count)> survivors{};
+        for (const ArchivedPlayer &pl : game.players)
+        {
+            if (pl.survived)
+                survivors[std::size_t(RoleToFaction(pl.role))]++;
+        }
+        const int num_factions_left = int(std::count_if(survivors.begin(), survivors.end(), [](int n){return n > 0;}));
+        game.winner = num_factions_left == 1 ? int(std::find_if(survivors.begin(), survivors.end(), [](int n){return n > 0;}) - survivors.begin()) : int(Faction::_count);
+
+        if (games.size() == ArchiveWriter::games_per_block || i + 1 == options.num_games_to_generate)
+        {
+            writer.Clear();
+            WriteArchiveBlock(writer, games);
+            if (std::fwrite(writer.Data().data(), 1, writer.Data().size(), file) != writer.Data().size())
+                throw std::runtime_error("Unable to write to `" + options.archive_path + "`.");
+            games.clear();
+        }
+    }
+
+    std::fclose(file);
+}
+
+static void Query(const QueryOptions &options)
+{
+    const auto time_before_open = std::chrono::steady_clock::now();
+    const Archive archive(options.archive_path);
+    const auto time_after_open = std::chrono::steady_clock::now();
+
+    ArchiveStats stats;
+    double best_query_ms = 0;
+    for (int i = 0; i < options.num_runs; i++)
+    {
+        const auto time_before = std::chrono::steady_clock::now();
+        stats = RunArchiveQuery(archive, options.query, options.num_threads);
+        const double query_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - time_before).count();
+        best_query_ms = i == 0 ? query_ms : std::min(best_query_ms, query_ms);
+    }
+
+    std::printf("{\"blocks\":%d,\"valid_bytes\":%llu,\"open_ms\":%.3f,\"query_ms\":%.3f,\"games\":%lld,\"players\":%lld,",
+        int(archive.Blocks().size()), (unsigned long long)archive.ValidSize(),
+        std::chrono::duration<double, std::milli>(time_after_open - time_before_open).count(), best_query_ms,
+        (long long)stats.num_games, (long long)stats.num_players
+    );
+
+    // Wins by the number of players. The last bucket also has the larger games.
+    std::printf("\"wins_by_players\":[");
+    bool first = true;
+    for (std::size_t i = 0; i < stats.games_won.size(); i++)
+    {
+        std::int64_t total = 0;
+        for (std::int64_t count : stats.games_won[i])
+            total += count;
+        if (total == 0)
+            continue;
+
+        std::printf("%s{\"players\":%d,\"games\":%lld", first ? "" : ",", int(i), (long long)total);
+        first = false;
+        for (std::size_t j = 0; j < stats.games_won[i].size(); j++)
+            std::printf(",\"%s\":%lld", faction_names[j], (long long)stats.games_won[i][j]);
+        std::printf("}");
+    }
+    std::printf("],");
+
+    std::printf("\"sheriff_checks\":%lld,\"sheriff_hits\":%lld,", (long long)stats.sheriff_checks, (long long)stats.sheriff_hits);
+
+    // Survival by the number of times targeted.
+    std::printf("\"targeting\":{");
+    for (std::size_t i = 0; i < stats.targeting.size(); i++)
+    {
+        const ArchiveStats::TargetingStats &target_stats = stats.targeting[i];
+        std::printf("%s\"%s\":{\"players\":[", i == 0 ? "" : ",", targeting_names[i]);
+        for (std::size_t j = 0; j < target_stats.players.size(); j++)
+            std::printf("%s%lld", j == 0 ? "" : ",", (long long)target_stats.players[j]);
+        std::printf("],\"survived\":[");
+        for (std::size_t j = 0; j < target_stats.survived.size(); j++)
+            std::printf("%s%lld", j == 0 ? "" : ",", (long long)target_stats.survived[j]);
+        std::printf("],\"correlation\":%.4f}", target_stats.correlation.Coefficient());
+    }
+    std::printf("}}\n");
+}
+
+static void ComputeRatings(const QueryOptions &options)
+{
+    const Archive archive(options.archive_path);
+
+    Ratings ratings;
+    double best_ms = 0;
+    for (int i = 0; i < options.num_runs; i++)
+    {
+        const auto time_before = std::chrono::steady_clock::now();
+        ratings = Ratings::Compute(archive, options.query, options.num_threads);
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - time_before).count();
+        best_ms = i == 0 ? ms : std::min(best_ms, ms);
+    }
+
+    std::vector<NameId> players(ratings.NumPlayers());
+    for (std::size_t i = 0; i < players.size(); i++)
+        players[i] = NameId(i);
+    std::sort(players.begin(), players.end(), [&](NameId a, NameId b){return ratings.Rating(a) > ratings.Rating(b);});
+    players.resize(std::min(players.size(), std::size_t(options.num_top_rated)));
+
+    std::printf("{\"ratings_ms\":%.3f,\"players\":%d,\"top\":[", best_ms, int(ratings.NumPlayers()));
+    for (std::size_t i = 0; i < players.size(); i++)
+    {
+        // The names are user input, escape them.
+        std::string name;
+        for (char ch : ratings.Name(players[i]))
+        {
+            if (ch == '"' || ch == '\\')
+                name += '\\';
+            if ((unsigned char)ch >= 0x20)
+                name += ch;
+        }
+        std::printf("%s{\"name\":\"%s\",\"rating\":%.1f,\"games\":%d}", i == 0 ? "" : ",", name.c_str(), ratings.Rating(players[i]), ratings.NumGames(players[i]));
+    }
+    std::printf("]}\n");
+}
+
+int main(int argc, char **argv)
+{
+    QueryOptions options;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string_view arg = argv[i];
+        if (!arg.starts_with("--"))
+        {
+            options.archive_path = arg;
+            continue;
+        }
+
+        if (i + 1 >= argc)
+            throw std::runtime_error("Expected a value after `" + std::string(arg) + "`.");
+
+        if (arg == "--min-players")
+            options.query.min_players = std::atoi(argv[++i]);
+        else if (arg == "--max-players")
+            options.query.max_players = std::atoi(argv[++i]);
+        else if (arg == "--since")
+            options.query.min_time = std::atoll(argv[++i]);
+        else if (arg == "--until")
+            options.query.max_time = std::atoll(argv[++i]);
+        else if (arg == "--threads")
+            options.num_threads = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--runs")
+            options.num_runs = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--ratings")
+            options.num_top_rated = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--generate")
+            options.num_games_to_generate = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--seed")
+            options.seed = unsigned(std::atoi(argv[++i]));
+        else
+            throw std::runtime_error("Unknown argument: `" + std::string(arg) + "`.");
+    }
+
+    if (options.archive_path.empty())
+        throw std::runtime_error("Usage: `archive_query <archive> [--min-players N] [--max-players N] [--since UNIX_TIME] [--until UNIX_TIME] [--threads N] [--runs N] [--ratings N]`, or `archive_query <archive> --generate N [--seed N]`.");
+
+    if (options.num_games_to_generate > 0)
+        Generate(options);
+    else if (options.num_top_rated >= 0)
+        ComputeRatings(options);
+    else
+        Query(options);
+}
@@ -0,0 +1,210 @@
+// A headless benchmark for `BasicGame::Tick()`. Runs the game without a window or a renderer, on synthetic player lists.
+// Prints one JSON object per scenario to stdout (JSON Lines), to be compared between versions.
+// Usage: `bench [--frames N] [--warmup N] [--font path/to/font.ttf]`.
+
+#include "alloc_counter.h"
+#include "game.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct BenchOptions
+{
+    int num_frames = 2000;
+    // Those aren't measured. The first frames build the font atlas and allocate the buffers.
+    int num_warmup_frames = 60;
+    std::string font_path = "assets/NotoSans.ttf";
+};
+
+struct RoleConfig
+{
+    std::string_view name;
+    Role (*get_role)(int player_index);
+};
+
+static const RoleConfig role_configs[] = {
+    {"peaceful", [](int i){(void)i; return Role::none;}},
+    {"full", [](int i)
+    {
+        // One of each special role, and every 4th player is mafia.
+        constexpr Role special_roles[] = {Role::mafia_boss, Role::sheriff, Role::captain, Role::prostitute, Role::killer, Role::yakuza};
+        if (i < int(std::size(special_roles)))
+            return special_roles[i];
+        return i % 4 == 0 ? Role::mafia : Role::none;
+    }},
+};
+
+static const int roster_sizes[] = {10, 100, 1000, 10000};
+
+// We're the renderer, so we have to acknowledge the texture requests. Nothing is actually uploaded anywhere.
+static void UpdateTextures()
+{
+    for (ImTextureData *tex : ImGui::GetPlatformIO().Textures)
+    {
+        switch (tex->Status)
+        {
+            case ImTextureStatus_WantCreate:
+                tex->SetTexID(ImTextureID(1));
+                tex->SetStatus(ImTextureStatus_OK);
+                break;
+            case ImTextureStatus_WantUpdates:
+                tex->SetStatus(ImTextureStatus_OK);
+                break;
+            case ImTextureStatus_WantDestroy:
+                tex->SetTexID(ImTextureID_Invalid);
+                tex->SetStatus(ImTextureStatus_Destroyed);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+[[nodiscard]] static double Percentile(const std::vector<double> &sorted, double fraction)
+{
+    return sorted[std::min(sorted.size() - 1, std::size_t(double(sorted.size()) * fraction))];
+}
+
+static void RunScenario(const BenchOptions &bench_options, int num_players, const RoleConfig &role_config)
+{
+    GameOptions game_options;
+    game_options.persist_session = false;
+    for (int i = 0; i < num_players; i++)
+        game_options.players.push_back({.name = "Игрок " + std::to_string(i + 1), .role = role_config.get_role(i)});
+
+    #if COUNT_ALLOCATIONS
+    ImGui::SetAllocatorFunctions(CountingImGuiAlloc, CountingImGuiFree);
+    #endif
+    ImGui::CreateContext();
+
+    ImGuiIO &io = ImGui::GetIO();
+    io.IniFilename = nullptr;
+    io.BackendFlags |= ImGuiBackendFlags_RendererHasTextures | ImGuiBackendFlags_RendererHasVtxOffset;
+    // Same as the default window size in `main.cpp`, at 100% display scale.
+    io.DisplaySize = ImVec2(750, 1200);
+    io.DeltaTime = 1 / 60.f;
+
+    ImGui::StyleColorsDark();
+    ImGui::GetStyle().ScaleAllSizes(1.5f);
+    ImGui::GetStyle().FontScaleDpi = 1.5f;
+
+    if (std::FILE *file = std::fopen(bench_options.font_path.c_str(), "rb"))
+    {
+        std::fclose(file);
+        io.Fonts->AddFontFromFileTTF(bench_options.font_path.c_str());
+    }
+    else
+    {
+        std::fprintf(stderr, "Unable to open `%s`, using the default font. The results won't be comparable to the ones with the real font.\n", bench_options.font_path.c_str());
+        io.Fonts->AddFontDefault();
+    }
+
+    std::unique_ptr<BasicGame> game = MakeGame(game_options);
+
+    std::vector<double> frame_times_us;
+    frame_times_us.reserve(std::size_t(bench_options.num_frames));
+    std::uint64_t max_frame_allocations = 0;
+    std::uint64_t total_allocations = 0;
+
+    for (int frame = 0; frame < bench_options.num_warmup_frames + bench_options.num_frames; frame++)
+    {
+        #if COUNT_ALLOCATIONS
+        const std::uint64_t allocations_before = GetNumAllocations();
+        #endif
+        const auto time_before = std::chrono::steady_clock::now();
+
+        ImGui::NewFrame();
+        game->Tick();
+        ImGui::Render();
+
+        const auto time_after = std::chrono::steady_clock::now();
+        #if COUNT_ALLOCATIONS
+        const std::uint64_t frame_allocations = GetNumAllocations() - allocations_before;
+        #endif
+
+        UpdateTextures();
+
+        if (frame >= bench_options.num_warmup_frames)
+        {
+            frame_times_us.push_back(std::chrono::duration<double, std::micro>(time_after - time_before).count());
+            #if COUNT_ALLOCATIONS
+            total_allocations += frame_allocations;
+            max_frame_allocations = std::max(max_frame_allocations, frame_allocations);
+            #endif
+        }
+    }
+
+    const ImDrawData &draw_data = *ImGui::GetDrawData();
+
+    std::vector<double> sorted = frame_times_us;
+    std::sort(sorted.begin(), sorted.end());
+    double mean = 0;
+    for (double t : sorted)
+        mean += t;
+    mean /= double(sorted.size());
+
+    std::printf(
+        "{\"players\":%d,\"roles\":\"%.*s\",\"frames\":%d,"
+        "\"frame_us_mean\":%.3f,\"frame_us_p50\":%.3f,\"frame_us_p90\":%.3f,\"frame_us_p99\":%.3f,\"frame_us_max\":%.3f,"
+        "\"draw_lists\":%d,\"vertices\":%d,\"indices\":%d,",
+        num_players, int(role_config.name.size()), role_config.name.data(), bench_options.num_frames,
+        mean, Percentile(sorted, 0.5), Percentile(sorted, 0.9), Percentile(sorted, 0.99), sorted.back(),
+        draw_data.CmdListsCount, draw_data.TotalVtxCount, draw_data.TotalIdxCount
+    );
+    #if COUNT_ALLOCATIONS
+    std::printf("\"allocations\":%llu,\"max_frame_allocations\":%llu}\n", (unsigned long long)total_allocations, (unsigned long long)max_frame_allocations);
+    #else
+    std::printf("\"allocations\":null,\"max_frame_allocations\":null}\n");
+    #endif
+    std::fflush(stdout);
+
+    game = nullptr;
+    ImGui::DestroyContext();
+}
+
+int main(int argc, char **argv)
+{
+    BenchOptions options;
+
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string_view arg = argv[i];
+            if (i + 1 >= argc)
+                throw std::runtime_error("Expected a value after `" + std::string(arg) + "`.");
+
+            if (arg == "--frames")
+                options.num_frames = std::max(1, std::atoi(argv[++i]));
+            else if (arg == "--warmup")
+                options.num_warmup_frames = std::max(0, std::atoi(argv[++i]));
+            else if (arg == "--font")
+                options.font_path = argv[++i];
+            else
+                throw std::runtime_error("Unknown argument: `" + std::string(arg) + "`.");
+        }
+    }
+    catch (std::exception &e)
+    {
+        std::fprintf(stderr, "%s\nUsage: `bench [--frames N] [--warmup N] [--font path/to/font.ttf]`.\n", e.what());
+        return 1;
+    }
+
+    for (int num_players : roster_sizes)
+    {
+        for (const RoleConfig &role_config : role_configs)
+            RunScenario(options, num_players, role_config);
+    }
+}
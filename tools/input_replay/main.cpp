@@ -0,0 +1,332 @@
+// Replays an input recording made with `mafia --record-input <file>`, without showing a window.
+// The events go through the same path as in the app: `ImGui_ImplSDL3_ProcessEvent()`, `TouchController::HandleEvents()`, then `BasicGame::Tick()`.
+// Prints the statistics to stdout as JSON Lines: one object per gesture (from pressing the left mouse button or a finger to releasing it), then a summary.
+// Usage: `input_replay <recording> [--golden <file>] [--write-golden <file>]`.
+// The golden file has a fingerprint of the ImGui input queue and of the draw data for every iteration.
+// With `--golden`, the replay is compared against it, and the exit code is 1 if they differ. Record a new golden file when the behavior changes on purpose.
+// Gamepads aren't replayed, since the backend polls them instead of using events. Don't toggle the frame stats overlay while recording, it isn't replayed either.
+
+#include "binary_io.h"
+#include "draw_fingerprint.h"
+#include "fonts.h"
+#include "game.h"
+#include "input_recording.h"
+#include "touch_controller.h"
+
+#include <imgui.h>
+#include <imgui_internal.h>
+#include <imgui_impl_sdl3.h>
+#include <SDL3/SDL.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct ReplayOptions
+{
+    std::string recording_path;
+    std::string golden_path;
+    std::string write_golden_path;
+};
+
+struct Gesture
+{
+    int start_iteration = 0;
+    int num_iterations = 0;
+    // The processing time of the iterations during the gesture: the events, the touch controller, and the frame if any.
+    double latency_us_sum = 0;
+    double latency_us_max = 0;
+};
+
+// We're the renderer, so we have to acknowledge the texture requests. Nothing is actually uploaded anywhere.
+static void UpdateTextures()
+{
+    for (ImTextureData *tex : ImGui::GetPlatformIO().Textures)
+    {
+        switch (tex->Status)
+        {
+            case ImTextureStatus_WantCreate:
+                tex->SetTexID(ImTextureID(1));
+                tex->SetStatus(ImTextureStatus_OK);
+                break;
+            case ImTextureStatus_WantUpdates:
+                tex->SetStatus(ImTextureStatus_OK);
+                break;
+            case ImTextureStatus_WantDestroy:
+                tex->SetTexID(ImTextureID_Invalid);
+                tex->SetStatus(ImTextureStatus_Destroyed);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+template <typename T>
+[[nodiscard]] static std::span<const unsigned char> AsBytes(const ImVector<T> &vec)
+{
+    return {(const unsigned char *)vec.Data, sizeof(T) * std::size_t(vec.Size)};
+}
+
+// The events that ImGui is going to process this frame, after the touch controller rewrote them.
+[[nodiscard]] static std::uint32_t InputQueueFingerprint()
+{
+    // `ImGuiInputEvent` zeroes itself in the constructor, so the padding doesn't contain garbage.
+    return Checksum(AsBytes(ImGui::GetCurrentContext()->InputEventsQueue));
+}
+
+[[nodiscard]] static std::vector<std::string> ReadLines(const std::string &path)
+{
+    std::size_t size = 0;
+    void *data = SDL_LoadFile(path.c_str(), &size);
+    if (!data)
+        throw std::runtime_error("Unable to load `" + path + "`: " + SDL_GetError());
+    std::unique_ptr<void, decltype(&SDL_free)> data_guard(data, SDL_free);
+
+    std::vector<std::string> ret;
+    std::string_view text((const char *)data, size);
+    while (!text.empty())
+    {
+        const std::size_t end = std::min(text.find('\n'), text.size());
+        ret.emplace_back(text.substr(0, end));
+        text.remove_prefix(std::min(end + 1, text.size()));
+    }
+    return ret;
+}
+
+[[nodiscard]] static double Percentile(const std::vector<double> &sorted, double fraction)
+{
+    if (sorted.empty())
+        return 0;
+    return sorted[std::min(sorted.size() - 1, std::size_t(double(sorted.size()) * fraction))];
+}
+
+[[nodiscard]] static bool IsPrimaryPress(const SDL_Event &event)
+{
+    return event.type == SDL_EVENT_MOUSE_BUTTON_DOWN && event.button.button == SDL_BUTTON_LEFT;
+}
+
+[[nodiscard]] static bool IsPrimaryRelease(const SDL_Event &event)
+{
+    return event.type == SDL_EVENT_MOUSE_BUTTON_UP && event.button.button == SDL_BUTTON_LEFT;
+}
+
+static int Replay(const ReplayOptions &options)
+{
+    // No visible window, but the backend still needs one to accept the events.
+    SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+    if (!SDL_Init(SDL_INIT_VIDEO))
+        throw std::runtime_error(std::string("`SDL_Init` failed: ") + SDL_GetError());
+    SDL_Window *window = SDL_CreateWindow("Input replay", 500, 800, SDL_WINDOW_HIDDEN);
+    if (!window)
+        throw std::runtime_error(std::string("`SDL_CreateWindow` failed: ") + SDL_GetError());
+
+    const InputRecording recording = LoadInputRecording(options.recording_path, SDL_GetWindowID(window));
+
+    // Same as in `main.cpp`.
+    ImGui::CreateContext();
+    ImGuiIO &io = ImGui::GetIO();
+    io.ConfigFlags = recording.config_flags;
+    io.IniFilename = nullptr;
+    io.BackendFlags |= ImGuiBackendFlags_RendererHasTextures | ImGuiBackendFlags_RendererHasVtxOffset;
+    ImGui::StyleColorsDark();
+    ImGui::GetStyle().ScaleAllSizes(recording.display_scale);
+    ImGui::GetStyle().FontScaleDpi = recording.display_scale;
+    ImGui_ImplSDL3_InitForOther(window);
+    LoadFonts();
+
+    GameOptions game_options;
+    game_options.persist_session = false;
+    std::unique_ptr<BasicGame> game = MakeGame(game_options);
+
+    TouchController touch_controller{
+        .accept_any_input_source = true
+    };
+
+    std::vector<std::string> golden_lines;
+    if (!options.golden_path.empty())
+        golden_lines = ReadLines(options.golden_path);
+    std::vector<std::string> output_lines;
+    std::optional<int> diverged_iteration;
+
+    std::vector<Gesture> gestures;
+    bool in_gesture = false;
+
+    int num_events = 0;
+    int num_frames = 0;
+    double input_us_total = 0;
+    double frame_us_total = 0;
+
+    for (int i = 0; i < int(recording.iterations.size()); i++)
+    {
+        const RecordedIteration &iteration = recording.iterations[std::size_t(i)];
+
+        bool gesture_ends = false;
+        for (const SDL_Event &event : iteration.events)
+        {
+            if (IsPrimaryPress(event) && !in_gesture)
+            {
+                in_gesture = true;
+                gestures.push_back({.start_iteration = i});
+            }
+            else if (IsPrimaryRelease(event))
+            {
+                gesture_ends = true;
+            }
+        }
+
+        const auto time_before = std::chrono::steady_clock::now();
+
+        for (const SDL_Event &event : iteration.events)
+        {
+            SDL_Event event_copy = event;
+            ImGui_ImplSDL3_ProcessEvent(&event_copy);
+        }
+        touch_controller.HandleEvents();
+
+        const auto time_after_input = std::chrono::steady_clock::now();
+
+        const std::uint32_t input_fingerprint = InputQueueFingerprint();
+        std::optional<std::uint64_t> draw_fingerprint;
+
+        if (iteration.frame)
+        {
+            ImGui_ImplSDL3_NewFrame();
+            // Override what the backend got from the window and the clock.
+            io.DisplaySize = iteration.frame->display_size;
+            io.DisplayFramebufferScale = iteration.frame->framebuffer_scale;
+            io.DeltaTime = iteration.frame->delta_time;
+            ImGui::NewFrame();
+            (void)WarmUpGlyphs();
+            game->Tick();
+            ImGui::Render();
+            UpdateTextures();
+        }
+
+        const auto time_after = std::chrono::steady_clock::now();
+
+        if (iteration.frame)
+        {
+            draw_fingerprint = DrawDataFingerprint(*ImGui::GetDrawData());
+            num_frames++;
+            frame_us_total += std::chrono::duration<double, std::micro>(time_after - time_after_input).count();
+        }
+
+        num_events += int(iteration.events.size());
+        input_us_total += std::chrono::duration<double, std::micro>(time_after_input - time_before).count();
+
+        if (in_gesture)
+        {
+            const double latency_us = std::chrono::duration<double, std::micro>(time_after - time_before).count();
+            Gesture &gesture = gestures.back();
+            gesture.num_iterations++;
+            gesture.latency_us_sum += latency_us;
+            gesture.latency_us_max = std::max(gesture.latency_us_max, latency_us);
+            if (gesture_ends)
+                in_gesture = false;
+        }
+
+        char line[64];
+        if (draw_fingerprint)
+            std::snprintf(line, sizeof line, "%d %08x %016llx", i, unsigned(input_fingerprint), (unsigned long long)*draw_fingerprint);
+        else
+            std::snprintf(line, sizeof line, "%d %08x -", i, unsigned(input_fingerprint));
+        output_lines.emplace_back(line);
+
+        if (!options.golden_path.empty() && !diverged_iteration && (std::size_t(i) >= golden_lines.size() || golden_lines[std::size_t(i)] != line))
+        {
+            diverged_iteration = i;
+            std::fprintf(stderr, "Diverged from the golden output at iteration %d: expected `%s`, got `%s`.\n",
+                i, std::size_t(i) < golden_lines.size() ? golden_lines[std::size_t(i)].c_str() : "<end>", line
+            );
+        }
+    }
+
+    if (!options.golden_path.empty() && !diverged_iteration && golden_lines.size() != output_lines.size())
+    {
+        diverged_iteration = int(output_lines.size());
+        std::fprintf(stderr, "The golden output has %d iterations, but the recording has %d.\n", int(golden_lines.size()), int(output_lines.size()));
+    }
+
+    if (!options.write_golden_path.empty())
+    {
+        std::string text;
+        for (const std::string &line : output_lines)
+            text += line + '\n';
+        if (!SDL_SaveFile(options.write_golden_path.c_str(), text.data(), text.size()))
+            throw std::runtime_error("Unable to write `" + options.write_golden_path + "`: " + SDL_GetError());
+    }
+
+    std::vector<double> gesture_latencies;
+    for (int i = 0; i < int(gestures.size()); i++)
+    {
+        const Gesture &gesture = gestures[std::size_t(i)];
+        std::printf(
+            "{\"gesture\":%d,\"start_iteration\":%d,\"iterations\":%d,\"latency_us_mean\":%.3f,\"latency_us_max\":%.3f}\n",
+            i, gesture.start_iteration, gesture.num_iterations,
+            gesture.latency_us_sum / std::max(1, gesture.num_iterations), gesture.latency_us_max
+        );
+        gesture_latencies.push_back(gesture.latency_us_max);
+    }
+    std::sort(gesture_latencies.begin(), gesture_latencies.end());
+
+    std::printf(
+        "{\"iterations\":%d,\"frames\":%d,\"events\":%d,\"events_per_second\":%.0f,\"frame_us_mean\":%.3f,"
+        "\"gestures\":%d,\"gesture_latency_us_p50\":%.3f,\"gesture_latency_us_p99\":%.3f,",
+        int(recording.iterations.size()), num_frames, num_events, input_us_total > 0 ? num_events / input_us_total * 1e6 : 0,
+        frame_us_total / std::max(1, num_frames),
+        int(gestures.size()), Percentile(gesture_latencies, 0.5), Percentile(gesture_latencies, 0.99)
+    );
+    // Null if there's no golden output or it matches.
+    if (diverged_iteration)
+        std::printf("\"diverged_iteration\":%d}\n", *diverged_iteration);
+    else
+        std::printf("\"diverged_iteration\":null}\n");
+    std::fflush(stdout);
+
+    game = nullptr;
+    ImGui_ImplSDL3_Shutdown();
+    ImGui::DestroyContext();
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+
+    return diverged_iteration ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    ReplayOptions options;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string_view arg = argv[i];
+        if (!arg.starts_with("--"))
+        {
+            options.recording_path = arg;
+            continue;
+        }
+
+        if (i + 1 >= argc)
+            throw std::runtime_error("Expected a value after `" + std::string(arg) + "`.");
+
+        if (arg == "--golden")
+            options.golden_path = argv[++i];
+        else if (arg == "--write-golden")
+            options.write_golden_path = argv[++i];
+        else
+            throw std::runtime_error("Unknown argument: `" + std::string(arg) + "`.");
+    }
+
+    if (options.recording_path.empty())
+        throw std::runtime_error("Usage: `input_replay <recording> [--golden <file>] [--write-golden <file>]`.");
+
+    return Replay(options);
+}
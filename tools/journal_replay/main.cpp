@@ -0,0 +1,130 @@
+// Checks that the session journal replays into a valid session.
+// Creates a session in a temporary directory, journals a sequence of commands for it (by default, a few turns, then a new game and one more turn),
+//   restores the session from that journal, and then checks that the snapshot written after replaying it loads back.
+// Prints one JSON object to stdout. The exit code is 1 if the restored session is invalid.
+// Usage: `journal_replay [--turns-before-new-game N] [--dir PATH]`.
+
+#include "binary_io.h"
+#include "commands.h"
+#include "game.h"
+#include "journal.h"
+#include "state.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct ReplayOptions
+{
+    int num_turns_before_new_game = 6;
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "mafia_journal_replay";
+};
+
+static int Run(const ReplayOptions &options)
+{
+    std::filesystem::remove_all(options.dir);
+    std::filesystem::create_directories(options.dir);
+    const std::string path_prefix = (options.dir / "session").string();
+
+    GameOptions game_options;
+    game_options.session_path_prefix = path_prefix;
+
+    // The first launch writes the initial snapshot.
+    (void)MakeGame(game_options);
+
+    std::vector<Command> commands;
+    for (int i = 0; i < options.num_turns_before_new_game; i++)
+        commands.push_back(Commands::NextTurn{});
+    commands.push_back(Commands::NewGame{});
+    commands.push_back(Commands::NextTurn{});
+
+    { // Journal the commands on top of that snapshot, as if the app got killed after performing them.
+        Journal journal(path_prefix);
+        std::optional<Journal::Contents> contents = journal.Load();
+        if (!contents)
+            throw std::runtime_error("The first launch didn't write a snapshot.");
+        journal.WriteSnapshot(std::move(contents->snapshot));
+
+        BinaryWriter writer;
+        for (const Command &command : commands)
+        {
+            writer.Clear();
+            WriteCommand(writer, command);
+            journal.Append(writer.Data());
+        }
+    }
+
+    // The second launch replays the journal, then writes a new snapshot with the result.
+    (void)MakeGame(game_options);
+
+    std::string error;
+    int num_days = 0;
+    int num_records = -1;
+    try
+    {
+        Journal journal(path_prefix);
+        std::optional<Journal::Contents> contents = journal.Load();
+        if (!contents)
+            throw std::runtime_error("The second launch didn't write a snapshot.");
+        num_records = int(contents->records.size());
+
+        // The beginning of `Game::SaveSession()`.
+        BinaryReader reader(contents->snapshot);
+        (void)reader.ReadVarint();
+        (void)ReadSettings(reader);
+        const Round round = ReadRound(reader);
+        num_days = int(round.state.days.size());
+    }
+    catch (std::exception &e)
+    {
+        error = e.what();
+    }
+
+    const bool ok = error.empty() && num_records == 0 && num_days >= 1;
+
+    std::printf(
+        "{\"commands\":%d,\"records_left\":%d,\"days\":%d,\"ok\":%d}\n",
+        int(commands.size()), num_records, num_days, int(ok)
+    );
+    std::fflush(stdout);
+
+    std::filesystem::remove_all(options.dir);
+
+    if (!ok)
+    {
+        if (!error.empty())
+            std::fprintf(stderr, "The restored session doesn't load: %s\n", error.c_str());
+        else
+            std::fprintf(stderr, "The restored session doesn't match the journaled commands.\n");
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    ReplayOptions options;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string_view arg = argv[i];
+        if (i + 1 >= argc)
+            throw std::runtime_error("Expected a value after `" + std::string(arg) + "`.");
+
+        if (arg == "--turns-before-new-game")
+            options.num_turns_before_new_game = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--dir")
+            options.dir = argv[++i];
+        else
+            throw std::runtime_error("Unknown argument: `" + std::string(arg) + "`.");
+    }
+
+    return Run(options);
+}
@@ -0,0 +1,145 @@
+// Makes language packs for the game (see `LanguagePack` in `localization.h`).
+// Usage: `language_pack export <ru|en|uk> <strings.txt>` writes the built-in strings of a language as text, to translate.
+// Or: `language_pack build <strings.txt> <language.pack>` converts the translated text into a pack.
+// The text has one string per line: the id, a tab, then the text, with `\n`, `\t` and `\\` escaped. Lines starting with `#` are ignored.
+// Put the packs into `languages/` next to the executable, or in the preferences directory.
+
+#include "binary_io.h"
+#include "localization.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+static std::string Escape(std::string_view str)
+{
+    std::string ret;
+    for (char ch : str)
+    {
+        switch (ch)
+        {
+            case '\n': ret += "\\n";  break;
+            case '\t': ret += "\\t";  break;
+            case '\\': ret += "\\\\"; break;
+            default:   ret += ch;     break;
+        }
+    }
+    return ret;
+}
+
+static std::string Unescape(std::string_view str, int line_number)
+{
+    std::string ret;
+    for (std::size_t i = 0; i < str.size(); i++)
+    {
+        if (str[i] != '\\')
+        {
+            ret += str[i];
+            continue;
+        }
+
+        if (++i == str.size())
+            throw std::runtime_error("Line " + std::to_string(line_number) + ": unfinished escape sequence.");
+        switch (str[i])
+        {
+            case 'n':  ret += '\n'; break;
+            case 't':  ret += '\t'; break;
+            case '\\': ret += '\\'; break;
+            default:
+                throw std::runtime_error("Line " + std::to_string(line_number) + ": unknown escape sequence.");
+        }
+    }
+    return ret;
+}
+
+static void Export(std::string_view language_code, const std::string &output_path)
+{
+    for (int i = 0; i < int(BuiltinLanguage::_count); i++)
+    {
+        const StringTable strings = BuiltinStrings(BuiltinLanguage(i));
+        if (strings[StringId::language_code] != language_code)
+            continue;
+
+        std::ofstream output(output_path, std::ios::binary);
+        if (!output)
+            throw std::runtime_error("Unable to open `" + output_path + "` for writing.");
+        for (int j = 0; j < int(StringId::_count); j++)
+            output << StringIdName(StringId(j)) << '\t' << Escape(strings[StringId(j)]) << '\n';
+        if (!output)
+            throw std::runtime_error("Unable to write `" + output_path + "`.");
+        return;
+    }
+
+    throw std::runtime_error("Unknown built-in language: `" + std::string(language_code) + "`.");
+}
+
+static void Build(const std::string &input_path, const std::string &output_path)
+{
+    std::ifstream input(input_path, std::ios::binary);
+    if (!input)
+        throw std::runtime_error("Unable to open `" + input_path + "`.");
+
+    std::vector<std::string> texts(std::size_t(StringId::_count));
+    std::vector<const char *> strings(std::size_t(StringId::_count));
+
+    std::string line;
+    int line_number = 0;
+    while (std::getline(input, line))
+    {
+        line_number++;
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty() || line.starts_with('#'))
+            continue;
+
+        const std::size_t tab = line.find('\t');
+        if (tab == std::string::npos)
+            throw std::runtime_error("Line " + std::to_string(line_number) + ": expected a tab after the id.");
+
+        const StringId id = FindStringId(std::string_view(line).substr(0, tab));
+        if (id == StringId::_count)
+        {
+            std::fprintf(stderr, "Line %d: unknown id `%s`, skipping it.\n", line_number, line.substr(0, tab).c_str());
+            continue;
+        }
+
+        texts[std::size_t(id)] = Unescape(std::string_view(line).substr(tab + 1), line_number);
+        strings[std::size_t(id)] = texts[std::size_t(id)].c_str();
+    }
+
+    BinaryWriter writer;
+    WriteLanguagePack(writer, strings);
+
+    std::ofstream output(output_path, std::ios::binary);
+    output.write((const char *)writer.Data().data(), std::streamsize(writer.Data().size()));
+    output.close();
+    if (!output)
+        throw std::runtime_error("Unable to write `" + output_path + "`.");
+
+    // Load it back, to check the format strings. Don't leave a broken pack behind.
+    try
+    {
+        (void)LanguagePack(output_path);
+    }
+    catch (...)
+    {
+        std::filesystem::remove(output_path);
+        throw;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const std::vector<std::string_view> args(argv + 1, argv + argc);
+
+    if (args.size() == 3 && args[0] == "export")
+        Export(args[1], std::string(args[2]));
+    else if (args.size() == 3 && args[0] == "build")
+        Build(std::string(args[1]), std::string(args[2]));
+    else
+        throw std::runtime_error("Usage: `language_pack export <ru|en|uk> <strings.txt>`, or `language_pack build <strings.txt> <language.pack>`.");
+}
@@ -0,0 +1,204 @@
+// A loopback test for the state replication (see `replication.h`).
+// Starts a server and many subscribers on 127.0.0.1, publishes random changes, adds more subscribers midway (they must catch up from a keyframe),
+//   then checks that every subscriber ends up with the same view as the server.
+// Prints one JSON object to stdout. The exit code is 1 if some subscribers didn't converge.
+// Usage: `replication_loopback [--subscribers N] [--late-subscribers N] [--changes N] [--players N] [--seed N]`.
+
+#include "binary_io.h"
+#include "replication.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+struct LoopbackOptions
+{
+    int num_subscribers = 200;
+    int num_late_subscribers = 20;
+    int num_changes = 2000;
+    int num_players = 20;
+    unsigned seed = 1;
+};
+
+// How long to wait for the subscribers to connect, and then to converge.
+static constexpr std::chrono::seconds timeout{20};
+
+// Makes one random change, similar to what the moderator does during a game.
+static void MakeRandomChange(PublicView &view, std::mt19937 &rng, int &name_counter)
+{
+    auto Random = [&](std::size_t n){return std::uniform_int_distribution<std::size_t>(0, n - 1)(rng);};
+
+    switch (Random(5))
+    {
+        case 0:
+            // Next phase.
+            if (view.phase == PublicPhase::day)
+            {
+                view.phase = PublicPhase::night;
+                view.day++;
+            }
+            else
+            {
+                view.phase = PublicPhase::day;
+            }
+            break;
+        case 1:
+            if (!view.players.empty())
+            {
+                view.players.erase(view.players.begin() + std::ptrdiff_t(Random(view.players.size())));
+                view.faction_counts[Random(view.faction_counts.size())]--;
+                break;
+            }
+            [[fallthrough]];
+        case 2:
+            view.players.insert(view.players.begin() + std::ptrdiff_t(Random(view.players.size() + 1)), "Игрок " + std::to_string(++name_counter));
+            view.faction_counts[Random(view.faction_counts.size())]++;
+            break;
+        case 3:
+            if (!view.players.empty())
+                view.players[Random(view.players.size())] = "Игрок " + std::to_string(++name_counter);
+            break;
+        case 4:
+            view.faction_counts[Random(view.faction_counts.size())] += Random(2) ? 1 : -1;
+            break;
+    }
+}
+
+template <typename F>
+[[nodiscard]] static bool WaitFor(F &&condition)
+{
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!condition())
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+}
+
+static int Run(const LoopbackOptions &options)
+{
+    std::mt19937 rng(options.seed);
+    int name_counter = 0;
+
+    PublicView view;
+    for (int i = 0; i < options.num_players; i++)
+    {
+        view.players.push_back("Игрок " + std::to_string(++name_counter));
+        view.faction_counts[std::size_t(i % 4 == 0 ? Faction::mafia : Faction::peaceful)]++;
+    }
+
+    ReplicationServer server(0);
+    server.Publish(view);
+
+    std::vector<std::unique_ptr<ReplicationClient>> clients;
+    auto AddClients = [&](int count)
+    {
+        for (int i = 0; i < count; i++)
+            clients.push_back(std::make_unique<ReplicationClient>("127.0.0.1", server.Port()));
+    };
+
+    AddClients(options.num_subscribers);
+    if (!WaitFor([&]{return server.NumSubscribers() == int(clients.size());}))
+        throw std::runtime_error("Only " + std::to_string(server.NumSubscribers()) + " of " + std::to_string(clients.size()) + " subscribers have connected.");
+
+    const std::uint64_t published_before = server.BytesPublished();
+    const auto time_before = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < options.num_changes; i++)
+    {
+        MakeRandomChange(view, rng, name_counter);
+        server.Publish(view);
+
+        if (i == options.num_changes / 2)
+            AddClients(options.num_late_subscribers);
+    }
+
+    const auto time_published = std::chrono::steady_clock::now();
+
+    // Wait for everyone to receive the final view.
+    std::vector<PublicView> client_views(clients.size());
+    std::vector<bool> converged(clients.size());
+    auto NumConverged = [&]{return int(std::count(converged.begin(), converged.end(), true));};
+    (void)WaitFor([&]
+    {
+        for (std::size_t i = 0; i < clients.size(); i++)
+        {
+            if (clients[i]->TakeView(client_views[i]))
+                converged[i] = client_views[i] == view;
+        }
+        return NumConverged() == int(clients.size());
+    });
+
+    const auto time_converged = std::chrono::steady_clock::now();
+
+    BinaryWriter keyframe_writer;
+    WritePublicViewKeyframe(keyframe_writer, view);
+
+    const std::uint64_t published = server.BytesPublished() - published_before;
+
+    std::printf(
+        "{\"subscribers\":%d,\"late_subscribers\":%d,\"changes\":%d,\"players\":%d,"
+        "\"published_bytes\":%llu,\"published_bytes_per_change\":%.2f,\"keyframe_bytes\":%d,\"sent_bytes\":%llu,"
+        "\"publish_ms\":%.3f,\"converge_ms\":%.3f,\"converged\":%d}\n",
+        options.num_subscribers, options.num_late_subscribers, options.num_changes, int(view.players.size()),
+        (unsigned long long)published, double(published) / std::max(1, options.num_changes), int(keyframe_writer.Data().size()), (unsigned long long)server.BytesSent(),
+        std::chrono::duration<double, std::milli>(time_published - time_before).count(),
+        std::chrono::duration<double, std::milli>(time_converged - time_published).count(),
+        NumConverged()
+    );
+    std::fflush(stdout);
+
+    const int num_failed = int(clients.size()) - NumConverged();
+
+    // Each client can take up to its poll interval to stop, so stop them in parallel.
+    std::vector<std::thread> stoppers;
+    for (std::unique_ptr<ReplicationClient> &client : clients)
+        stoppers.emplace_back([&client]{client = nullptr;});
+    for (std::thread &stopper : stoppers)
+        stopper.join();
+
+    if (num_failed > 0)
+    {
+        std::fprintf(stderr, "%d of %d subscribers didn't converge.\n", num_failed, int(clients.size()));
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    LoopbackOptions options;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string_view arg = argv[i];
+        if (i + 1 >= argc)
+            throw std::runtime_error("Expected a value after `" + std::string(arg) + "`.");
+
+        if (arg == "--subscribers")
+            options.num_subscribers = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--late-subscribers")
+            options.num_late_subscribers = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--changes")
+            options.num_changes = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--players")
+            options.num_players = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--seed")
+            options.seed = unsigned(std::atoi(argv[++i]));
+        else
+            throw std::runtime_error("Unknown argument: `" + std::string(arg) + "`.");
+    }
+
+    return Run(options);
+}
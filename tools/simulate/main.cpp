@@ -0,0 +1,88 @@
+// Plays random games to compare role configurations (see `simulation.h`), with the same code as the simulator in the app's menu.
+// Prints the results as one JSON object, with the 95% confidence intervals of the win rates.
+// Usage: `simulate --players N [--roles captain,sheriff,...] [--mafia N] [--yakuza N] [--policy random|informed] [--games N] [--seed N] [--threads N]`.
+//   `--roles` lists the enabled roles besides `mafia` and `none`, which are always enabled. Use `--roles none` to enable nothing else.
+
+#include "simulation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+static const char *const role_names[] = {"captain", "sheriff", "prostitute", "mafia_boss", "mafia", "yakuza", "killer", "none"};
+static const char *const winner_names[] = {"peaceful", "mafia", "yakuza", "killer", "none"};
+static const char *const policy_names[] = {"random", "informed"};
+
+static void ParseRoles(std::string_view list, SimulationConfig &config)
+{
+    while (!list.empty())
+    {
+        const std::size_t comma = std::min(list.find(','), list.size());
+        const std::string_view name = list.substr(0, comma);
+        list.remove_prefix(std::min(comma + 1, list.size()));
+
+        const auto it = std::find(std::begin(role_names), std::end(role_names), name);
+        if (it == std::end(role_names))
+            throw std::runtime_error("Unknown role: `" + std::string(name) + "`.");
+        config.enabled_roles[std::size_t(it - std::begin(role_names))] = true;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    SimulationConfig config;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string_view arg = argv[i];
+        if (i + 1 >= argc)
+            throw std::runtime_error("Expected a value after `" + std::string(arg) + "`.");
+
+        if (arg == "--players")
+            config.num_players = std::atoi(argv[++i]);
+        else if (arg == "--roles")
+            ParseRoles(argv[++i], config);
+        else if (arg == "--mafia")
+            config.num_mafia = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--yakuza")
+            config.num_yakuza = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--policy")
+        {
+            const std::string_view name = argv[++i];
+            const auto it = std::find(std::begin(policy_names), std::end(policy_names), name);
+            if (it == std::end(policy_names))
+                throw std::runtime_error("Unknown policy: `" + std::string(name) + "`.");
+            config.policy = SimulationPolicy(it - std::begin(policy_names));
+        }
+        else if (arg == "--games")
+            config.num_games = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--seed")
+            config.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--threads")
+            config.num_threads = std::max(0, std::atoi(argv[++i]));
+        else
+            throw std::runtime_error("Usage: `simulate --players N [--roles captain,sheriff,...] [--mafia N] [--yakuza N] [--policy random|informed] [--games N] [--seed N] [--threads N]`.");
+    }
+
+    const auto time_before = std::chrono::steady_clock::now();
+    const SimulationResult result = RunSimulation(config);
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - time_before).count();
+
+    std::printf("{\"simulation_ms\":%.3f,\"games\":%llu,\"average_days\":%.3f,\"roles\":[", ms, (unsigned long long)result.num_games, result.AverageDays());
+    const std::vector<Role> roles = DealSimulationRoles(config);
+    for (std::size_t i = 0; i < roles.size(); i++)
+        std::printf("%s\"%s\"", i == 0 ? "" : ",", role_names[std::size_t(roles[i])]);
+    std::printf("],\"wins\":{");
+    for (std::size_t i = 0; i < result.wins.size(); i++)
+    {
+        const auto [low, high] = result.WinRateInterval(i);
+        std::printf("%s\"%s\":{\"rate\":%.5f,\"low\":%.5f,\"high\":%.5f}", i == 0 ? "" : ",", winner_names[i], result.WinRate(i), low, high);
+    }
+    std::printf("}}\n");
+}